@@ -1,8 +1,4 @@
 // TODO: 
-// data callback functions:
-// 	DSCS_setDataCallback()
-// 	DSCS_setDataOutputEnabled()
-// 
 // controller/operation
 // 	DSCS_resetSetpointModulationPhase()
 // 	DSCS_resetPIController()
@@ -12,6 +8,7 @@
 // make writeFloat64 function
 //
 #include <stdio.h>
+#include <stdint.h>
 #include <iocsh.h>
 #include <epicsExport.h>
 #include <epicsString.h>
@@ -21,6 +18,10 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <epicsTime.h>
 #include "dscs.h" // vendor supplied library
 
 #include "dscsAsyn.h"
@@ -29,14 +30,43 @@
 
 using namespace std;
 
-struct Context {
-  const char * _tag;
-  unsigned int _expectedIndex;
-  double       _timestamp;
+// Data callback channels; stream parameter names end in the tag
+static const char *streamTags[DSCS_STREAM_CHANNELS] = { "REL", "ABS" };
+
+// Captures, the stream channels and the merged records
+static const char *captureTags[DSCS_CAPTURE_CHANNELS] = { "REL", "ABS", "MERGE" };
+
+// Port lock call sites; lock statistics parameter names end in the tag
+static const char *lockSiteTags[DSCS_NUM_LOCK_SITES] = {
+  "ASYN", "CONNECT", "DISCONNECT", "POLLER", "WRITER", "STREAM", "CAPTURE", "REPLAY", "WATCH", "SCAN", "SHELL"
+};
+
+// Driver threads, as named to dscsAsynThread
+static const char *threadTags[DSCS_NUM_THREADS] = {
+  "POLLER", "WRITER", "STREAM", "WATCH", "SCAN", "CAPTURE", "REPLAY"
 };
 
-static struct Context contextRel = { "Rel", 0, -1 };
-static struct Context contextAbs = { "Abs", 0, -1 };
+// The vendor callback carries no user pointer, so the driver that
+// registered it is kept here; one port streams at a time
+static std::atomic<dscsAsyn *> streamDriver(NULL);
+
+static void dataCallbackC(int channel, int length, int index, const Int32 *data)
+{
+  dscsAsyn *driver = streamDriver.load();
+  if (driver) driver->dataCallback(channel, length, index, (const epicsInt32 *)data);
+}
+
+// Stream parameter names are <base>_<tag>, e.g. STREAM_DATA_REL
+static void streamParamName(const char *base, int channel, char *buf, size_t n)
+{
+  snprintf(buf, n, "%s_%s", base, streamTags[channel]);
+}
+
+// Capture parameter names are <base>_<tag>, e.g. CAPTURE_FILE_MERGE
+static void captureParamName(const char *base, int capture, char *buf, size_t n)
+{
+  snprintf(buf, n, "%s_%s", base, captureTags[capture]);
+}
 
 static const char * getMessage( int code )
 {
@@ -54,31 +84,39 @@ static const char * getMessage( int code )
   }
 }
 
-void dscsAsyn::checkError(const char * context, int code)
+// Errors that mean the link to the controller is gone; anything else is
+// reported but leaves the connection in place.
+static dscsErrorClass classifyError( int code )
 {
-  if ( code != DSCS_Ok ) {
-    printf( "Error calling %s: %s\n", context, getMessage( code ) );
+  switch( code ) {
+  case DSCS_Ok:           return dscsErrorNone;
+  case DSCS_Timeout:
+  case DSCS_NotConnected:
+  case DSCS_DriverError:
+  case DSCS_NoDevice:     return dscsErrorLink;
+  default:                return dscsErrorCommand;
   }
 }
 
-// uses following functions from dscs.h:
-// DSCS_getOSA_PS
-// DSCS_getBS_PS
-// DSCS_getNFO_PS
-// DSCS_getSAM_PS
-// DSCS_getNFO_SG
-// DSCS_getSAM_CP_D
-// DSCS_getXZ_ZX
-// DSCS_getNFO
-// DSCS_getSAM
-//
-// DSCS_API int WINCC DSCS_getAUX_DAC(const unsigned int devNo,
-//                                    const DSCS_AUX_ADC aux,
-//                                    int               *value);
-// DSCS_API int WINCC DSCS_getAUX_ADC(const unsigned int devNo,
-//                                    const DSCS_AUX_ADC aux,
-//                                    int               *value);
+dscsErrorClass dscsAsyn::checkError(const char * context, int code)
+{
+  if ( code != DSCS_Ok ) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s, port %s, error calling %s: %s\n",
+      driverName, this->portName, context, getMessage( code ) );
+  }
+  return classifyError( code );
+}
 
+// Map a vendor return code to an asynStatus for the write path. A link-class
+// error takes the port offline so the poller can start reconnecting.
+asynStatus dscsAsyn::checkStatus(const char * context, int code)
+{
+  switch( checkError( context, code ) ) {
+  case dscsErrorNone: return asynSuccess;
+  case dscsErrorLink: linkLost(); return asynDisconnected;
+  default:            return asynError;
+  }
+}
 
 // TODO: implement multi axis
 inline void dscsAsyn::pollAnalogIn()
@@ -93,274 +131,381 @@ static void pollerThreadC(void * pPvt)
   pdscsAsyn->pollerThread();
 }
 
+static void streamThreadC(void * pPvt)
+{
+  dscsAsyn *pdscsAsyn = (dscsAsyn*)pPvt;
+  pdscsAsyn->streamThread();
+}
+
+static void watchThreadC(void * pPvt)
+{
+  dscsAsyn *pdscsAsyn = (dscsAsyn*)pPvt;
+  pdscsAsyn->watchThread();
+}
+
+static void scanThreadC(void * pPvt)
+{
+  dscsAsyn *pdscsAsyn = (dscsAsyn*)pPvt;
+  pdscsAsyn->scanThread();
+}
+
+static void captureThreadC(void * pPvt)
+{
+  dscsAsyn *pdscsAsyn = (dscsAsyn*)pPvt;
+  pdscsAsyn->captureThread();
+}
+
+static void replayThreadC(void * pPvt)
+{
+  dscsAsyn *pdscsAsyn = (dscsAsyn*)pPvt;
+  pdscsAsyn->replayThread();
+}
+
+static void writerThreadC(void * pPvt)
+{
+  dscsAsyn *pdscsAsyn = (dscsAsyn*)pPvt;
+  pdscsAsyn->writerThread();
+}
+
 dscsAsyn::dscsAsyn(const char *portName, const char *dscsAsynPortName, int dscsId) : asynPortDriver(portName, MAX_CONTROLLERS,
 		asynInt32Mask | asynFloat64Mask | asynDrvUserMask | asynOctetMask | asynFloat64ArrayMask | asynInt32ArrayMask,
 		asynInt32Mask | asynFloat64Mask | asynOctetMask | asynFloat64ArrayMask | asynInt32ArrayMask,
 		ASYN_MULTIDEVICE | ASYN_CANBLOCK, 1, /* ASYN_CANBLOCK=0, ASYN_MULTIDEVICE=1, autoConnect=1 */
 		0, 0), /* Default priority and stack size */
-    pollTime_(DEFAULT_POLL_TIME)
+    pollTime_(DEFAULT_POLL_TIME),
+    reconnectTime_(DEFAULT_RECONNECT_TIME),
+    slowPollDivisor_(DEFAULT_SLOW_POLL_DIVISOR)
 {
 	static const char *functionName = "dscsAsyn";
     asynStatus status;
 
     	this->deviceId = dscsId;
 
-	// "//" after line means tested
-
-	// OSA_PS (x and y)
-	createParam("OSA_PS_X",         asynParamInt32, &OSA_PS_[0]); //
-	createParam("OSA_PS_Y",         asynParamInt32, &OSA_PS_[1]); //
-	createParam("OSA_PS_RBV_X",     asynParamInt32, &OSA_PS_rbv_[0]); //
-	createParam("OSA_PS_RBV_Y",     asynParamInt32, &OSA_PS_rbv_[1]); //
-	
-	// BS_PS (x and y)
-	createParam("BS_PS_X",          asynParamInt32, &BS_PS_[0]); //
-	createParam("BS_PS_Y",          asynParamInt32, &BS_PS_[1]); //
-	createParam("BS_PS_RBV_X",      asynParamInt32, &BS_PS_rbv_[0]); //
-	createParam("BS_PS_RBV_Y",      asynParamInt32, &BS_PS_rbv_[1]); //
-	
-	// AUX_DAC (0-3)
-	createParam("AUX_DAC_0",        asynParamInt32, &AUX_DAC_[0]); //
-	createParam("AUX_DAC_1",        asynParamInt32, &AUX_DAC_[1]); //
-	createParam("AUX_DAC_2",        asynParamInt32, &AUX_DAC_[2]); //
-	createParam("AUX_DAC_3",        asynParamInt32, &AUX_DAC_[3]); //
-	createParam("AUX_DAC_RBV_0",    asynParamInt32, &AUX_DAC_rbv_[0]); //
-	createParam("AUX_DAC_RBV_1",    asynParamInt32, &AUX_DAC_rbv_[1]); //
-	createParam("AUX_DAC_RBV_2",    asynParamInt32, &AUX_DAC_rbv_[2]); //
-	createParam("AUX_DAC_RBV_3",    asynParamInt32, &AUX_DAC_rbv_[3]); //
-	
-	// NFO_PS (x, y, z)
-	createParam("NFO_PS_X",         asynParamInt32, &NFO_PS_[0]); //
-	createParam("NFO_PS_Y",         asynParamInt32, &NFO_PS_[1]); //
-	createParam("NFO_PS_Z",         asynParamInt32, &NFO_PS_[2]); //
-	createParam("NFO_PS_RBV_X",     asynParamInt32, &NFO_PS_rbv_[0]); //
-	createParam("NFO_PS_RBV_Y",     asynParamInt32, &NFO_PS_rbv_[1]); //
-	createParam("NFO_PS_RBV_Z",     asynParamInt32, &NFO_PS_rbv_[2]); //
-	
-	// SAM_PS (x, y, z)
-	createParam("SAM_PS_X",         asynParamInt32, &SAM_PS_[0]); //
-	createParam("SAM_PS_Y",         asynParamInt32, &SAM_PS_[1]); //
-	createParam("SAM_PS_Z",         asynParamInt32, &SAM_PS_[2]); //
-	createParam("SAM_PS_RBV_X",     asynParamInt32, &SAM_PS_rbv_[0]); //
-	createParam("SAM_PS_RBV_Y",     asynParamInt32, &SAM_PS_rbv_[1]); //
-	createParam("SAM_PS_RBV_Z",     asynParamInt32, &SAM_PS_rbv_[2]); //
-	
-	// NFO_SG_rbv (x, y, z)
-	createParam("NFO_SG_RBV_X",     asynParamInt32, &NFO_SG_rbv_[0]); //
-	createParam("NFO_SG_RBV_Y",     asynParamInt32, &NFO_SG_rbv_[1]); //
-	createParam("NFO_SG_RBV_Z",     asynParamInt32, &NFO_SG_rbv_[2]); //
-	
-	// SAM_CP_D_rbv (x, y, z)
-	createParam("SAM_CP_D_RBV_X",   asynParamInt32, &SAM_CP_D_rbv_[0]); //
-	createParam("SAM_CP_D_RBV_Y",   asynParamInt32, &SAM_CP_D_rbv_[1]); //
-	createParam("SAM_CP_D_RBV_Z",   asynParamInt32, &SAM_CP_D_rbv_[2]); //
-	
-	// XZ_ZX_rbv (0-1)
-	createParam("XZ_ZX_RBV_0",      asynParamInt32, &XZ_ZX_rbv_[0]); //
-	createParam("XZ_ZX_RBV_1",      asynParamInt32, &XZ_ZX_rbv_[1]); //
-	
-	// AUX_ADC_rbv (0-2)
-	createParam("AUX_ADC_RBV_0",    asynParamInt32, &AUX_ADC_rbv_[0]); //
-	createParam("AUX_ADC_RBV_1",    asynParamInt32, &AUX_ADC_rbv_[1]); //
-	createParam("AUX_ADC_RBV_2",    asynParamInt32, &AUX_ADC_rbv_[2]); //
-	
-	// NFO_rbv (x, y, z)
-	createParam("NFO_RBV_X",        asynParamInt32, &NFO_rbv_[0]); // returns only 0
-	createParam("NFO_RBV_Y",        asynParamInt32, &NFO_rbv_[1]); // returns only 0
-	createParam("NFO_RBV_Z",        asynParamInt32, &NFO_rbv_[2]); // returns only 0
-	
-	// SAM_rbv (x, y, z)
-	createParam("SAM_RBV_X",        asynParamInt32, &SAM_rbv_[0]); // returns only 0
-	createParam("SAM_RBV_Y",        asynParamInt32, &SAM_rbv_[1]); // returns only 0
-	createParam("SAM_RBV_Z",        asynParamInt32, &SAM_rbv_[2]); // returns only 0
-	
-	// SetptFreq (x, y, z)
-	createParam("SETPT_FREQ_X",         asynParamInt32, &SetptFreq_[0]); //
-	createParam("SETPT_FREQ_Y",         asynParamInt32, &SetptFreq_[1]); //
-	createParam("SETPT_FREQ_Z",         asynParamInt32, &SetptFreq_[2]); //
-	createParam("SETPT_FREQ_RBV_X",     asynParamInt32, &SetptFreq_rbv_[0]); //
-	createParam("SETPT_FREQ_RBV_Y",     asynParamInt32, &SetptFreq_rbv_[1]); //
-	createParam("SETPT_FREQ_RBV_Z",     asynParamInt32, &SetptFreq_rbv_[2]); //
-	
-	// SetptPhase (x, y, z)
-	createParam("SETPT_PHASE_X",        asynParamInt32, &SetptPhase_[0]); //
-	createParam("SETPT_PHASE_Y",        asynParamInt32, &SetptPhase_[1]); //
-	createParam("SETPT_PHASE_Z",        asynParamInt32, &SetptPhase_[2]); //
-	createParam("SETPT_PHASE_RBV_X",    asynParamInt32, &SetptPhase_rbv_[0]); //
-	createParam("SETPT_PHASE_RBV_Y",    asynParamInt32, &SetptPhase_rbv_[1]); //
-	createParam("SETPT_PHASE_RBV_Z",    asynParamInt32, &SetptPhase_rbv_[2]); //
-	
-	// SetptAmp (x, y, z)
-	createParam("SETPT_AMP_X",          asynParamInt32, &SetptAmp_[0]); //
-	createParam("SETPT_AMP_Y",          asynParamInt32, &SetptAmp_[1]); //
-	createParam("SETPT_AMP_Z",          asynParamInt32, &SetptAmp_[2]); //
-	createParam("SETPT_AMP_RBV_X",      asynParamInt32, &SetptAmp_rbv_[0]); //
-	createParam("SETPT_AMP_RBV_Y",      asynParamInt32, &SetptAmp_rbv_[1]); //
-	createParam("SETPT_AMP_RBV_Z",      asynParamInt32, &SetptAmp_rbv_[2]); //
-
-	/////////////////////////////////////////////////////////////////////////
-	
-	// ExtADCShift (single value)
-	createParam("EXT_ADC_SHIFT",        asynParamInt32, &ExtADCShift_);
-	createParam("EXT_ADC_SHIFT_RBV",    asynParamInt32, &ExtADCShift_rbv_);
-	
-	// PIEnNFO (x, y, z)
-	createParam("PI_EN_NFO_X",          asynParamInt32, &PIEnNFO_[0]);
-	createParam("PI_EN_NFO_Y",          asynParamInt32, &PIEnNFO_[1]);
-	createParam("PI_EN_NFO_Z",          asynParamInt32, &PIEnNFO_[2]);
-	createParam("PI_EN_NFO_RBV_X",      asynParamInt32, &PIEnNFO_rbv_[0]);
-	createParam("PI_EN_NFO_RBV_Y",      asynParamInt32, &PIEnNFO_rbv_[1]);
-	createParam("PI_EN_NFO_RBV_Z",      asynParamInt32, &PIEnNFO_rbv_[2]);
-	
-	// PIIValNFO (x, y, z)
-	// TODO: make float write function
-	createParam("PI_I_VAL_NFO_X",       asynParamFloat64, &PIIValNFO_[0]);
-	createParam("PI_I_VAL_NFO_Y",       asynParamFloat64, &PIIValNFO_[1]);
-	createParam("PI_I_VAL_NFO_Z",       asynParamFloat64, &PIIValNFO_[2]);
-	createParam("PI_I_VAL_NFO_RBV_X",   asynParamFloat64, &PIIValNFO_rbv_[0]);
-	createParam("PI_I_VAL_NFO_RBV_Y",   asynParamFloat64, &PIIValNFO_rbv_[1]);
-	createParam("PI_I_VAL_NFO_RBV_Z",   asynParamFloat64, &PIIValNFO_rbv_[2]);
-	
-	// PIPValNFO (x, y, z)
-	createParam("PI_P_VAL_NFO_X",       asynParamInt32, &PIPValNFO_[0]);
-	createParam("PI_P_VAL_NFO_Y",       asynParamInt32, &PIPValNFO_[1]);
-	createParam("PI_P_VAL_NFO_Z",       asynParamInt32, &PIPValNFO_[2]);
-	createParam("PI_P_VAL_NFO_RBV_X",   asynParamInt32, &PIPValNFO_rbv_[0]);
-	createParam("PI_P_VAL_NFO_RBV_Y",   asynParamInt32, &PIPValNFO_rbv_[1]);
-	createParam("PI_P_VAL_NFO_RBV_Z",   asynParamInt32, &PIPValNFO_rbv_[2]);
-	
-	// PILimNFO (single value)
-	createParam("PI_LIM_NFO",           asynParamInt32, &PILimNFO_);
-	createParam("PI_LIM_NFO_RBV",       asynParamInt32, &PILimNFO_rbv_);
-	
-	// PIAvgNFO (single value)
-	createParam("PI_AVG_NFO",           asynParamInt32, &PIAvgNFO_);
-	createParam("PI_AVG_NFO_RBV",       asynParamInt32, &PIAvgNFO_rbv_);
-	
-	// PIEnSAM (x, y, z)
-	createParam("PI_EN_SAM_X",          asynParamInt32, &PIEnSAM_[0]);
-	createParam("PI_EN_SAM_Y",          asynParamInt32, &PIEnSAM_[1]);
-	createParam("PI_EN_SAM_Z",          asynParamInt32, &PIEnSAM_[2]);
-	createParam("PI_EN_SAM_RBV_X",      asynParamInt32, &PIEnSAM_rbv_[0]);
-	createParam("PI_EN_SAM_RBV_Y",      asynParamInt32, &PIEnSAM_rbv_[1]);
-	createParam("PI_EN_SAM_RBV_Z",      asynParamInt32, &PIEnSAM_rbv_[2]);
-	
-	// PIIValSAM (x, y, z)
-	createParam("PI_I_VAL_SAM_X",       asynParamFloat64, &PIIValSAM_[0]);
-	createParam("PI_I_VAL_SAM_Y",       asynParamFloat64, &PIIValSAM_[1]);
-	createParam("PI_I_VAL_SAM_Z",       asynParamFloat64, &PIIValSAM_[2]);
-	createParam("PI_I_VAL_SAM_RBV_X",   asynParamFloat64, &PIIValSAM_rbv_[0]);
-	createParam("PI_I_VAL_SAM_RBV_Y",   asynParamFloat64, &PIIValSAM_rbv_[1]);
-	createParam("PI_I_VAL_SAM_RBV_Z",   asynParamFloat64, &PIIValSAM_rbv_[2]);
-	
-	// PIPValSAM (x, y, z)
-	createParam("PI_P_VAL_SAM_X",       asynParamInt32, &PIPValSAM_[0]);
-	createParam("PI_P_VAL_SAM_Y",       asynParamInt32, &PIPValSAM_[1]);
-	createParam("PI_P_VAL_SAM_Z",       asynParamInt32, &PIPValSAM_[2]);
-	createParam("PI_P_VAL_SAM_RBV_X",   asynParamInt32, &PIPValSAM_rbv_[0]);
-	createParam("PI_P_VAL_SAM_RBV_Y",   asynParamInt32, &PIPValSAM_rbv_[1]);
-	createParam("PI_P_VAL_SAM_RBV_Z",   asynParamInt32, &PIPValSAM_rbv_[2]);
-	
-	// PILimSAM (single value)
-	createParam("PI_LIM_SAM",           asynParamInt32, &PILimSAM_);
-	createParam("PI_LIM_SAM_RBV",       asynParamInt32, &PILimSAM_rbv_);
-	
-	// PITargPos (x, y, z)
-	createParam("PI_TARG_POS_X",        asynParamInt32, &PITargPos_[0]);
-	createParam("PI_TARG_POS_Y",        asynParamInt32, &PITargPos_[1]);
-	createParam("PI_TARG_POS_Z",        asynParamInt32, &PITargPos_[2]);
-	createParam("PI_TARG_POS_RBV_X",    asynParamInt32, &PITargPos_rbv_[0]);
-	createParam("PI_TARG_POS_RBV_Y",    asynParamInt32, &PITargPos_rbv_[1]);
-	createParam("PI_TARG_POS_RBV_Z",    asynParamInt32, &PITargPos_rbv_[2]);
-	
-	// PITargMode (single value)
-	createParam("PI_TARG_MODE",         asynParamInt32, &PITargMode_);
-	createParam("PI_TARG_MODE_RBV",     asynParamInt32, &PITargMode_rbv_);
-	
-	// PINFOOut_rbv (x, y, z)
-	createParam("PI_NFO_OUT_RBV_X",     asynParamInt32, &PINFOOut_rbv_[0]);
-	createParam("PI_NFO_OUT_RBV_Y",     asynParamInt32, &PINFOOut_rbv_[1]);
-	createParam("PI_NFO_OUT_RBV_Z",     asynParamInt32, &PINFOOut_rbv_[2]);
-	
-	// PISAMOut_rbv (x, y, z)
-	createParam("PI_SAM_OUT_RBV_X",     asynParamInt32, &PISAMOut_rbv_[0]);
-	createParam("PI_SAM_OUT_RBV_Y",     asynParamInt32, &PISAMOut_rbv_[1]);
-	createParam("PI_SAM_OUT_RBV_Z",     asynParamInt32, &PISAMOut_rbv_[2]);
-	
-	// NFOADCLimMin/Max (single value)
-	createParam("NFO_ADC_LIM_MIN",      asynParamInt32, &NFOADCLimMin_);
-	createParam("NFO_ADC_LIM_MAX",      asynParamInt32, &NFOADCLimMax_);
-	createParam("NFO_ADC_LIM_MIN_RBV",  asynParamInt32, &NFOADCLimMin_rbv_);
-	createParam("NFO_ADC_LIM_MAX_RBV",  asynParamInt32, &NFOADCLimMax_rbv_);
-	
-	// NFOSlewLim (single value)
-	createParam("NFO_SLEW_LIM",         asynParamInt32, &NFOSlewLim_);
-	createParam("NFO_SLEW_LIM_RBV",     asynParamInt32, &NFOSlewLim_rbv_);
-	
-	// SAMADCLimMin/Max (single value)
-	createParam("SAM_ADC_LIM_MIN",      asynParamInt32, &SAMADCLimMin_);
-	createParam("SAM_ADC_LIM_MAX",      asynParamInt32, &SAMADCLimMax_);
-	createParam("SAM_ADC_LIM_MIN_RBV",  asynParamInt32, &SAMADCLimMin_rbv_);
-	createParam("SAM_ADC_LIM_MAX_RBV",  asynParamInt32, &SAMADCLimMax_rbv_);
-	
-	// SAMSlewLim (single value)
-	createParam("SAM_SLEW_LIM",         asynParamInt32, &SAMSlewLim_);
-	createParam("SAM_SLEW_LIM_RBV",     asynParamInt32, &SAMSlewLim_rbv_);
-	
-	// LimState_rbv (single value)
-	createParam("LIM_STATE_RBV",        asynParamInt32, &LimState_rbv_);
-	
-	// InpTransMat (matrix: one createParam, float64 array, 3x15 = 45 elements)
-	createParam("INP_TRANS_MAT",        asynParamFloat64Array, InpTransMat_);   // 45 elements
-	
-	// InpTransRes_rbv (x, y, z)
-	createParam("INP_TRANS_RES_RBV_X",  asynParamInt32, &InpTransRes_rbv_[0]);
-	createParam("INP_TRANS_RES_RBV_Y",  asynParamInt32, &InpTransRes_rbv_[1]);
-	createParam("INP_TRANS_RES_RBV_Z",  asynParamInt32, &InpTransRes_rbv_[2]);
-	
-	// InpTransAvg_rbv (single value)
-	createParam("INP_TRANS_AVG_RBV",    asynParamInt32, &InpTransAvg_rbv_);
-	
+	// Vendor-backed setpoints and readbacks, see dscsParamTable
+	createTableParams();
+	createHistories();
+
+	// Link state
+	createParam("CONNECTED_RBV",        asynParamInt32, &Connected_rbv_);
+	createParam("RECONNECTS_RBV",       asynParamInt32, &Reconnects_rbv_);
+	setIntegerParam(Connected_rbv_, 0);
+	setIntegerParam(Reconnects_rbv_, 0);
+
+	// Poll timing
+	createParam("POLL_PERIOD",          asynParamFloat64, &PollPeriod_);
+	createParam("POLL_LAST_CYCLE_RBV",  asynParamFloat64, &PollLastCycle_rbv_);
+	createParam("POLL_MAX_CYCLE_RBV",   asynParamFloat64, &PollMaxCycle_rbv_);
+	createParam("POLL_RATE_RBV",        asynParamFloat64, &PollRate_rbv_);
+	createParam("POLL_JITTER_RBV",      asynParamFloat64, &PollJitter_rbv_);
+	createParam("POLL_OVERRUNS_RBV",    asynParamInt32,   &PollOverruns_rbv_);
+	createParam("POLL_TIMING_RESET",    asynParamInt32,   &PollTimingReset_);
+
+	// Port lock statistics, one set per call site
+	for (int site = 0; site < DSCS_NUM_LOCK_SITES; ++site) {
+		char name[64];
+		snprintf(name, sizeof(name), "LOCK_COUNT_RBV_%s", lockSiteTags[site]);
+		createParam(name, asynParamInt32, &LockCount_rbv_[site]);
+		snprintf(name, sizeof(name), "LOCK_WAIT_P99_RBV_%s", lockSiteTags[site]);
+		createParam(name, asynParamFloat64, &LockWaitP99_rbv_[site]);
+		snprintf(name, sizeof(name), "LOCK_WAIT_MAX_RBV_%s", lockSiteTags[site]);
+		createParam(name, asynParamFloat64, &LockWaitMax_rbv_[site]);
+		snprintf(name, sizeof(name), "LOCK_HOLD_P99_RBV_%s", lockSiteTags[site]);
+		createParam(name, asynParamFloat64, &LockHoldP99_rbv_[site]);
+		snprintf(name, sizeof(name), "LOCK_HOLD_MAX_RBV_%s", lockSiteTags[site]);
+		createParam(name, asynParamFloat64, &LockHoldMax_rbv_[site]);
+		snprintf(name, sizeof(name), "LOCK_WAIT_HIST_%s", lockSiteTags[site]);
+		createParam(name, asynParamInt32Array, &LockWaitHist_[site]);
+		snprintf(name, sizeof(name), "LOCK_HOLD_HIST_%s", lockSiteTags[site]);
+		createParam(name, asynParamInt32Array, &LockHoldHist_[site]);
+	}
+	createParam("LOCK_HIST_EDGES",      asynParamFloat64Array, &LockHistEdges_);
+	createParam("LOCK_STATS_RESET",     asynParamInt32,   &LockStatsReset_);
+	resetLockStats();
+
+	// Setpoint write queue
+	createParam("WRITE_QUEUE_RBV",      asynParamInt32,   &WriteQueue_rbv_);
+	createParam("WRITE_COALESCED_RBV",  asynParamInt32,   &WriteCoalesced_rbv_);
+	createParam("WRITE_ERRORS_RBV",     asynParamInt32,   &WriteErrors_rbv_);
+	setIntegerParam(WriteQueue_rbv_, 0);
+	setIntegerParam(WriteCoalesced_rbv_, 0);
+	setIntegerParam(WriteErrors_rbv_, 0);
+	writeEvent_ = epicsEventMustCreate(epicsEventEmpty);
+	setDoubleParam(PollPeriod_, pollTime_);
+	resetPollTiming();
+
+	// Data stream, one set per callback channel
+	createParam("STREAM_ENABLE",        asynParamInt32,   &StreamEnable_);
+	setIntegerParam(StreamEnable_, 0);
+	for (int ch = 0; ch < DSCS_STREAM_CHANNELS; ++ch) {
+		char name[64];
+		streamParamName("STREAM_DATA", ch, name, sizeof(name));
+		createParam(name, asynParamInt32Array, &StreamData_[ch]);
+		streamParamName("STREAM_TIME", ch, name, sizeof(name));
+		createParam(name, asynParamFloat64Array, &StreamTime_[ch]);
+		streamParamName("STREAM_RATE_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamFloat64, &StreamRate_rbv_[ch]);
+		streamParamName("STREAM_TIME_RESID_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamFloat64, &StreamTimeResid_rbv_[ch]);
+		streamParamName("STREAM_LOST_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamInt32, &StreamLost_rbv_[ch]);
+		streamParamName("STREAM_OVERFLOWS_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamInt32, &StreamOverflows_rbv_[ch]);
+		setDoubleParam(StreamRate_rbv_[ch], 0);
+		setDoubleParam(StreamTimeResid_rbv_[ch], 0);
+		setIntegerParam(StreamLost_rbv_[ch], 0);
+		setIntegerParam(StreamOverflows_rbv_[ch], 0);
+		streamQueue_[ch] = new dscsStreamQueue<epicsInt32>(DSCS_STREAM_QUEUE_PACKETS, DSCS_STREAM_QUEUE_VALUES);
+	}
+	streamEvent_ = epicsEventMustCreate(epicsEventEmpty);
+
+	// Merged stream, see dscsAsynMerge
+	createParam("MERGE_DATA",           asynParamInt32Array,   &MergeData_);
+	createParam("MERGE_TIME",           asynParamFloat64Array, &MergeTime_);
+	for (int k = 0; k < DSCS_MERGE_WIDTH; ++k) {
+		char name[64];
+		snprintf(name, sizeof(name), "MERGE_POS_%d", k);
+		createParam(name, asynParamFloat64Array, &MergePos_[k]);
+	}
+	createParam("MERGE_ALIGNED_RBV",    asynParamInt32,        &MergeAligned_rbv_);
+	setIntegerParam(MergeAligned_rbv_, 0);
+
+	// Settings snapshot, see dscsSettings.h
+	createParam("SETTINGS_FILE",        asynParamOctet,   &SettingsFile_);
+	createParam("SETTINGS_SAVE",        asynParamInt32,   &SettingsSave_);
+	createParam("SETTINGS_RESTORE",     asynParamInt32,   &SettingsRestore_);
+	createParam("SETTINGS_WRITES_RBV",  asynParamInt32,   &SettingsWrites_rbv_);
+	createParam("SETTINGS_TIME_RBV",    asynParamFloat64, &SettingsTime_rbv_);
+	setStringParam(SettingsFile_, "");
+	setIntegerParam(SettingsWrites_rbv_, 0);
+	setDoubleParam(SettingsTime_rbv_, 0);
+
+	// Fresh reads of the readbacks
+	createParam("READ_FRESH",           asynParamInt32,   &ReadFresh_);
+	createParam("READ_FRESH_WINDOW",    asynParamFloat64, &ReadFreshWindow_);
+	createParam("READ_DEVICE_RBV",      asynParamInt32,   &ReadDevice_rbv_);
+	createParam("READ_SHARED_RBV",      asynParamInt32,   &ReadShared_rbv_);
+	setIntegerParam(ReadFresh_, 0);
+	setDoubleParam(ReadFreshWindow_, freshWindow_);
+	setIntegerParam(ReadDevice_rbv_, 0);
+	setIntegerParam(ReadShared_rbv_, 0);
+
+	// Interlock watcher
+	createParam("INTERLOCK_PERIOD",     asynParamFloat64, &InterlockPeriod_);
+	createParam("INTERLOCK_STATE_RBV",  asynParamInt32,   &InterlockState_rbv_);
+	createParam("INTERLOCK_RBV",        asynParamInt32,   &Interlock_rbv_);
+	createParam("INTERLOCK_STAMP_RBV",  asynParamOctet,   &InterlockStamp_rbv_);
+	createParam("INTERLOCK_RESET",      asynParamInt32,   &InterlockReset_);
+	createParam("INTERLOCK_LIM_COLUMN", asynParamInt32,   &InterlockLimColumn_);
+	createParam("INTERLOCK_TRANS_COLUMN", asynParamInt32, &InterlockTransColumn_);
+	setDoubleParam(InterlockPeriod_, interlockPeriod_);
+	setIntegerParam(InterlockState_rbv_, 0);
+	setIntegerParam(Interlock_rbv_, 0);
+	setStringParam(InterlockStamp_rbv_, "");
+	setIntegerParam(InterlockLimColumn_, interlockLimColumn_);
+	setIntegerParam(InterlockTransColumn_, interlockTransColumn_);
+	for (int ch = 0; ch < DSCS_STREAM_CHANNELS; ++ch) {
+		char name[64];
+		streamParamName("INTERLOCK_DATA", ch, name, sizeof(name));
+		createParam(name, asynParamInt32Array, &InterlockData_[ch]);
+		streamParamName("INTERLOCK_TIME", ch, name, sizeof(name));
+		createParam(name, asynParamFloat64Array, &InterlockTime_[ch]);
+		streamHistory_[ch] = new dscsStreamHistory<epicsInt32>(DSCS_INTERLOCK_HISTORY, DSCS_TUPLE_SIZE);
+	}
 
-	// InpTransState_rbv (single value)
-	createParam("INP_TRANS_STATE_RBV",  asynParamInt32, &InpTransState_rbv_);
-	
-	// OutTransMat (matrix: one createParam, float64 array, 6x7 = 42 elements)
-	createParam("OUT_TRANS_MAT",        asynParamFloat64Array, OutTransMat_);   // 42 elements
-	
-	// OutTransNFORes_rbv (x, y, z)
-	createParam("OUT_TRANS_NFO_RES_RBV_X", asynParamInt32, &OutTransNFORes_rbv_[0]);
-	createParam("OUT_TRANS_NFO_RES_RBV_Y", asynParamInt32, &OutTransNFORes_rbv_[1]);
-	createParam("OUT_TRANS_NFO_RES_RBV_Z", asynParamInt32, &OutTransNFORes_rbv_[2]);
-	
-	// OutTransSAMRes_rbv (x, y, z)
-	createParam("OUT_TRANS_SAM_RES_RBV_X", asynParamInt32, &OutTransSAMRes_rbv_[0]);
-	createParam("OUT_TRANS_SAM_RES_RBV_Y", asynParamInt32, &OutTransSAMRes_rbv_[1]);
-	createParam("OUT_TRANS_SAM_RES_RBV_Z", asynParamInt32, &OutTransSAMRes_rbv_[2]);
-	
-	// Trajectory
-	createParam("TRAJ_START_X",         asynParamInt32, &TrajStartX_);
-	createParam("TRAJ_START_X_RBV",     asynParamInt32, &TrajStartX_rbv_);
-	createParam("TRAJ_END_X",           asynParamInt32, &TrajEndX_);
-	createParam("TRAJ_END_X_RBV",       asynParamInt32, &TrajEndX_rbv_);
-	createParam("TRAJ_SPEED_X",         asynParamInt32, &TrajSpeedX_);
-	createParam("TRAJ_SPEED_X_RBV",     asynParamInt32, &TrajSpeedX_rbv_);
-	createParam("TRAJ_START_Y",         asynParamInt32, &TrajStartY_);
-	createParam("TRAJ_START_Y_RBV",     asynParamInt32, &TrajStartY_rbv_);
-	createParam("TRAJ_DIST_Y",          asynParamInt32, &TrajDistY_);
-	createParam("TRAJ_DIST_Y_RBV",      asynParamInt32, &TrajDistY_rbv_);
-	createParam("TRAJ_COUNT_Y",         asynParamInt32, &TrajCountY_);
-	createParam("TRAJ_COUNT_Y_RBV",     asynParamInt32, &TrajCountY_rbv_);
-	createParam("TRAJ_TURN_TIME",       asynParamInt32, &TrajTurnTime_);
-	createParam("TRAJ_TURN_TIME_RBV",   asynParamInt32, &TrajTurnTime_rbv_);
-	createParam("TRAJ_POS_TIME",        asynParamInt32, &TrajPosTime_);
-	createParam("TRAJ_POS_TIME_RBV",    asynParamInt32, &TrajPosTime_rbv_);
-	createParam("TRAJ_ANTI_HYST",       asynParamInt32, &TrajAntiHyst_);
-	createParam("TRAJ_ANTI_HYST_RBV",   asynParamInt32, &TrajAntiHyst_rbv_);
-	createParam("TRAJ_SETTINGS",        asynParamInt32, &TrajSettings_);
-	createParam("TRAJ_SETTINGS_RBV",    asynParamInt32, &TrajSettings_rbv_);
-
-	// Force the device to connect now
+	// Stream capture, one per callback channel and one of the merged records
+	for (int ch = 0; ch < DSCS_CAPTURE_CHANNELS; ++ch) {
+		char name[64];
+		captureParamName("CAPTURE_FILE", ch, name, sizeof(name));
+		createParam(name, asynParamOctet, &CaptureFile_[ch]);
+		captureParamName("CAPTURE_CODEC", ch, name, sizeof(name));
+		createParam(name, asynParamInt32, &CaptureCodec_[ch]);
+		captureParamName("CAPTURE_ENABLE", ch, name, sizeof(name));
+		createParam(name, asynParamInt32, &CaptureEnable_[ch]);
+		captureParamName("CAPTURE_SAMPLES_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamFloat64, &CaptureSamples_rbv_[ch]);
+		captureParamName("CAPTURE_BYTES_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamFloat64, &CaptureBytes_rbv_[ch]);
+		captureParamName("CAPTURE_RATIO_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamFloat64, &CaptureRatio_rbv_[ch]);
+		captureParamName("CAPTURE_DROPPED_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamInt32, &CaptureDropped_rbv_[ch]);
+		captureParamName("CAPTURE_MESSAGE_RBV", ch, name, sizeof(name));
+		createParam(name, asynParamOctet, &CaptureMessage_rbv_[ch]);
+		setStringParam(CaptureFile_[ch], "");
+		setIntegerParam(CaptureCodec_[ch], dscsCaptureBitpack);
+		setIntegerParam(CaptureEnable_[ch], 0);
+		setDoubleParam(CaptureSamples_rbv_[ch], 0);
+		setDoubleParam(CaptureBytes_rbv_[ch], 0);
+		setDoubleParam(CaptureRatio_rbv_[ch], 0);
+		setIntegerParam(CaptureDropped_rbv_[ch], 0);
+		setStringParam(CaptureMessage_rbv_[ch], "");
+		captureQueue_[ch] = new dscsStreamQueue<epicsInt32, dscsCapturePacket>(DSCS_CAPTURE_QUEUE_PACKETS,
+		                                                                       DSCS_CAPTURE_QUEUE_VALUES);
+	}
+	captureEvent_ = epicsEventMustCreate(epicsEventEmpty);
+
+	// Replay of a capture
+	createParam("REPLAY_FILE",          asynParamOctet,   &ReplayFile_);
+	createParam("REPLAY_CHANNEL",       asynParamInt32,   &ReplayChannel_);
+	createParam("REPLAY_SPEED",         asynParamFloat64, &ReplaySpeed_);
+	createParam("REPLAY_PACKET",        asynParamInt32,   &ReplayPacket_);
+	createParam("REPLAY_START",         asynParamInt32,   &ReplayStart_);
+	createParam("REPLAY_STOP",          asynParamInt32,   &ReplayStop_);
+	createParam("REPLAY_STATE_RBV",     asynParamInt32,   &ReplayState_rbv_);
+	createParam("REPLAY_SAMPLES_RBV",   asynParamFloat64, &ReplaySamples_rbv_);
+	createParam("REPLAY_PROGRESS_RBV",  asynParamFloat64, &ReplayProgress_rbv_);
+	createParam("REPLAY_RATE_RBV",      asynParamFloat64, &ReplayRate_rbv_);
+	createParam("REPLAY_MESSAGE_RBV",   asynParamOctet,   &ReplayMessage_rbv_);
+	setStringParam(ReplayFile_, "");
+	setIntegerParam(ReplayChannel_, 0);
+	setDoubleParam(ReplaySpeed_, 1);
+	setIntegerParam(ReplayPacket_, DSCS_REPLAY_PACKET);
+	setIntegerParam(ReplayState_rbv_, replayState_);
+	setDoubleParam(ReplaySamples_rbv_, 0);
+	setDoubleParam(ReplayProgress_rbv_, 0);
+	setDoubleParam(ReplayRate_rbv_, 0);
+	setStringParam(ReplayMessage_rbv_, "");
+	replayEvent_ = epicsEventMustCreate(epicsEventEmpty);
+
+	// Fly-scan planner
+	createParam("SCAN_START_X",         asynParamFloat64, &ScanStartX_);
+	createParam("SCAN_START_Y",         asynParamFloat64, &ScanStartY_);
+	createParam("SCAN_WIDTH",           asynParamFloat64, &ScanWidth_);
+	createParam("SCAN_HEIGHT",          asynParamFloat64, &ScanHeight_);
+	createParam("SCAN_PIXEL",           asynParamFloat64, &ScanPixel_);
+	createParam("SCAN_DWELL",           asynParamFloat64, &ScanDwell_);
+	createParam("SCAN_TURN_TIME",       asynParamFloat64, &ScanTurnTime_);
+	createParam("SCAN_POS_TIME",        asynParamFloat64, &ScanPosTime_);
+	createParam("SCAN_ANTI_HYST",       asynParamFloat64, &ScanAntiHyst_);
+	createParam("SCAN_MODE",            asynParamInt32,   &ScanMode_);
+	createParam("SCAN_PLAN",            asynParamInt32,   &ScanPlan_);
+	createParam("SCAN_UPLOAD",          asynParamInt32,   &ScanUpload_);
+	createParam("PLAN_VALID_RBV",       asynParamInt32,   &PlanValid_rbv_);
+	createParam("PLAN_MESSAGE_RBV",     asynParamOctet,   &PlanMessage_rbv_);
+	createParam("PLAN_PIXELS_RBV",      asynParamInt32,   &PlanPixels_rbv_);
+	createParam("PLAN_LINES_RBV",       asynParamInt32,   &PlanLines_rbv_);
+	createParam("PLAN_DWELL_RBV",       asynParamFloat64, &PlanDwell_rbv_);
+	createParam("PLAN_LINE_TIME_RBV",   asynParamFloat64, &PlanLineTime_rbv_);
+	createParam("PLAN_DURATION_RBV",    asynParamFloat64, &PlanDuration_rbv_);
+	createParam("PLAN_SAMPLES_RBV",     asynParamFloat64, &PlanSamples_rbv_);
+	setIntegerParam(ScanMode_, dscsTrajFWBW);
+	setIntegerParam(PlanValid_rbv_, 0);
+	setStringParam(PlanMessage_rbv_, "");
+
+	// Scan queue
+	createParam("SCAN_QUEUE_TILES",     asynParamFloat64Array, &ScanQueueTiles_);
+	createParam("SCAN_QUEUE_FILE",      asynParamOctet,   &ScanQueueFile_);
+	createParam("SCAN_QUEUE_LOAD",      asynParamInt32,   &ScanQueueLoad_);
+	createParam("SCAN_QUEUE_START",     asynParamInt32,   &ScanQueueStart_);
+	createParam("SCAN_QUEUE_STOP",      asynParamInt32,   &ScanQueueStop_);
+	createParam("SCAN_QUEUE_CLEAR",     asynParamInt32,   &ScanQueueClear_);
+	createParam("SCAN_QUEUE_SETTLE",    asynParamFloat64, &ScanQueueSettle_);
+	createParam("SCAN_QUEUE_STATE_RBV", asynParamInt32,   &ScanQueueState_rbv_);
+	createParam("SCAN_QUEUE_LENGTH_RBV", asynParamInt32,  &ScanQueueLength_rbv_);
+	createParam("SCAN_QUEUE_TILE_RBV",  asynParamInt32,   &ScanQueueTile_rbv_);
+	createParam("SCAN_QUEUE_PROGRESS_RBV", asynParamFloat64, &ScanQueueProgress_rbv_);
+	createParam("SCAN_QUEUE_ETA_RBV",   asynParamFloat64, &ScanQueueEta_rbv_);
+	createParam("SCAN_QUEUE_GAP_RBV",   asynParamFloat64, &ScanQueueGap_rbv_);
+	setStringParam(ScanQueueFile_, "");
+	setIntegerParam(ScanQueueState_rbv_, scanState_);
+	setIntegerParam(ScanQueueLength_rbv_, 0);
+	setIntegerParam(ScanQueueTile_rbv_, 0);
+	setDoubleParam(ScanQueueProgress_rbv_, 0);
+	setDoubleParam(ScanQueueEta_rbv_, 0);
+	setDoubleParam(ScanQueueGap_rbv_, 0);
+	setDoubleParam(ScanQueueSettle_, DSCS_SCAN_SETTLE);
+	scanEvent_ = epicsEventMustCreate(epicsEventEmpty);
+
+	// Trajectory progress
+	createParam("TRAJ_START",           asynParamInt32,   &TrajStart_);
+	createParam("TRAJ_X_COLUMN",        asynParamInt32,   &TrajXColumn_);
+	createParam("TRAJ_RUNNING_RBV",     asynParamInt32,   &TrajRunning_rbv_);
+	createParam("TRAJ_STREAM_CLOCK_RBV", asynParamInt32,  &TrajStreamClock_rbv_);
+	createParam("TRAJ_MEASURED_RBV",    asynParamInt32,   &TrajMeasured_rbv_);
+	createParam("TRAJ_LINE_RBV",        asynParamInt32,   &TrajLine_rbv_);
+	createParam("TRAJ_FRACTION_RBV",    asynParamFloat64, &TrajFraction_rbv_);
+	createParam("TRAJ_REMAINING_RBV",   asynParamFloat64, &TrajRemaining_rbv_);
+	createParam("TRAJ_LINE_RATE_RBV",   asynParamFloat64, &TrajLineRate_rbv_);
+	createParam("TRAJ_PLAN_LINE_RATE_RBV", asynParamFloat64, &TrajPlanLineRate_rbv_);
+	setIntegerParam(TrajXColumn_, trajXColumn_);
+	setIntegerParam(TrajRunning_rbv_, 0);
+	setIntegerParam(TrajStreamClock_rbv_, 0);
+	setIntegerParam(TrajMeasured_rbv_, 0);
+	setIntegerParam(TrajLine_rbv_, 0);
+	setDoubleParam(TrajFraction_rbv_, 0);
+	setDoubleParam(TrajRemaining_rbv_, 0);
+	setDoubleParam(TrajLineRate_rbv_, 0);
+	setDoubleParam(TrajPlanLineRate_rbv_, 0);
+
+	// PI step test
+	createParam("TUNE_AXIS",            asynParamInt32,   &TuneAxis_);
+	createParam("TUNE_STEP",            asynParamInt32,   &TuneStep_);
+	createParam("TUNE_DURATION",        asynParamFloat64, &TuneDuration_);
+	createParam("TUNE_BAND",            asynParamFloat64, &TuneBand_);
+	createParam("TUNE_START",           asynParamInt32,   &TuneStart_);
+	createParam("TUNE_STATE_RBV",       asynParamInt32,   &TuneState_rbv_);
+	createParam("TUNE_MESSAGE_RBV",     asynParamOctet,   &TuneMessage_rbv_);
+	for (int axis = 0; axis < DSCS_TUNE_AXES; ++axis) {
+		const char *suffix = dscsChannelSuffix(dscsChanXYZ, axis);
+		char name[64];
+		snprintf(name, sizeof(name), "TUNE_COLUMN%s", suffix);
+		createParam(name, asynParamInt32, &TuneColumn_[axis]);
+		snprintf(name, sizeof(name), "TUNE_RISE_RBV%s", suffix);
+		createParam(name, asynParamFloat64, &TuneRise_rbv_[axis]);
+		snprintf(name, sizeof(name), "TUNE_OVERSHOOT_RBV%s", suffix);
+		createParam(name, asynParamFloat64, &TuneOvershoot_rbv_[axis]);
+		snprintf(name, sizeof(name), "TUNE_SETTLING_RBV%s", suffix);
+		createParam(name, asynParamFloat64, &TuneSettling_rbv_[axis]);
+		snprintf(name, sizeof(name), "TUNE_ERROR_RBV%s", suffix);
+		createParam(name, asynParamFloat64, &TuneError_rbv_[axis]);
+		snprintf(name, sizeof(name), "TUNE_TRACE%s", suffix);
+		createParam(name, asynParamFloat64Array, &TuneTrace_[axis]);
+		snprintf(name, sizeof(name), "TUNE_TRACE_TIME%s", suffix);
+		createParam(name, asynParamFloat64Array, &TuneTraceTime_[axis]);
+		setIntegerParam(TuneColumn_[axis], -1);
+	}
+	setIntegerParam(TuneAxis_, 0);
+	setIntegerParam(TuneStep_, 0);
+	setDoubleParam(TuneDuration_, 0.1);
+	setDoubleParam(TuneBand_, 0.02);
+	setIntegerParam(TuneState_rbv_, tuneState_);
+	setStringParam(TuneMessage_rbv_, "");
+
+	// Frequency response sweep
+	createParam("BODE_AXIS",            asynParamInt32,   &BodeAxis_);
+	createParam("BODE_START",           asynParamFloat64, &BodeStart_);
+	createParam("BODE_STOP",            asynParamFloat64, &BodeStop_);
+	createParam("BODE_POINTS",          asynParamInt32,   &BodePoints_);
+	createParam("BODE_AMP",             asynParamInt32,   &BodeAmp_);
+	createParam("BODE_CYCLES",          asynParamInt32,   &BodeCycles_);
+	createParam("BODE_SETTLE",          asynParamFloat64, &BodeSettle_);
+	createParam("BODE_RUN",             asynParamInt32,   &BodeRun_);
+	createParam("BODE_ABORT",           asynParamInt32,   &BodeAbort_);
+	createParam("BODE_STATE_RBV",       asynParamInt32,   &BodeState_rbv_);
+	createParam("BODE_POINT_RBV",       asynParamInt32,   &BodePoint_rbv_);
+	createParam("BODE_MESSAGE_RBV",     asynParamOctet,   &BodeMessage_rbv_);
+	createParam("BODE_FREQ",            asynParamFloat64Array, &BodeFreq_);
+	createParam("BODE_MAG",             asynParamFloat64Array, &BodeMag_);
+	createParam("BODE_PHASE",           asynParamFloat64Array, &BodePhase_);
+	for (int axis = 0; axis < DSCS_TUNE_AXES; ++axis) {
+		char name[64];
+		snprintf(name, sizeof(name), "BODE_REF_COLUMN%s", dscsChannelSuffix(dscsChanXYZ, axis));
+		createParam(name, asynParamInt32, &BodeRefColumn_[axis]);
+		setIntegerParam(BodeRefColumn_[axis], -1);
+	}
+	setIntegerParam(BodeAxis_, 0);
+	setDoubleParam(BodeStart_, 10);
+	setDoubleParam(BodeStop_, 1000);
+	setIntegerParam(BodePoints_, 50);
+	setIntegerParam(BodeAmp_, 0);
+	setIntegerParam(BodeCycles_, 20);
+	setDoubleParam(BodeSettle_, 5);
+	setIntegerParam(BodeState_rbv_, bodeState_);
+	setIntegerParam(BodePoint_rbv_, 0);
+	setStringParam(BodeMessage_rbv_, "");
+
+	// Force the device to connect now. If the controller isn't there yet the
+	// poller keeps retrying.
 	connect(this->pasynUserSelf);
 
 	// status = pasynOctetSyncIO->connect(dscsAsynPortName, 0, &pasynUserdscsAsyn_, NULL);
@@ -368,11 +513,53 @@ dscsAsyn::dscsAsyn(const char *portName, const char *dscsAsynPortName, int dscsI
   //setIntegerParam(variable_, 1);
   
 	// Start the poller
-  epicsThreadCreate("dscsAsynPoller", 
+  threads_[dscsThreadPoller] = epicsThreadCreate("dscsAsynPoller", 
       epicsThreadPriorityLow,
       epicsThreadGetStackSize(epicsThreadStackMedium),
       (EPICSTHREADFUNC)pollerThreadC,
       this);
+
+	// Start the setpoint writer
+  threads_[dscsThreadWriter] = epicsThreadCreate("dscsAsynWriter", 
+      epicsThreadPriorityMedium,
+      epicsThreadGetStackSize(epicsThreadStackMedium),
+      (EPICSTHREADFUNC)writerThreadC,
+      this);
+
+	// Start the stream publisher; it idles until STREAM_ENABLE is set
+  threads_[dscsThreadStream] = epicsThreadCreate("dscsAsynStream", 
+      epicsThreadPriorityMedium,
+      epicsThreadGetStackSize(epicsThreadStackMedium),
+      (EPICSTHREADFUNC)streamThreadC,
+      this);
+
+	// Start the interlock watcher
+  threads_[dscsThreadWatch] = epicsThreadCreate("dscsAsynWatch", 
+      epicsThreadPriorityHigh,
+      epicsThreadGetStackSize(epicsThreadStackMedium),
+      (EPICSTHREADFUNC)watchThreadC,
+      this);
+
+	// Start the scan queue
+  threads_[dscsThreadScan] = epicsThreadCreate("dscsAsynScan", 
+      epicsThreadPriorityHigh,
+      epicsThreadGetStackSize(epicsThreadStackMedium),
+      (EPICSTHREADFUNC)scanThreadC,
+      this);
+
+	// Start the capture writer; it idles until a CAPTURE_ENABLE is set
+  threads_[dscsThreadCapture] = epicsThreadCreate("dscsAsynCapture", 
+      epicsThreadPriorityMedium,
+      epicsThreadGetStackSize(epicsThreadStackMedium),
+      (EPICSTHREADFUNC)captureThreadC,
+      this);
+
+	// Start the capture replay; it idles until REPLAY_START is set
+  threads_[dscsThreadReplay] = epicsThreadCreate("dscsAsynReplay", 
+      epicsThreadPriorityMedium,
+      epicsThreadGetStackSize(epicsThreadStackMedium),
+      (EPICSTHREADFUNC)replayThreadC,
+      this);
 	
   //epicsThreadSleep(5.0);
 }
@@ -382,53 +569,62 @@ asynStatus dscsAsyn::connect(asynUser *pasynUser)
 	asynStatus status;
 	static const char *functionName = "connect";
 	int errorCode;
-	unsigned int devCount; // number of dscs devices available
-	unsigned int devNo; 
-	
-	printf("devCount before setting: %d\n", devCount);
+	unsigned int devCount = 0; // number of dscs devices available
+	unsigned int devNo;
 
+	asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+		"%s:%s, port %s, connecting to device ID %d\n",
+		driverName, functionName, this->portName, this->deviceId);
 
-    	asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
-        	"%s:%s: Connecting...\n", driverName, functionName);
+	// The poller retries this every reconnectTime_ while the link is down.
+	// Discovery and the device search can take a while on the USB stack, so
+	// they run without the port lock, and a missing controller is only
+	// reported as flow.
 
 	// discover available devices. IfAll - both usb and ethernet
-  	errorCode = DSCS_discover(IfAll, &devCount);
-
-	printf("errorCode after discover: %d\n", devCount);
-
-	printf("devCount after setting: %d\n", devCount);
-
-  	if (devCount <= 0) {
-		printf( "No devices found\n" );
+	errorCode = DSCS_discover(IfAll, &devCount);
+	if (errorCode != DSCS_Ok) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, DSCS_discover failed: %s\n",
+			driverName, functionName, this->portName, getMessage(errorCode));
 		return asynError;
 	}
 
 	// search through available devices for desired ID
-  	for (devNo = 0; devNo < devCount; devNo++) {
+	for (devNo = 0; devNo < devCount; devNo++) {
 		int id = 0;
 		char addr[20], serialNo[20];
-    		errorCode = DSCS_getDeviceInfo(devNo, &id, serialNo, addr);
-    		checkError("DSCS_getDeviceInfo", errorCode);
-    		printf( "Device found: No=%d Id=%d SN=%s Addr=%s\n", devNo, id, serialNo, addr );   
-		if (id == this->deviceId) {
-			printf("connecting to device with ID %d\n", id);
-			this->deviceNo = devNo;
-			break;
-		}
-		// desired ID not found:
-		if (devNo == devCount-1) {
-			printf("ID not found\n");
-			return asynError;
+		errorCode = DSCS_getDeviceInfo(devNo, &id, serialNo, addr);
+		if (errorCode != DSCS_Ok) {
+			asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+				"%s:%s, port %s, DSCS_getDeviceInfo(%u) failed: %s\n",
+				driverName, functionName, this->portName, devNo, getMessage(errorCode));
+			continue;
 		}
+		asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+			"%s:%s, port %s, device found: No=%u Id=%d SN=%s Addr=%s\n",
+			driverName, functionName, this->portName, devNo, id, serialNo, addr);
+		if (id == this->deviceId) break;
+	}
+	if (devNo == devCount) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+			"%s:%s, port %s, device ID %d not found among %u devices\n",
+			driverName, functionName, this->portName, this->deviceId, devCount);
+		return asynError;
 	}
-	
 
-	this->lock();
-	errorCode = DSCS_disconnect(this->deviceNo); // disconnect first
+	this->lock(dscsLockConnect);
+	this->deviceNo = devNo;
+	DSCS_disconnect(this->deviceNo); // disconnect first
 	errorCode = DSCS_connect(this->deviceNo);
 	this->unlock();
 
-  	checkError("DSCS_connect", errorCode);
+	if (errorCode != DSCS_Ok) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, DSCS_connect failed: %s\n",
+			driverName, functionName, this->portName, getMessage(errorCode));
+		return asynError;
+	}
 
     /* We found the controller and everything is OK.  Signal to asynManager that we are connected. */
     status = pasynManager->exceptionConnect(this->pasynUserSelf);
@@ -439,6 +635,27 @@ asynStatus dscsAsyn::connect(asynUser *pasynUser)
         return asynError;
     }
 
+	this->lock(dscsLockConnect);
+	this->connected_ = true;
+	this->autoReconnect_ = true;
+	setIntegerParam(Connected_rbv_, 1);
+	// the controller forgets the data output setting with the connection
+	if (this->streamEnabled_) enableStream(true);
+	status = seedSetpoints();
+	callParamCallbacks();
+	this->unlock();
+
+	// the link stays up for a partial seed; the unseeded setpoints alarm
+	if (status != asynSuccess) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, setpoints not fully loaded from the controller%s\n",
+			driverName, functionName, this->portName,
+			status == asynDisconnected ? ", link lost" : "");
+		if (status == asynDisconnected) return asynError;
+	}
+	// setpoints queued while the link was down
+	epicsEventSignal(writeEvent_);
+
  	return asynSuccess;
 }
 
@@ -451,8 +668,12 @@ asynStatus dscsAsyn::disconnect(asynUser *pasynUser)
     asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
         "%s:%s: Disconnecting...\n", driverName, functionName);
 
-	this->lock();
+	this->lock(dscsLockDisconnect);
   	errorCode = DSCS_disconnect(this->deviceNo);
+	// an explicit disconnect is not a link failure, so don't fight it
+	this->connected_ = false;
+	this->autoReconnect_ = false;
+	setIntegerParam(Connected_rbv_, 0);
 	this->unlock();
 
   	checkError("DSCS_disconnect", errorCode);
@@ -475,6 +696,134 @@ dscsAsyn::~dscsAsyn()
 {
 	// Force the controller to disconnect
 	disconnect(this->pasynUserSelf);
+	dscsAsyn *owner = this;
+	streamDriver.compare_exchange_strong(owner, NULL);
+}
+
+/*
+ * Called with the port lock held when a vendor call reports a link-class
+ * error. Marks the port disconnected so asynManager fails queued requests
+ * immediately instead of each one waiting out a USB timeout, and leaves
+ * reconnecting to the poller.
+ */
+void dscsAsyn::linkLost()
+{
+	static const char *functionName = "linkLost";
+
+	if (!this->connected_) return;
+
+	DSCS_disconnect(this->deviceNo);
+	this->connected_ = false;
+	this->autoReconnect_ = true;
+	this->restorePending_ = true;
+	this->reconnectCount_++;
+	setIntegerParam(Connected_rbv_, 0);
+	setIntegerParam(Reconnects_rbv_, this->reconnectCount_);
+
+	if (pasynManager->exceptionDisconnect(this->pasynUserSelf)) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s: error calling pasynManager->exceptionDisconnect, error=%s\n",
+			driverName, functionName, pasynUserSelf->errorMessage);
+	}
+}
+
+/*
+ * Load the controller's current value into every setpoint parameter nobody
+ * has written yet, and into its readback. The first connect happens in
+ * dscsAsynConfig, before iocInit, so output records initialise from the
+ * controller instead of from zero and a PINI or autosave write can't move a
+ * stage somewhere it wasn't. Setpoints written through the driver keep the
+ * operator's value; restoreSetpoints sends those. Writes still queued from
+ * before the first seed came from PINI or autosave while the controller was
+ * absent, not from an operator who saw its state, so they are dropped and
+ * seeded like the rest. A setpoint the controller refuses to report is left
+ * unseeded with an error status, so its record alarms, and the sweep goes on;
+ * only a lost link ends it. Returns asynError if any setpoint could not be
+ * seeded. Called with the port lock held.
+ */
+asynStatus dscsAsyn::seedSetpoints()
+{
+	static const char *functionName = "seedSetpoints";
+	asynStatus status;
+	char name[64];
+	double value;
+	int seeded = 0, failed = 0;
+
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		const dscsParamDesc &desc = dscsParamTable[row];
+		if (!(desc.flags & dscsParamSetpoint) || !desc.get) continue;
+
+		for (int chan = 0; chan < dscsChannelCount(desc.chans); ++chan) {
+			int function = param_[row][chan];
+			if (!seeded_ && takePendingWrite(function, &value)) {
+				dscsParamName(desc, chan, false, name, sizeof(name));
+				asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+					"%s:%s, port %s, %s = %g written before the controller was seen, dropped\n",
+					driverName, functionName, this->portName, name, value);
+			}
+			if (writtenSetpoints_.count(function) || pendingWrites_.count(function)) continue;
+
+			dscsParamName(desc, chan, false, name, sizeof(name));
+			status = checkStatus(name, desc.get(deviceNo, chan, &value));
+			if (status == asynDisconnected) return status;
+			if (status != asynSuccess) {
+				asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+					"%s:%s, port %s, cannot read %s from the controller, not seeded\n",
+					driverName, functionName, this->portName, name);
+				setParamStatus(function, status);
+				failed++;
+				continue;
+			}
+			setParamStatus(function, asynSuccess);
+			setSetpointValue(row, chan, value);
+			seeded++;
+		}
+	}
+
+	seeded_ = true;
+	asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+		"%s:%s, port %s, %d setpoints loaded from the controller, %d failed\n",
+		driverName, functionName, this->portName, seeded, failed);
+	return failed ? asynError : asynSuccess;
+}
+
+/*
+ * Re-send every setpoint that was written before the link dropped. The
+ * controller may have been power cycled, so the cached parameter values are
+ * the only record of what the operator asked for. Setpoints never written
+ * through the driver are left alone. Called with the port lock held.
+ */
+void dscsAsyn::restoreSetpoints()
+{
+	static const char *functionName = "restoreSetpoints";
+	double value;
+	asynStatus status;
+	const dscsParamRef *ref;
+	const dscsLimitPair *pair;
+
+	for (std::map<int, double>::const_iterator it = writtenSetpoints_.begin();
+	     it != writtenSetpoints_.end(); ++it) {
+		// the parameter may hold a value the controller rejected since
+		value = it->second;
+		ref = findParamRef(it->first);
+		pair = ref ? findLimitPair(ref->row) : NULL;
+		if (pair) {
+			// both halves are always written together; send the pair once
+			std::map<int, double>::const_iterator max = writtenSetpoints_.find(param_[pair->max][0]);
+			if (ref->row != pair->min || max == writtenSetpoints_.end()) continue;
+			status = sendLimitPair(*pair, value, max->second);
+		} else {
+			status = writeSetpoint(it->first, value);
+		}
+		if (status != asynSuccess) {
+			asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+				"%s:%s: failed to restore function %d, value %g\n",
+				driverName, functionName, it->first, value);
+			// try again on the next cycle if the link dropped again
+			if (!this->connected_) return;
+		}
+	}
+	this->restorePending_ = false;
 }
 
 /*
@@ -489,462 +838,2088 @@ void dscsAsyn::pollerThread()
 
   // Other variable declarations
     asynStatus comStatus;
+    epicsUInt64 cycleStart, now;
   
   while (1)
   {
     
-    lock();
-
-    int value, errorCode;
-    unsigned int uvalue;
-    double dvalue;
-    bln32 bvalue;
-    DSCS_TargetMode targetMode;
-    DSCS_LimiterState limiterState;
-    DSCS_InputTransformationState inTransState;
-
-    // Axis enum mapping
-    const DSCS_Axis axes[3] = {DSCS_AxisX, DSCS_AxisY, DSCS_AxisZ};
-
-    // AUX channel enum mapping
-    const DSCS_AUX_ADC auxChans[4] = {DSCS_AUX_0, DSCS_AUX_1, DSCS_AUX_2, DSCS_AUX_3};
-
-    // XZ/ZX enum mapping
-    const DSCS_XZ_ZX xz_zx[2] = {DSCS_XZ, DSCS_ZX};
-
-    // --- OSA_PS_rbv_[2] ---
-    for (int i = 0; i < 2; ++i) {
-        errorCode = DSCS_getOSA_PS(deviceNo, axes[i], &value);
-        checkError("DSCS_getOSA_PS", errorCode);
-        setIntegerParam(OSA_PS_rbv_[i], value);
+    lock(dscsLockPoller);
+
+    // Polling is suspended while the link is down; only reconnect attempts
+    // are made, at reconnectTime_ intervals instead of every poll cycle.
+    // connect() takes the lock itself, only around the state it changes.
+    if (!connected_) {
+      if (autoReconnect_) {
+        unlock();
+        connect(this->pasynUserSelf);
+        lock(dscsLockPoller);
+      }
+      if (!connected_) {
+        pollTiming_.deadline = 0; // restart the schedule once reconnected
+        publishLockStats(epicsMonotonicGet());
+        callParamCallbacks();
+        unlock();
+        epicsThreadSleep(reconnectTime_);
+        continue;
+      }
     }
 
-    // --- BS_PS_rbv_[2] ---
-    for (int i = 0; i < 2; ++i) {
-        errorCode = DSCS_getBS_PS(deviceNo, axes[i], &value);
-        checkError("DSCS_getBS_PS", errorCode);
-        setIntegerParam(BS_PS_rbv_[i], value);
-    }
+    cycleStart = epicsMonotonicGet();
+    if (pollTiming_.deadline == 0) pollTiming_.deadline = cycleStart;
 
-    // --- AUX_DAC_rbv_[4] ---
-    for (int i = 0; i < 4; ++i) {
-        errorCode = DSCS_getAUX_DAC(deviceNo, auxChans[i], &value);
-        checkError("DSCS_getAUX_DAC", errorCode);
-        setIntegerParam(AUX_DAC_rbv_[i], value);
+    if (restorePending_) {
+      restoreSetpoints();
     }
 
-    // --- NFO_PS_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getNFO_PS(deviceNo, axes[i], &value);
-        checkError("DSCS_getNFO_PS", errorCode);
-        setIntegerParam(NFO_PS_rbv_[i], value);
+    comStatus = pollReadbacks(dscsPollFast);
+    if (comStatus == asynSuccess && pollCycle_ % slowPollDivisor_ == 0) {
+      comStatus = pollReadbacks(dscsPollSlow);
     }
-
-    // --- SAM_PS_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getSAM_PS(deviceNo, axes[i], &value);
-        checkError("DSCS_getSAM_PS", errorCode);
-        setIntegerParam(SAM_PS_rbv_[i], value);
+    pollCycle_++;
+    publishHistories(epicsMonotonicGet());
+    publishLockStats(epicsMonotonicGet());
+    if (comStatus == asynDisconnected) {
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+          "%s:%s: link to device lost, suspending poll\n", driverName, functionName);
+      linkLost();
     }
 
-    // --- NFO_SG_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getNFO_SG(deviceNo, axes[i], &value);
-        checkError("DSCS_getNFO_SG", errorCode);
-        setIntegerParam(NFO_SG_rbv_[i], value);
+    // Schedule against absolute deadlines so the period does not stretch by
+    // the length of the sweep. A sweep that runs past the next deadline is an
+    // overrun; the missed slots are dropped rather than run back to back.
+    now = epicsMonotonicGet();
+    updatePollTiming(cycleStart, now);
+    pollTiming_.deadline += (epicsUInt64)(pollTime_ * 1e9);
+    if (pollTiming_.deadline <= now) {
+      pollTiming_.overruns++;
+      setIntegerParam(PollOverruns_rbv_, pollTiming_.overruns);
+      pollTiming_.deadline = now;
     }
 
-    // --- SAM_CP_D_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getSAM_CP_D(deviceNo, axes[i], &value);
-        checkError("DSCS_getSAM_CP_D", errorCode);
-        setIntegerParam(SAM_CP_D_rbv_[i], value);
-    }
+    updateTimeStamp(); // don't publish readbacks with the last stream packet's time
+    callParamCallbacks();
+    unlock();
 
-    // --- XZ_ZX_rbv_[2] ---
-    for (int i = 0; i < 2; ++i) {
-        errorCode = DSCS_getXZ_ZX(deviceNo, xz_zx[i], &value);
-        checkError("DSCS_getXZ_ZX", errorCode);
-        setIntegerParam(XZ_ZX_rbv_[i], value);
-    }
+    epicsThreadSleep((pollTiming_.deadline - now) / 1e9);
 
-    // --- AUX_ADC_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getAUX_ADC(deviceNo, auxChans[i], &value);
-        checkError("DSCS_getAUX_ADC", errorCode);
-        setIntegerParam(AUX_ADC_rbv_[i], value);
-    }
+  }
+}
 
-    // --- NFO_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getNFO(deviceNo, axes[i], &value);
-        checkError("DSCS_getNFO", errorCode);
-        setIntegerParam(NFO_rbv_[i], value);
+/*
+ * Update the poll timing PVs for the cycle that started at cycleStart and
+ * ended at cycleEnd (monotonic ns). The achieved period and its jitter are
+ * exponentially weighted averages of the start-to-start interval. Called
+ * with the port lock held.
+ */
+void dscsAsyn::updatePollTiming(epicsUInt64 cycleStart, epicsUInt64 cycleEnd)
+{
+    dscsPollTiming &t = pollTiming_;
+    double cycle = (cycleEnd - cycleStart) / 1e9;
+
+    t.lastCycle = cycle;
+    if (cycle > t.maxCycle) t.maxCycle = cycle;
+
+    if (t.lastStart != 0) {
+        double period = (cycleStart - t.lastStart) / 1e9;
+        double error = period - pollTime_;
+        if (t.avgPeriod == 0) {
+            t.avgPeriod = period;
+            t.jitterVar = error * error;
+        } else {
+            t.avgPeriod += POLL_STATS_WEIGHT * (period - t.avgPeriod);
+            t.jitterVar += POLL_STATS_WEIGHT * (error * error - t.jitterVar);
+        }
+        setDoubleParam(PollRate_rbv_, t.avgPeriod > 0 ? 1.0 / t.avgPeriod : 0);
+        setDoubleParam(PollJitter_rbv_, sqrt(t.jitterVar));
     }
+    t.lastStart = cycleStart;
 
-    // --- SAM_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getSAM(deviceNo, axes[i], &value);
-        checkError("DSCS_getSAM", errorCode);
-        setIntegerParam(SAM_rbv_[i], value);
-    }
+    setDoubleParam(PollLastCycle_rbv_, t.lastCycle);
+    setDoubleParam(PollMaxCycle_rbv_, t.maxCycle);
+}
 
-    // --- SetptFreq_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getSetpointModulationFrequency(deviceNo, axes[i], &value);
-        checkError("DSCS_getSetpointModulationFrequency", errorCode);
-        setIntegerParam(SetptFreq_rbv_[i], value);
-    }
+/*
+ * Clear the poll timing statistics, e.g. after the period was changed.
+ * Called with the port lock held.
+ */
+void dscsAsyn::resetPollTiming()
+{
+    epicsUInt64 deadline = pollTiming_.deadline;
+
+    pollTiming_ = dscsPollTiming();
+    pollTiming_.deadline = deadline;
+    setDoubleParam(PollLastCycle_rbv_, 0);
+    setDoubleParam(PollMaxCycle_rbv_, 0);
+    setDoubleParam(PollRate_rbv_, 0);
+    setDoubleParam(PollJitter_rbv_, 0);
+    setIntegerParam(PollOverruns_rbv_, 0);
+}
+
+/*
+ * The port lock. Every lock() and unlock() of the driver goes through here,
+ * as do those of asynPortDriver around asyn requests, so the time each
+ * call site waits for the lock and then holds it can be told apart. Only
+ * the outermost acquisition of a thread counts: the lock is recursive, and
+ * a nested lock() neither waits nor ends the hold. The statistics are
+ * updated while the lock is held, so they need no lock of their own.
+ */
+asynStatus dscsAsyn::lock()
+{
+    return lock(dscsLockAsyn);
+}
 
-    // --- SetptPhase_rbv_[3] ---
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getSetpointModulationPhase(deviceNo, axes[i], &value);
-        checkError("DSCS_getSetpointModulationPhase", errorCode);
-        setIntegerParam(SetptPhase_rbv_[i], value);
+asynStatus dscsAsyn::lock(dscsLockSite site)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    asynStatus status = asynPortDriver::lock();
+
+    if (status == asynSuccess && lockDepth_++ == 0) {
+        lockGranted_ = epicsMonotonicGet();
+        lockSite_ = site;
+        lockStats_[site].count++;
+        lockStats_[site].wait.add(lockGranted_ - start);
     }
+    return status;
+}
 
-    // --- SetptAmp_rbv_[3] ---
-	    printf("getting setptamp");
-    for (int i = 0; i < 3; ++i) {
-        errorCode = DSCS_getSetpointModulationAmplitude(deviceNo, axes[i], &value);
-        checkError("DSCS_getSetpointModulationAmplitude", errorCode);
-        setIntegerParam(SetptAmp_rbv_[i], value);
+asynStatus dscsAsyn::unlock()
+{
+    if (lockDepth_ > 0 && --lockDepth_ == 0) {
+        lockStats_[lockSite_].hold.add(epicsMonotonicGet() - lockGranted_);
     }
+    return asynPortDriver::unlock();
+}
 
-    // CANT FIND SYMBOL
-    // // --- ExtADCShift_rbv_ ---
-    // errorCode = DSCS_getExternalADCShift(deviceNo, &value);
-    // checkError("DSCS_getExternalADCShift", errorCode);
-    // setIntegerParam(ExtADCShift_rbv_, value);
-
-    // // --- PIEnNFO_rbv_[3] (bln32) ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerEnabledNFO(deviceNo, axes[i], &bvalue);
-    //     checkError("DSCS_getPIControllerEnabledNFO", errorCode);
-    //     setIntegerParam(PIEnNFO_rbv_[i], bvalue);
-    // }
-
-    // // --- PIIValNFO_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //         printf("before get");
-    //     errorCode = DSCS_getPIControllerIValueNFO(deviceNo, axes[i], &dvalue);
-    //         printf("after get");
-    //     checkError("DSCS_getPIControllerIValueNFO", errorCode);
-    //     setDoubleParam(PIIValNFO_rbv_[i], dvalue);
-    // }
-
-    // // --- PIPValNFO_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerPValueNFO(deviceNo, axes[i], &value);
-    //     checkError("DSCS_getPIControllerPValueNFO", errorCode);
-    //     setIntegerParam(PIPValNFO_rbv_[i], value);
-    // }
-
-    // // --- PILimNFO_rbv_ ---
-    // errorCode = DSCS_getPIControllerLimitNFO(deviceNo, &value);
-    // checkError("DSCS_getPIControllerLimitNFO", errorCode);
-    // setIntegerParam(PILimNFO_rbv_, value);
-
-    // // --- PIAvgNFO_rbv_ ---
-    // errorCode = DSCS_getPIControllerAverageNFO(deviceNo, (unsigned short*)&value);
-    // value = value & 0xFFFF; // mask to range of unsigned short
-    // checkError("DSCS_getPIControllerAverageNFO", errorCode);
-    // setIntegerParam(PIAvgNFO_rbv_, value);
-
-    // // --- PIEnSAM_rbv_[3] (bln32) ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerEnabledSAM(deviceNo, axes[i], &bvalue);
-    //     checkError("DSCS_getPIControllerEnabledSAM", errorCode);
-    //     setIntegerParam(PIEnSAM_rbv_[i], bvalue);
-    // }
-
-    // // --- PIIValSAM_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerIValueSAM(deviceNo, axes[i], &dvalue);
-    //     checkError("DSCS_getPIControllerIValueSAM", errorCode);
-    //     setDoubleParam(PIIValSAM_rbv_[i], dvalue);
-    // }
-
-    // // --- PIPValSAM_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerPValueSAM(deviceNo, axes[i], &value);
-    //     checkError("DSCS_getPIControllerPValueSAM", errorCode);
-    //     setIntegerParam(PIPValSAM_rbv_[i], value);
-    // }
-
-    // // --- PILimSAM_rbv_ ---
-    // errorCode = DSCS_getPIControllerLimitSAM(deviceNo, &value);
-    // checkError("DSCS_getPIControllerLimitSAM", errorCode);
-    // setIntegerParam(PILimSAM_rbv_, value);
-
-    // // --- PITargPos_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerTargetPosition(deviceNo, axes[i], &value);
-    //     checkError("DSCS_getPIControllerTargetPosition", errorCode);
-    //     setIntegerParam(PITargPos_rbv_[i], value);
-    // }
-
-    // // --- PITargMode_rbv_ (enum) ---
-    // errorCode = DSCS_getPIControllerTargetMode(deviceNo, &targetMode); // targetMode is typedef
-    // checkError("DSCS_getPIControllerTargetMode", errorCode);
-    // setIntegerParam(PITargMode_rbv_, targetMode);
-
-    // // --- PINFOOut_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerNFOOutput(deviceNo, axes[i], &value);
-    //     checkError("DSCS_getPIControllerNFOOutput", errorCode);
-    //     setIntegerParam(PINFOOut_rbv_[i], value);
-    // }
-
-    // // --- PISAMOut_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getPIControllerSAMOutput(deviceNo, axes[i], &value);
-    //     checkError("DSCS_getPIControllerSAMOutput", errorCode);
-    //     setIntegerParam(PISAMOut_rbv_[i], value);
-    // }
-
-    // // --- NFOADCLimMin_rbv_ & NFOADCLimMax_rbv_ ---
-    // {
-    //     int minValue, maxValue;
-    //     errorCode = DSCS_getNFOADCLimits(deviceNo, &minValue, &maxValue);
-    //     checkError("DSCS_getNFOADCLimits", errorCode);
-    //     setIntegerParam(NFOADCLimMin_rbv_, minValue);
-    //     setIntegerParam(NFOADCLimMax_rbv_, maxValue);
-    // }
-
-    // // --- NFOSlewLim_rbv_ ---
-    // errorCode = DSCS_getNFOSlewRateLimit(deviceNo, &value);
-    // checkError("DSCS_getNFOSlewRateLimit", errorCode);
-    // setIntegerParam(NFOSlewLim_rbv_, value);
-
-    // // --- SAMADCLimMin_rbv_ & SAMADCLimMax_rbv_ ---
-    // {
-    //     int minValue, maxValue;
-    //     errorCode = DSCS_getSAMADCLimits(deviceNo, &minValue, &maxValue);
-    //     checkError("DSCS_getSAMADCLimits", errorCode);
-    //     setIntegerParam(SAMADCLimMin_rbv_, minValue);
-    //     setIntegerParam(SAMADCLimMax_rbv_, maxValue);
-    // }
-
-    // // --- SAMSlewLim_rbv_ ---
-    // errorCode = DSCS_getSAMSlewRateLimit(deviceNo, &value);
-    // checkError("DSCS_getSAMSlewRateLimit", errorCode);
-    // setIntegerParam(SAMSlewLim_rbv_, value);
-
-    // // --- LimState_rbv_ (enum) ---
-    // errorCode = DSCS_getLimiterState(deviceNo, &limiterState);
-    // checkError("DSCS_getLimiterState", errorCode);
-    // setIntegerParam(LimState_rbv_, limiterState);
-
-    // // --- InpTransRes_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    //     errorCode = DSCS_getInputTransformationResult(deviceNo, axes[i], &value);
-    //     checkError("DSCS_getInputTransformationResult", errorCode);
-    //     setIntegerParam(InpTransRes_rbv_[i], value);
-    // }
-
-    // // NOT FOUND IN LIB YET
-    // // // --- InpTransAvg_rbv_ ---
-    // // errorCode = DSCS_getInputTransformationAverage(deviceNo, &value);
-    // // checkError("DSCS_getInputTransformationAverage", errorCode);
-    // // setIntegerParam(InpTransAvg_rbv_, value);
-
-    // // --- InpTransState_rbv_ (enum) ---
-    // errorCode = DSCS_getInputTransformationState(deviceNo, &inTransState);
-    // checkError("DSCS_getInputTransformationState", errorCode);
-    // setIntegerParam(InpTransState_rbv_, inTransState);
-
-    // // --- OutTransNFORes_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    // 	int dummy;
-    //     errorCode = DSCS_getOutputTransformationResult(deviceNo, axes[i], &value, &dummy);
-    //     checkError("DSCS_getOutputTransformationResult", errorCode);
-    //     setIntegerParam(OutTransNFORes_rbv_[i], value);
-    // }
-
-    // // --- OutTransSAMRes_rbv_[3] ---
-    // for (int i = 0; i < 3; ++i) {
-    // 	int dummy;
-    //     errorCode = DSCS_getOutputTransformationResult(deviceNo, axes[i], &dummy, &value);
-    //     checkError("DSCS_getOutputTransformationResult", errorCode);
-    //     setIntegerParam(OutTransSAMRes_rbv_[i], value);
-    // }
-
-    // // --- Trajectory parameters (all single value) ---
-    // errorCode = DSCS_getTrajectoryLineStartX(deviceNo, &value);
-    // checkError("DSCS_getTrajectoryLineStartX", errorCode);
-    // setIntegerParam(TrajStartX_rbv_, value);
-
-    // errorCode = DSCS_getTrajectoryLineEndX(deviceNo, &value);
-    // checkError("DSCS_getTrajectoryLineEndX", errorCode);
-    // setIntegerParam(TrajEndX_rbv_, value);
-
-    // errorCode = DSCS_getTrajectoryLineSpeedX(deviceNo, &value);
-    // checkError("DSCS_getTrajectoryLineSpeedX", errorCode);
-    // setIntegerParam(TrajSpeedX_rbv_, value);
-
-    // errorCode = DSCS_getTrajectoryLineStartY(deviceNo, &value);
-    // checkError("DSCS_getTrajectoryLineStartY", errorCode);
-    // setIntegerParam(TrajStartY_rbv_, value);
-
-    // errorCode = DSCS_getTrajectoryLineDistY(deviceNo, &value);
-    // checkError("DSCS_getTrajectoryLineDistY", errorCode);
-    // setIntegerParam(TrajDistY_rbv_, value);
-
-    // errorCode = DSCS_getTrajectoryLineCountY(deviceNo, (unsigned short*)&value);
-    // value = value & 0xFFFF; // mask to range of unsigned short
-    // checkError("DSCS_getTrajectoryLineCountY", errorCode);
-    // setIntegerParam(TrajCountY_rbv_, value);
-
-    // // unsigned int
-    // errorCode = DSCS_getTrajectoryTurnTime(deviceNo, &uvalue);
-    // checkError("DSCS_getTrajectoryTurnTime", errorCode);
-    // if (uvalue <= INT_MAX) {
-    // 	setIntegerParam(TrajTurnTime_rbv_, value);
-    // }
-    // else {
-    // 	printf("error converting unsigned int to int for TrajTurnTime_rbv_, uvalue=%u", uvalue);
-    // }
-
-    // // unsigned int
-    // errorCode = DSCS_getTrajectoryPosTime(deviceNo, &uvalue);
-    // checkError("DSCS_getTrajectoryPosTime", errorCode);
-    // if (uvalue <= INT_MAX) {
-    // 	setIntegerParam(TrajPosTime_rbv_, value);
-    // }
-    // else {
-    // 	printf("error converting unsigned int to int for TrajPosTime_rbv_, uvalue=%u", uvalue);
-    // }
-
-    // errorCode = DSCS_getTrajectoryAntiHyst(deviceNo, &value);
-    // checkError("DSCS_getTrajectoryAntiHyst", errorCode);
-    // setIntegerParam(TrajAntiHyst_rbv_, value);
-
-    // // unsigned int
-    // errorCode = DSCS_getTrajectorySettings(deviceNo, &uvalue);
-    // checkError("DSCS_getTrajectorySettings", errorCode);
-    // if (uvalue <= INT_MAX) {
-    // 	setIntegerParam(TrajSettings_rbv_, value);
-    // }
-    // else {
-    // 	printf("error converting unsigned int to int for TrajSettings_rbv_, uvalue=%u", uvalue);
-    // }
+/*
+ * Post the lock statistics every DSCS_LOCK_UPDATE. Called from the poller
+ * with the port lock held.
+ */
+void dscsAsyn::publishLockStats(epicsUInt64 now)
+{
+    if (now - lockPublished_ < DSCS_LOCK_UPDATE * 1e9) return;
+    lockPublished_ = now;
+
+    for (int site = 0; site < DSCS_NUM_LOCK_SITES; ++site) {
+        dscsLockStats &stats = lockStats_[site];
+        setIntegerParam(LockCount_rbv_[site], stats.count);
+        setDoubleParam(LockWaitP99_rbv_[site], stats.wait.percentile(0.99));
+        setDoubleParam(LockWaitMax_rbv_[site], stats.wait.max / 1e9);
+        setDoubleParam(LockHoldP99_rbv_[site], stats.hold.percentile(0.99));
+        setDoubleParam(LockHoldMax_rbv_[site], stats.hold.max / 1e9);
+        doCallbacksInt32Array(stats.wait.counts, DSCS_LOCK_BUCKETS, LockWaitHist_[site], 0);
+        doCallbacksInt32Array(stats.hold.counts, DSCS_LOCK_BUCKETS, LockHoldHist_[site], 0);
+    }
 
+    epicsFloat64 edges[DSCS_LOCK_BUCKETS];
+    for (int k = 0; k < DSCS_LOCK_BUCKETS; ++k) edges[k] = (1 << k) * 1e-6;
+    doCallbacksFloat64Array(edges, DSCS_LOCK_BUCKETS, LockHistEdges_, 0);
+}
 
-    unlock();
+/*
+ * Clear the lock statistics. The acquisition in progress still ends its
+ * hold at the next unlock(). Called with the port lock held.
+ */
+void dscsAsyn::resetLockStats()
+{
+    for (int site = 0; site < DSCS_NUM_LOCK_SITES; ++site) {
+        lockStats_[site] = dscsLockStats();
+        setIntegerParam(LockCount_rbv_[site], 0);
+        setDoubleParam(LockWaitP99_rbv_[site], 0);
+        setDoubleParam(LockWaitMax_rbv_[site], 0);
+        setDoubleParam(LockHoldP99_rbv_[site], 0);
+        setDoubleParam(LockHoldMax_rbv_[site], 0);
+    }
+    lockPublished_ = 0;
+}
 
-    callParamCallbacks();
-    epicsThreadSleep(pollTime_);
+/*
+ * Read the readbacks of every table row in pollClass from the controller into
+ * the parameter library. Returns asynDisconnected as soon as a vendor call
+ * fails with a link-class error so that the rest of the sweep is not spent
+ * waiting out timeouts. Called with the port lock held.
+ */
+asynStatus dscsAsyn::pollReadbacks(dscsPollClass pollClass)
+{
+    static const char *functionName = "pollReadbacks";
+    char context[64];
+    double value;
+    int errorCode;
+    epicsUInt64 now = epicsMonotonicGet();
+    epicsTimeStamp stamp;
+    double time;
+
+    epicsTimeGetCurrent(&stamp);
+    time = stamp.secPastEpoch + stamp.nsec * 1e-9;
+
+    for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+        const dscsParamDesc &desc = dscsParamTable[row];
+        if (desc.poll != pollClass || !desc.get || !(desc.flags & dscsParamReadback)) continue;
+
+        for (int chan = 0; chan < dscsChannelCount(desc.chans); ++chan) {
+            errorCode = desc.get(deviceNo, chan, &value);
+            if (errorCode != DSCS_Ok) {
+                dscsParamName(desc, chan, true, context, sizeof(context));
+                if (checkError(context, errorCode) == dscsErrorLink) return asynDisconnected;
+                continue;
+            }
+            // every poll goes into the history, the publish filter only
+            // decides what is posted
+            if (history_[row][chan] && value <= INT_MAX) {
+                history_[row][chan]->add(time, (epicsInt32)value);
+            }
+            if (!filterReadback(row, chan, value, now)) continue;
+            readTime_[row][chan] = now;
+            if (desc.type == asynParamFloat64) {
+                setDoubleParam(rbvParam_[row][chan], value);
+            }
+            else if (value <= INT_MAX) { // unsigned registers can exceed epicsInt32
+                setIntegerParam(rbvParam_[row][chan], (epicsInt32)value);
+            }
+            else {
+                dscsParamName(desc, chan, true, context, sizeof(context));
+                asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+                    "%s:%s, port %s, error converting %.0f to int for %s\n",
+                    driverName, functionName, this->portName, value, context);
+            }
+        }
+    }
 
-  }
+    return asynSuccess;
 }
 
 /*
- *
- * writeInt32
- *
+ * Register or remove the data callback and switch the controller's data
+ * output to match. The enable state is kept even if the vendor calls fail so
+ * that a reconnect re-enables the stream. The callback reaches a single
+ * port, so the enable is refused while another port streams. Called with the
+ * port lock held.
  */
-asynStatus dscsAsyn::writeInt32(asynUser *pasynUser, epicsInt32 value)
+asynStatus dscsAsyn::enableStream(bool enable)
 {
-	int function = pasynUser->reason;
-	asynStatus status = asynSuccess;
-	static const char *functionName = "writeInt32";
+	static const char *functionName = "enableStream";
+	asynStatus status;
+	dscsAsyn *owner = enable ? NULL : this;
+
+	if (enable && !streamDriver.compare_exchange_strong(owner, this) && owner != this) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, port %s is already streaming\n",
+			driverName, functionName, this->portName, owner->portName);
+		this->streamEnabled_ = false;
+		setIntegerParam(StreamEnable_, 0);
+		return asynError;
+	}
+	if (!enable) streamDriver.compare_exchange_strong(owner, NULL);
 
-    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
-			"%s:%s, port %s, function = %d\n",
-			driverName, functionName, this->portName, function);
+	asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, %s data stream\n",
+		driverName, functionName, this->portName, enable ? "enabling" : "disabling");
 
-	setIntegerParam(function, value);
+	this->streamEnabled_ = enable;
+	// the next packet on each channel restarts its clock model
+	for (int ch = 0; ch < DSCS_STREAM_CHANNELS; ++ch) streamChannel_[ch].restart();
+	if (merge_) merge_->clear();
 
-	if (function == OSA_PS_[0]) status = setOSA_PS(DSCS_AxisX, value);
-    	else if (function == OSA_PS_[1]) status = setOSA_PS(DSCS_AxisY, value);
+	status = checkStatus("DSCS_setDataCallback", DSCS_setDataCallback(deviceNo, enable ? dataCallbackC : NULL));
+	if (status == asynSuccess) {
+		status = checkStatus("DSCS_setDataOutputEnabled", DSCS_setDataOutputEnabled(deviceNo, enable));
+	}
+	return status;
+}
 
-    	else if (function == BS_PS_[0]) status = setBS_PS(DSCS_AxisX, value);
-    	else if (function == BS_PS_[1]) status = setBS_PS(DSCS_AxisY, value);
+/*
+ * Called from the vendor library's thread for every data packet. length is
+ * in bytes; the packet holds whole tuples of DSCS_TUPLE_SIZE values, the
+ * first of which is sample number index. Only queues the packet, so the
+ * vendor thread never waits for the port lock. A replay passes the time the
+ * packet originally arrived; live packets arrive now.
+ */
+void dscsAsyn::dataCallback(int channel, int length, int index, const epicsInt32 *data,
+                            const epicsTimeStamp *arrival)
+{
+	static const char *functionName = "dataCallback";
+	dscsStreamPacket packet;
+
+	if (arrival) packet.arrival = *arrival;
+	else epicsTimeGetCurrent(&packet.arrival);
+	packet.channel = channel;
+	packet.index = (epicsUInt32)index;
+	packet.width = DSCS_TUPLE_SIZE;
+	packet.nSamples = length / (int)(sizeof(epicsInt32) * DSCS_TUPLE_SIZE);
+
+	if (channel < 0 || channel >= DSCS_STREAM_CHANNELS || packet.nSamples <= 0) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, dropped packet: channel %d, length %d\n",
+			driverName, functionName, this->portName, channel, length);
+		return;
+	}
 
-    	else if (function == AUX_DAC_[0]) status = setAUX_DAC(DSCS_AUX_0, value);
-    	else if (function == AUX_DAC_[1]) status = setAUX_DAC(DSCS_AUX_1, value);
-    	else if (function == AUX_DAC_[2]) status = setAUX_DAC(DSCS_AUX_2, value);
-    	else if (function == AUX_DAC_[3]) status = setAUX_DAC(DSCS_AUX_3, value);
+	if (streamQueue_[channel]->push(packet, data)) epicsEventSignal(streamEvent_);
+}
 
-    	else if (function == NFO_PS_[0]) status = setNFO_PS(DSCS_AxisX, value);
-    	else if (function == NFO_PS_[1]) status = setNFO_PS(DSCS_AxisY, value);
-    	else if (function == NFO_PS_[2]) status = setNFO_PS(DSCS_AxisZ, value);
+/*
+ * Drains the stream queues and publishes each packet
+ */
+void dscsAsyn::streamThread()
+{
+	dscsStreamPacket packet;
+	std::vector<epicsInt32> values;
+
+	while (1) {
+		// wake up regularly so held merge packets are released after their delay
+		epicsEventWaitWithTimeout(streamEvent_, merge_ ? DSCS_MERGE_MAX_DELAY / 5 : 1.0);
+
+		lock(dscsLockStream);
+		for (int ch = 0; ch < DSCS_STREAM_CHANNELS; ++ch) {
+			while (streamQueue_[ch]->pop(packet, values)) {
+				// packets still queued when the stream was switched off are dropped
+				if (!this->streamEnabled_ && replayState_ != dscsReplayRunning) continue;
+				streamData_.swap(values);
+				publishPacket(packet);
+				if (replayState_ == dscsReplayRunning) replayPublished_ += packet.nSamples;
+			}
+			setIntegerParam(StreamOverflows_rbv_[ch], (epicsInt32)streamQueue_[ch]->overflows());
+		}
+		while (merge_ && merge_->takeReady(merged_)) publishMerged();
+		callParamCallbacks();
+		unlock();
+	}
+}
 
-    	else if (function == SAM_PS_[0]) status = setSAM_PS(DSCS_AxisX, value);
-    	else if (function == SAM_PS_[1]) status = setSAM_PS(DSCS_AxisY, value);
-    	else if (function == SAM_PS_[2]) status = setSAM_PS(DSCS_AxisZ, value);
+/*
+ * Publish the packet held in streamData_. The samples are stamped from the
+ * channel's clock model, and the arrays carry the estimated time of their
+ * first sample as the asyn timestamp. Called with the port lock held.
+ */
+void dscsAsyn::publishPacket(const dscsStreamPacket &packet)
+{
+	dscsStreamChannel &channel = streamChannel_[packet.channel];
+	epicsTimeStamp first;
 
-    	else if (function == SetptFreq_[0]) status = setSetpointModulationFrequency(DSCS_AxisX, value);
-    	else if (function == SetptFreq_[1]) status = setSetpointModulationFrequency(DSCS_AxisY, value);
-    	else if (function == SetptFreq_[2]) status = setSetpointModulationFrequency(DSCS_AxisZ, value);
+	channel.stamp(packet, streamTime_, &first);
+	setTimeStamp(&first);
 
-    	else if (function == SetptPhase_[0]) status = setSetpointModulationPhase(DSCS_AxisX, value);
-    	else if (function == SetptPhase_[1]) status = setSetpointModulationPhase(DSCS_AxisY, value);
-    	else if (function == SetptPhase_[2]) status = setSetpointModulationPhase(DSCS_AxisZ, value);
+	setDoubleParam(StreamRate_rbv_[packet.channel], channel.rate());
+	setDoubleParam(StreamTimeResid_rbv_[packet.channel], channel.residual());
+	setIntegerParam(StreamLost_rbv_[packet.channel], (epicsInt32)channel.lost());
+	callParamCallbacks();
+	doCallbacksInt32Array(streamData_.data(), streamData_.size(), StreamData_[packet.channel], 0);
+	doCallbacksFloat64Array(streamTime_.data(), streamTime_.size(), StreamTime_[packet.channel], 0);
+
+	// X positions of a running trajectory, on the stream's own clock
+	if (trajRunning_ && trajStreamX_ && packet.channel == 0 && packet.width == DSCS_TUPLE_SIZE) {
+		epicsUInt64 sample = channel.samples() - packet.nSamples;
+		for (int i = 0; i < packet.nSamples; ++i, ++sample) {
+			if (sample < trajStartSample_) continue;
+			trajProgress_.addPosition((sample - trajStartSample_) / channel.rate(),
+			                          streamData_[i * packet.width + trajXColumn_]);
+		}
+	}
 
-    	else if (function == SetptAmp_[0]) status = setSetpointModulationAmplitude(DSCS_AxisX, value);
-    	else if (function == SetptAmp_[1]) status = setSetpointModulationAmplitude(DSCS_AxisY, value);
-    	else if (function == SetptAmp_[2]) status = setSetpointModulationAmplitude(DSCS_AxisZ, value);
+	// interlock state carried by the stream; a fault in any tuple of the packet trips
+	if (streamedInterlock() && packet.channel == 0 && packet.width == DSCS_TUPLE_SIZE && packet.nSamples > 0) {
+		int limiter = 0, transformation = 0;
+		for (int i = 0; i < packet.nSamples; ++i) {
+			limiter |= streamData_[i * packet.width + interlockLimColumn_];
+			transformation |= streamData_[i * packet.width + interlockTransColumn_];
+		}
+		checkInterlock(limiter, transformation);
+	}
 
-    	else if (function == ExtADCShift_) status = setExternalADCShift(value);
+	// response of a running step test
+	if ((tuneState_ == dscsTuneBaseline || tuneState_ == dscsTuneResponse) &&
+	    packet.channel == 0 && packet.width == DSCS_TUPLE_SIZE) {
+		epicsUInt64 sample = channel.samples() - packet.nSamples;
+		for (int i = 0; i < packet.nSamples && sample < tuneEndSample_; ++i, ++sample) {
+			if (sample < tuneStartSample_ || tuneValue_.size() >= DSCS_TUNE_MAX_SAMPLES) continue;
+			tuneTime_.push_back((sample - tuneStartSample_) / channel.rate());
+			tuneValue_.push_back(streamData_[i * packet.width + tuneColumn_]);
+		}
+	}
 
-    	else if (function == PIEnNFO_[0]) status = setPIControllerEnabledNFO(DSCS_AxisX, value);
-    	else if (function == PIEnNFO_[1]) status = setPIControllerEnabledNFO(DSCS_AxisY, value);
-    	else if (function == PIEnNFO_[2]) status = setPIControllerEnabledNFO(DSCS_AxisZ, value);
+	// response and reference of a running sweep point
+	if (bodeState_ == dscsBodeRunning && packet.channel == 0 && packet.width == DSCS_TUPLE_SIZE) {
+		epicsUInt64 sample = channel.samples() - packet.nSamples;
+		for (int i = 0; i < packet.nSamples && sample < bodeEndSample_; ++i, ++sample) {
+			if (sample < bodeStartSample_) continue;
+			const epicsInt32 *tuple = &streamData_[i * packet.width];
+			bodeResponse_.add(tuple[bodeColumn_]);
+			bodeReference_.add(tuple[bodeRefColumn_]);
+		}
+	}
 
-    	// else if (function == PIIValNFO_[0]) status = setPIControllerIValueNFO(DSCS_AxisX, value);
-    	// else if (function == PIIValNFO_[1]) status = setPIControllerIValueNFO(DSCS_AxisY, value);
-    	// else if (function == PIIValNFO_[2]) status = setPIControllerIValueNFO(DSCS_AxisZ, value);
+	// capture; the writer thread encodes and writes it
+	if (captureActive_[packet.channel] && packet.width == DSCS_TUPLE_SIZE) {
+		dscsCapturePacket capture;
+		int n = packet.nSamples;
+		capture.command = dscsCaptureData;
+		capture.codec = 0;
+		capture.nSamples = n;
+		capture.width = packet.width;
+		capture.firstSample = channel.samples() - n;
+		capture.firstTime = streamTime_[0];
+		capture.period = n > 1 ? (streamTime_[n - 1] - streamTime_[0]) / (n - 1) :
+		                 channel.rate() > 0 ? 1 / channel.rate() : 0;
+		if (captureQueue_[packet.channel]->push(capture, streamData_.data())) epicsEventSignal(captureEvent_);
+	}
 
-    	else if (function == PIPValNFO_[0]) status = setPIControllerPValueNFO(DSCS_AxisX, value);
-    	else if (function == PIPValNFO_[1]) status = setPIControllerPValueNFO(DSCS_AxisY, value);
-    	else if (function == PIPValNFO_[2]) status = setPIControllerPValueNFO(DSCS_AxisZ, value);
+	dscsStreamHistory<epicsInt32> *history = streamHistory_[packet.channel];
+	if (packet.width == history->width()) history->add(streamData_.data(), streamTime_.data(), packet.nSamples);
 
-    	else if (function == PILimNFO_) status = setPIControllerLimitNFO(value);
-    	else if (function == PIAvgNFO_) status = setPIControllerAverageNFO(value);
+	// the merge takes the buffers over; they are refilled with the next packet
+	if (merge_ && packet.channel == mergeChannel_)
+		merge_->addPrimary(streamData_, streamTime_, first, channel.samples() - packet.nSamples);
+}
 
-    	else if (function == PIEnSAM_[0]) status = setPIControllerEnabledSAM(DSCS_AxisX, value);
-    	else if (function == PIEnSAM_[1]) status = setPIControllerEnabledSAM(DSCS_AxisY, value);
-    	else if (function == PIEnSAM_[2]) status = setPIControllerEnabledSAM(DSCS_AxisZ, value);
+/*
+ * Start or stop a capture (DSCS_CAPTURE_CHANNELS) to CAPTURE_FILE. Only
+ * queues the request behind the packets already published, the capture
+ * thread opens and closes the file. Called with the port lock held.
+ */
+asynStatus dscsAsyn::enableCapture(int ch, bool enable)
+{
+	static const char *functionName = "enableCapture";
+	dscsCapturePacket marker = {};
+	char file[256];
+	int codec;
+
+	if (enable == captureActive_[ch]) return asynSuccess;
+
+	marker.command = enable ? dscsCaptureOpen : dscsCaptureClose;
+	marker.width = ch == DSCS_CAPTURE_MERGE ? DSCS_MERGE_CAPTURE_WIDTH : DSCS_TUPLE_SIZE;
+	if (enable) {
+		getStringParam(CaptureFile_[ch], sizeof(file), file);
+		getIntegerParam(CaptureCodec_[ch], &codec);
+		if (!file[0] || codec < 0 || codec >= DSCS_NUM_CAPTURE_CODECS) {
+			asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+				"%s:%s, port %s, CAPTURE_FILE_%s is not set or CAPTURE_CODEC_%s is invalid\n",
+				driverName, functionName, this->portName, captureTags[ch], captureTags[ch]);
+			setIntegerParam(CaptureEnable_[ch], 0);
+			return asynError;
+		}
+		marker.codec = codec;
+		captureFiles_[ch].push_back(file);
+	}
 
-	// move to float64
-    	// else if (function == PIIValSAM_[0]) status = setPIControllerIValueSAM(DSCS_AxisX, value);
-    	// else if (function == PIIValSAM_[1]) status = setPIControllerIValueSAM(DSCS_AxisY, value);
-    	// else if (function == PIIValSAM_[2]) status = setPIControllerIValueSAM(DSCS_AxisZ, value);
+	if (!captureQueue_[ch]->push(marker, NULL)) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, capture queue %s is full\n",
+			driverName, functionName, this->portName, captureTags[ch]);
+		if (enable) captureFiles_[ch].pop_back();
+		setIntegerParam(CaptureEnable_[ch], captureActive_[ch]);
+		return asynError;
+	}
 
-    	else if (function == PIPValSAM_[0]) status = setPIControllerPValueSAM(DSCS_AxisX, value);
-    	else if (function == PIPValSAM_[1]) status = setPIControllerPValueSAM(DSCS_AxisY, value);
-    	else if (function == PIPValSAM_[2]) status = setPIControllerPValueSAM(DSCS_AxisZ, value);
+	asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, %s capture %s\n",
+		driverName, functionName, this->portName, enable ? "starting" : "stopping", captureTags[ch]);
+	if (enable) setStringParam(CaptureMessage_rbv_[ch], "");
+	captureActive_[ch] = enable;
+	epicsEventSignal(captureEvent_);
+	return asynSuccess;
+}
 
-    	else if (function == PILimSAM_) status = setPIControllerLimitSAM(value);
+/*
+ * Capture writer. Encoding and disk writes run here without the port lock,
+ * so a slow disk only fills the capture queues.
+ */
+void dscsAsyn::captureThread()
+{
+	while (1) {
+		epicsEventWaitWithTimeout(captureEvent_, DSCS_CAPTURE_UPDATE);
+
+		for (int ch = 0; ch < DSCS_CAPTURE_CHANNELS; ++ch) writeCapture(ch);
+
+		lock(dscsLockCapture);
+		for (int ch = 0; ch < DSCS_CAPTURE_CHANNELS; ++ch) {
+			const dscsCaptureWriter &writer = captureWriter_[ch];
+			setDoubleParam(CaptureSamples_rbv_[ch], (double)writer.samples());
+			setDoubleParam(CaptureBytes_rbv_[ch], (double)writer.fileBytes());
+			setDoubleParam(CaptureRatio_rbv_[ch], writer.fileBytes() ? (double)writer.rawBytes() / writer.fileBytes() : 0);
+			setIntegerParam(CaptureDropped_rbv_[ch], (epicsInt32)captureQueue_[ch]->overflows());
+		}
+		callParamCallbacks();
+		unlock();
+	}
+}
 
-    	else if (function == PITargPos_[0]) status = setPIControllerTargetPosition(DSCS_AxisX, value);
-    	else if (function == PITargPos_[1]) status = setPIControllerTargetPosition(DSCS_AxisY, value);
-    	else if (function == PITargPos_[2]) status = setPIControllerTargetPosition(DSCS_AxisZ, value);
+/*
+ * Drain the capture queue of one channel into its file. A failed write ends
+ * the capture; packets are then dropped until the next CAPTURE_ENABLE.
+ * Called from the capture thread without the port lock.
+ */
+void dscsAsyn::writeCapture(int ch)
+{
+	static const char *functionName = "writeCapture";
+	dscsCaptureWriter &writer = captureWriter_[ch];
+	dscsCapturePacket packet;
+	std::string file, error;
+	bool ok = true;
+
+	while (captureQueue_[ch]->pop(packet, captureValues_)) {
+		if (packet.command == dscsCaptureOpen) {
+			lock(dscsLockCapture);
+			file = captureFiles_[ch].front();
+			captureFiles_[ch].pop_front();
+			unlock();
+			ok = writer.open(file.c_str(), packet.width, (dscsCaptureCodec)packet.codec, error);
+		} else if (packet.command == dscsCaptureClose) {
+			ok = writer.close(error);
+		} else if (writer.isOpen()) {
+			ok = writer.add(packet.firstSample, packet.firstTime, packet.period,
+			                captureValues_.data(), packet.nSamples, error);
+		}
+		if (ok) continue;
+
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, capture %s failed: %s\n",
+			driverName, functionName, this->portName, captureTags[ch], error.c_str());
+		lock(dscsLockCapture);
+		setStringParam(CaptureMessage_rbv_[ch], error.c_str());
+		// unless the capture was already restarted
+		if (captureActive_[ch] && captureFiles_[ch].empty()) {
+			captureActive_[ch] = false;
+			setIntegerParam(CaptureEnable_[ch], 0);
+		}
+		callParamCallbacks();
+		unlock();
+		ok = true;
+	}
+}
+
+/*
+ * Start feeding REPLAY_FILE to the stream pipeline in place of the
+ * controller. The vendor callback must be off, so the stream queue keeps a
+ * single producer. Called with the port lock held.
+ */
+asynStatus dscsAsyn::startReplay()
+{
+	static const char *functionName = "startReplay";
+	const char *error = NULL;
+	char file[256];
+	int ch, packetSamples;
+	double speed;
+
+	getStringParam(ReplayFile_, sizeof(file), file);
+	getIntegerParam(ReplayChannel_, &ch);
+	getDoubleParam(ReplaySpeed_, &speed);
+	getIntegerParam(ReplayPacket_, &packetSamples);
+
+	if (replayState_ == dscsReplayRunning) error = "a replay is running";
+	else if (streamEnabled_) error = "STREAM_ENABLE must be 0";
+	else if (!file[0]) error = "REPLAY_FILE is not set";
+	else if (ch < 0 || ch >= DSCS_STREAM_CHANNELS) error = "REPLAY_CHANNEL is invalid";
+	else if (!(speed >= 0)) error = "REPLAY_SPEED must not be negative";
+	else if (packetSamples <= 0 || (size_t)packetSamples * DSCS_TUPLE_SIZE > DSCS_STREAM_QUEUE_VALUES)
+		error = "REPLAY_PACKET is out of range";
+	if (error) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s\n",
+			driverName, functionName, this->portName, error);
+		if (replayState_ != dscsReplayRunning) setStringParam(ReplayMessage_rbv_, error);
+		return asynError;
+	}
+
+	// the replayed packets start the clock model over
+	streamChannel_[ch].restart();
+	if (merge_) merge_->clear();
+
+	replayRun_++;
+	replayPublished_ = 0;
+	replayState_ = dscsReplayRunning;
+	setIntegerParam(ReplayState_rbv_, replayState_);
+	setDoubleParam(ReplaySamples_rbv_, 0);
+	setDoubleParam(ReplayProgress_rbv_, 0);
+	setDoubleParam(ReplayRate_rbv_, 0);
+	setStringParam(ReplayMessage_rbv_, "");
+	epicsEventSignal(replayEvent_);
+	return asynSuccess;
+}
+
+void dscsAsyn::finishReplay(dscsReplayState state, const char *message)
+{
+	static const char *functionName = "finishReplay";
+
+	if (message) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, replay failed, %s\n",
+			driverName, functionName, this->portName, message);
+	}
+	replayState_ = state;
+	setIntegerParam(ReplayState_rbv_, replayState_);
+	setStringParam(ReplayMessage_rbv_, message ? message : "");
+}
+
+bool dscsAsyn::replayRunning(int run)
+{
+	bool running;
+
+	lock(dscsLockReplay);
+	running = replayState_ == dscsReplayRunning && replayRun_ == run;
+	unlock();
+	return running;
+}
+
+void dscsAsyn::replayThread()
+{
+	char file[256];
+	int ch, packetSamples, run;
+	double speed;
+
+	while (1) {
+		epicsEventWait(replayEvent_);
+
+		lock(dscsLockReplay);
+		getStringParam(ReplayFile_, sizeof(file), file);
+		getIntegerParam(ReplayChannel_, &ch);
+		getDoubleParam(ReplaySpeed_, &speed);
+		getIntegerParam(ReplayPacket_, &packetSamples);
+		run = replayRun_;
+		unlock();
+
+		if (replayRunning(run)) runReplay(file, ch, speed, packetSamples, run);
+	}
+}
+
+/*
+ * Feed a capture to dataCallback, REPLAY_PACKET tuples at a time. Each
+ * packet carries the time its last tuple was taken as its arrival, so the
+ * clock model sees the original timing whatever the speed. At speed 0 the
+ * replay waits for room in the stream queue instead of dropping packets,
+ * and REPLAY_RATE_RBV is the throughput of the pipeline. The replay is only
+ * done once the stream thread has published the last packet; it drops what
+ * is queued after that. Runs without the port lock.
+ */
+void dscsAsyn::runReplay(const char *file, int ch, double speed, int packetSamples, int run)
+{
+	dscsCaptureReader reader;
+	std::vector<epicsInt32> values;
+	std::vector<epicsFloat64> times;
+	std::string error;
+	epicsUInt64 start, update, now, fed = 0, total;
+	double firstTime, wait;
+
+	if (!reader.open(file, error) || reader.width() != DSCS_TUPLE_SIZE) {
+		if (error.empty()) error = "the capture does not hold stream tuples";
+		lock(dscsLockReplay);
+		if (replayRunning(run)) finishReplay(dscsReplayFailed, error.c_str());
+		callParamCallbacks();
+		unlock();
+		return;
+	}
+
+	total = reader.samples();
+	firstTime = reader.blocks() ? reader.block(0).firstTime : 0;
+	start = update = epicsMonotonicGet();
+
+	for (size_t b = 0; b < reader.blocks() && error.empty(); ++b) {
+		const dscsCaptureIndexEntry &entry = reader.block(b);
+
+		if (!reader.read(b, values, times, error)) break;
+		for (size_t i = 0; i < entry.samples; i += packetSamples) {
+			size_t n = std::min((size_t)packetSamples, entry.samples - i);
+			epicsTimeStamp arrival = {};
+
+			if (speed > 0) {
+				while ((wait = (times[i + n - 1] - firstTime) / speed - (epicsMonotonicGet() - start) / 1e9) > 0) {
+					epicsThreadSleep(std::min(wait, DSCS_REPLAY_UPDATE));
+					if (!replayRunning(run)) return;
+				}
+			} else {
+				while (!streamQueue_[ch]->fits(n * DSCS_TUPLE_SIZE)) {
+					epicsThreadSleep(0.001);
+					if (!replayRunning(run)) return;
+				}
+			}
+
+			epicsTimeAddSeconds(&arrival, times[i + n - 1]);
+			dataCallback(ch, (int)(n * DSCS_TUPLE_SIZE * sizeof(epicsInt32)),
+			             (int)(epicsUInt32)(entry.firstSample + i), &values[i * DSCS_TUPLE_SIZE], &arrival);
+			fed += n;
+
+			now = epicsMonotonicGet();
+			if (now - update < DSCS_REPLAY_UPDATE * 1e9) continue;
+			update = now;
+			lock(dscsLockReplay);
+			if (!replayRunning(run)) {
+				unlock();
+				return;
+			}
+			setDoubleParam(ReplaySamples_rbv_, (double)fed);
+			setDoubleParam(ReplayProgress_rbv_, total ? (double)fed / total : 1);
+			setDoubleParam(ReplayRate_rbv_, replayPublished_ / ((now - start) / 1e9));
+			callParamCallbacks();
+			unlock();
+		}
+	}
+
+	// the stream thread pops under the port lock, so an empty queue seen
+	// with the lock held means the last packet is published
+	while (!streamQueue_[ch]->empty()) {
+		epicsEventSignal(streamEvent_);
+		epicsThreadSleep(0.001);
+		if (!replayRunning(run)) return;
+	}
+
+	now = epicsMonotonicGet();
+	lock(dscsLockReplay);
+	if (replayRunning(run)) {
+		setDoubleParam(ReplaySamples_rbv_, (double)fed);
+		setDoubleParam(ReplayProgress_rbv_, total ? (double)fed / total : 1);
+		if (now > start) setDoubleParam(ReplayRate_rbv_, replayPublished_ / ((now - start) / 1e9));
+		finishReplay(error.empty() ? dscsReplayDone : dscsReplayFailed, error.empty() ? NULL : error.c_str());
+	}
+	callParamCallbacks();
+	unlock();
+}
+
+/*
+ * Interlock watcher. While the stream is running and carries the limiter and
+ * transformation state (INTERLOCK_LIM_COLUMN, INTERLOCK_TRANS_COLUMN), the
+ * state is taken from the published packets and the watcher stays idle.
+ * Otherwise the state is read every interlockPeriod_, independent of the
+ * poll. The two reads are made without the port lock so the poller, writer
+ * and scan threads are not held off by them; the lock is only taken to
+ * publish the result.
+ */
+void dscsAsyn::watchThread()
+{
+	DSCS_LimiterState limiter;
+	DSCS_InputTransformationState transformation;
+	double period;
+	bool poll;
+	int errorCode;
+
+	while (1) {
+		lock(dscsLockWatch);
+		period = interlockPeriod_;
+		poll = connected_ && period > 0 && !streamedInterlock();
+		unlock();
+
+		if (poll) {
+			limiter = (DSCS_LimiterState)0;
+			transformation = (DSCS_InputTransformationState)0;
+			errorCode = DSCS_getLimiterState(deviceNo, &limiter);
+			if (errorCode == DSCS_Ok) errorCode = DSCS_getInputTransformationState(deviceNo, &transformation);
+
+			lock(dscsLockWatch);
+			// a disconnect or the stream taking over while reading makes the result stale
+			if (connected_ && !streamedInterlock()) {
+				if (errorCode == DSCS_Ok) checkInterlock(limiter, transformation);
+				// command errors are left to the slow poll, so a failing check does not flood the log
+				else if (classifyError(errorCode) == dscsErrorLink) checkStatus("interlock check", errorCode);
+			}
+			callParamCallbacks();
+			unlock();
+		}
+		epicsThreadSleep(period > 0 ? period : 1.0);
+	}
+}
+
+/*
+ * True while the live stream carries the interlock state, so the watcher
+ * need not read it. A replay is recorded data and never feeds the interlock.
+ * Called with the port lock held.
+ */
+bool dscsAsyn::streamedInterlock()
+{
+	return this->streamEnabled_ && replayState_ != dscsReplayRunning &&
+	       interlockLimColumn_ >= 0 && interlockLimColumn_ < DSCS_TUPLE_SIZE &&
+	       interlockTransColumn_ >= 0 && interlockTransColumn_ < DSCS_TUPLE_SIZE;
+}
+
+/*
+ * Publish one limiter and transformation state, read by the watcher or taken
+ * from the stream, and trip on a new cause. Called with the port lock held.
+ */
+void dscsAsyn::checkInterlock(int limiter, int transformation)
+{
+	int cause = 0;
+
+	if (limiter & OutputNull) cause |= dscsInterlockLimiter;
+	if (transformation & TransformationError) cause |= dscsInterlockTransformation;
+	setIntegerParam(rbvParam_[dscsParLimState][0], limiter);
+	setIntegerParam(rbvParam_[dscsParInpTransState][0], transformation);
+	setIntegerParam(InterlockState_rbv_, cause);
+
+	if (cause & ~interlock_) tripInterlock(cause);
+}
+
+/*
+ * Latch a new interlock cause. On the first trip since the last reset the
+ * trajectory is stopped and the stream history leading up to the trip is
+ * published. Called with the port lock held.
+ */
+void dscsAsyn::tripInterlock(int cause)
+{
+	static const char *functionName = "tripInterlock";
+	epicsTimeStamp now;
+	char stamp[64];
+	bool first = interlock_ == 0;
+
+	interlock_ |= cause;
+	setIntegerParam(Interlock_rbv_, interlock_);
+	if (!first) return;
+
+	epicsTimeGetCurrent(&now);
+	epicsTimeToStrftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S.%06f", &now);
+	setStringParam(InterlockStamp_rbv_, stamp);
+	asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, interlock at %s:%s%s\n",
+		driverName, functionName, this->portName, stamp,
+		(cause & dscsInterlockLimiter) ? " limiter output null" : "",
+		(cause & dscsInterlockTransformation) ? " transformation error" : "");
+
+	leaveTrajectory();
+
+	setTimeStamp(&now);
+	for (int ch = 0; ch < DSCS_STREAM_CHANNELS; ++ch) {
+		streamHistory_[ch]->copy(interlockData_, interlockTime_);
+		doCallbacksInt32Array(interlockData_.data(), interlockData_.size(), InterlockData_[ch], 0);
+		doCallbacksFloat64Array(interlockTime_.data(), interlockTime_.size(), InterlockTime_[ch], 0);
+	}
+}
+
+/*
+ * The library has no call to stop a running trajectory. Taking the PI
+ * controllers off the trajectory generator (target mode Direct) does, and
+ * leaves them holding their own targets. Called with the port lock held.
+ */
+void dscsAsyn::leaveTrajectory()
+{
+	static const char *functionName = "leaveTrajectory";
+	DSCS_TargetMode mode = Direct;
+
+	if (trajRunning_) {
+		trajRunning_ = false;
+		trajEnd_ = epicsMonotonicGet();
+		setIntegerParam(TrajRunning_rbv_, 0);
+	}
+	if (checkStatus("PI_TARG_MODE_RBV", DSCS_getPIControllerTargetMode(deviceNo, &mode)) != asynSuccess) return;
+	if (mode != Trajectory) return;
+
+	if (checkStatus("PI_TARG_MODE", DSCS_setPIControllerTargetMode(deviceNo, Direct)) == asynSuccess) {
+		setSetpointValue(dscsParPITargMode, 0, Direct);
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, trajectory stopped\n",
+			driverName, functionName, this->portName);
+	}
+}
+
+void dscsAsyn::getScanRequest(dscsScanRequest &request)
+{
+	epicsInt32 mode;
+
+	getDoubleParam(ScanStartX_, &request.startX);
+	getDoubleParam(ScanStartY_, &request.startY);
+	getDoubleParam(ScanWidth_, &request.width);
+	getDoubleParam(ScanHeight_, &request.height);
+	getDoubleParam(ScanPixel_, &request.pixel);
+	getDoubleParam(ScanDwell_, &request.dwell);
+	getDoubleParam(ScanTurnTime_, &request.turnTime);
+	getDoubleParam(ScanPosTime_, &request.posTime);
+	getDoubleParam(ScanAntiHyst_, &request.antiHyst);
+	getIntegerParam(ScanMode_, &mode);
+	request.mode = (unsigned int)mode;
+}
+
+/*
+ * Plan a raster from the SCAN_* parameters and stage it for upload. Called
+ * with the port lock held.
+ */
+asynStatus dscsAsyn::planScan()
+{
+	static const char *functionName = "planScan";
+	dscsScanRequest request;
+	std::string error;
+
+	getScanRequest(request);
+	planValid_ = dscsPlanTrajectory(request, plan_, error);
+	setIntegerParam(PlanValid_rbv_, planValid_);
+	setStringParam(PlanMessage_rbv_, error.c_str());
+	if (!planValid_) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s\n",
+			driverName, functionName, this->portName, error.c_str());
+		return asynError;
+	}
+
+	setIntegerParam(PlanPixels_rbv_, plan_.pixelsX);
+	setIntegerParam(PlanLines_rbv_, (epicsInt32)plan_.countY);
+	setDoubleParam(PlanDwell_rbv_, plan_.dwell);
+	setDoubleParam(PlanLineTime_rbv_, plan_.lineTime);
+	setDoubleParam(PlanDuration_rbv_, plan_.duration);
+	setDoubleParam(PlanSamples_rbv_, floor(plan_.duration * streamChannel_[0].rate()));
+	return asynSuccess;
+}
+
+/*
+ * Write a plan to the trajectory registers, going around the write queue so
+ * the whole set lands before anything else is sent. With changedOnly, only
+ * registers that differ from their setpoint parameter are written. Called
+ * with the port lock held.
+ */
+asynStatus dscsAsyn::uploadPlan(const dscsTrajectoryPlan &plan, bool changedOnly)
+{
+	const struct { int row; double value; } registers[] = {
+		{ dscsParTrajStartX,   (double)plan.startX },
+		{ dscsParTrajEndX,     (double)plan.endX },
+		{ dscsParTrajSpeedX,   (double)plan.speedX },
+		{ dscsParTrajStartY,   (double)plan.startY },
+		{ dscsParTrajDistY,    (double)plan.distY },
+		{ dscsParTrajCountY,   (double)plan.countY },
+		{ dscsParTrajTurnTime, (double)plan.turnTime },
+		{ dscsParTrajPosTime,  (double)plan.posTime },
+		{ dscsParTrajAntiHyst, (double)plan.antiHyst },
+		{ dscsParTrajSettings, (double)plan.settings },
+	};
+	asynStatus status;
+	epicsInt32 current;
+
+	if (!connected_) return asynDisconnected;
+	for (size_t i = 0; i < sizeof(registers) / sizeof(registers[0]); ++i) {
+		int function = param_[registers[i].row][0];
+		getIntegerParam(function, &current);
+		if (changedOnly && writtenSetpoints_.count(function) && !pendingWrites_.count(function) &&
+		    current == (epicsInt32)registers[i].value) continue;
+		status = sendSetpoint(registers[i].row, 0, registers[i].value);
+		if (status != asynSuccess) return status;
+	}
+	return asynSuccess;
+}
+
+/*
+ * Write one setpoint now, dropping a queued write of it, and keep the
+ * parameter and the restore bookkeeping in step. Called with the port lock
+ * held.
+ */
+asynStatus dscsAsyn::sendSetpoint(int row, int chan, double value)
+{
+	int function = param_[row][chan];
+	asynStatus status;
+	double dropped;
+
+	takePendingWrite(function, &dropped);
+	status = writeSetpoint(function, value);
+	setParamStatus(function, status);
+	if (status != asynSuccess) return status;
+	setSetpointValue(row, chan, value);
+	writtenSetpoints_[function] = value;
+	return asynSuccess;
+}
+
+/*
+ * Append tiles to the scan queue: start X, start Y, width and height in nm
+ * for each, with the rest of the request taken from the SCAN_* parameters.
+ */
+asynStatus dscsAsyn::writeFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements)
+{
+	int function = pasynUser->reason;
+	dscsScanRequest request;
+	asynStatus status = asynSuccess;
+
+	if (function != ScanQueueTiles_) return asynPortDriver::writeFloat64Array(pasynUser, value, nElements);
+
+	getScanRequest(request);
+	for (size_t i = 0; i + DSCS_SCAN_TILE_VALUES <= nElements && status == asynSuccess; i += DSCS_SCAN_TILE_VALUES) {
+		request.startX = value[i];
+		request.startY = value[i + 1];
+		request.width = value[i + 2];
+		request.height = value[i + 3];
+		status = queueTile(request);
+	}
+	callParamCallbacks();
+	return status;
+}
+
+/*
+ * Plan one tile and append it to the scan queue. Tiles are planned when
+ * they are queued, so nothing is left to compute between two tiles. Called
+ * with the port lock held.
+ */
+asynStatus dscsAsyn::queueTile(const dscsScanRequest &request)
+{
+	static const char *functionName = "queueTile";
+	dscsTrajectoryPlan plan;
+	std::string error;
+
+	if (!dscsPlanTrajectory(request, plan, error)) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, tile %d: %s\n",
+			driverName, functionName, this->portName, (int)scanQueue_.size() + 1, error.c_str());
+		setStringParam(PlanMessage_rbv_, error.c_str());
+		return asynError;
+	}
+	scanQueue_.push_back(plan);
+	scanQueueTime_ += plan.duration;
+	setIntegerParam(ScanQueueLength_rbv_, (int)scanQueue_.size());
+	return asynSuccess;
+}
+
+/*
+ * Append the tiles in file, one "<start X> <start Y> <width> <height>" line
+ * per tile in nm; blank lines and lines starting with # are skipped. Called
+ * with the port lock held.
+ */
+asynStatus dscsAsyn::loadScanQueue(const char *file)
+{
+	static const char *functionName = "loadScanQueue";
+	dscsScanRequest request;
+	asynStatus status = asynSuccess;
+	char line[256];
+	int lineNo = 0;
+	FILE *fp;
+
+	fp = fopen(file, "r");
+	if (!fp) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, can't open %s\n",
+			driverName, functionName, this->portName, file);
+		return asynError;
+	}
+
+	getScanRequest(request);
+	while (status == asynSuccess && fgets(line, sizeof(line), fp)) {
+		lineNo++;
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+		if (sscanf(line, "%lf %lf %lf %lf", &request.startX, &request.startY,
+		           &request.width, &request.height) != 4) {
+			asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s:%d: expected x y width height\n",
+				driverName, functionName, this->portName, file, lineNo);
+			status = asynError;
+			break;
+		}
+		status = queueTile(request);
+	}
+	fclose(fp);
+	return status;
+}
+
+/*
+ * Run the queue from its first tile. The PI controllers must already follow
+ * the trajectory generator; the queue never changes the target mode itself.
+ * Called with the port lock held.
+ */
+asynStatus dscsAsyn::startScanQueue()
+{
+	static const char *functionName = "startScanQueue";
+	DSCS_TargetMode mode = Direct;
+	asynStatus status;
+
+	if (scanState_ == dscsScanRunning || scanQueue_.empty() || interlock_) return asynError;
+	if (testRunning()) return asynError;
+	if (!connected_) return asynDisconnected;
+
+	status = checkStatus("PI_TARG_MODE_RBV", DSCS_getPIControllerTargetMode(deviceNo, &mode));
+	if (status != asynSuccess) return status;
+	if (mode != Trajectory) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, PI_TARG_MODE must be Trajectory to run the scan queue\n",
+			driverName, functionName, this->portName);
+		return asynError;
+	}
+
+	scanState_ = dscsScanRunning;
+	scanTile_ = -1;
+	scanDoneTime_ = 0;
+	setIntegerParam(ScanQueueState_rbv_, scanState_);
+	setDoubleParam(ScanQueueGap_rbv_, 0);
+	epicsEventSignal(scanEvent_);
+	return asynSuccess;
+}
+
+/*
+ * End a running queue. An aborted queue also stops the running trajectory.
+ * Called with the port lock held.
+ */
+void dscsAsyn::stopScanQueue(dscsScanState state)
+{
+	static const char *functionName = "stopScanQueue";
+
+	if (state == dscsScanAborted) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, scan queue aborted in tile %d\n",
+			driverName, functionName, this->portName, scanTile_ + 1);
+		if (connected_) leaveTrajectory();
+	}
+	scanState_ = state;
+	setIntegerParam(ScanQueueState_rbv_, scanState_);
+	updateScanProgress();
+}
+
+void dscsAsyn::scanThread()
+{
+	double wait, queueWait, tuneWait;
+
+	while (1) {
+		lock(dscsLockScan);
+		wait = updateTrajectory();
+		queueWait = runScanQueue();
+		if (queueWait < wait) wait = queueWait;
+		tuneWait = updateTuning();
+		if (tuneWait < wait) wait = tuneWait;
+		tuneWait = updateBode();
+		if (tuneWait < wait) wait = tuneWait;
+		callParamCallbacks();
+		unlock();
+		epicsEventWaitWithTimeout(scanEvent_, wait);
+	}
+}
+
+/*
+ * One step of the queue. Once the running tile's trajectory has ended (see
+ * updateTrajectory) and SCAN_QUEUE_SETTLE has passed, the next tile is
+ * started, writing only the registers that differ from the tile before.
+ * Returns the time until the next step. Called with the port lock held.
+ */
+double dscsAsyn::runScanQueue()
+{
+	asynStatus status;
+	double settle, wait;
+
+	if (scanState_ != dscsScanRunning) return 1.0;
+	if (!connected_ || interlock_) {
+		stopScanQueue(dscsScanAborted);
+		return 1.0;
+	}
+
+	if (scanTile_ >= 0 && trajRunning_) {
+		updateScanProgress();
+		return DSCS_SCAN_UPDATE;
+	}
+
+	// the controller can't be asked whether the trajectory has stopped, and
+	// the plan assumes the fly back runs at line speed; leave a margin
+	if (scanTile_ >= 0) {
+		getDoubleParam(ScanQueueSettle_, &settle);
+		wait = settle - (epicsMonotonicGet() - trajEnd_) / 1e9;
+		if (wait > 0) return wait < DSCS_SCAN_UPDATE ? wait : DSCS_SCAN_UPDATE;
+	}
+
+	if (scanTile_ >= 0) scanDoneTime_ += scanQueue_[scanTile_].duration;
+	if (++scanTile_ >= (int)scanQueue_.size()) {
+		scanTile_ = (int)scanQueue_.size() - 1;
+		stopScanQueue(dscsScanDone);
+		return 1.0;
+	}
+
+	const dscsTrajectoryPlan &plan = scanQueue_[scanTile_];
+	status = uploadPlan(plan, true);
+	if (status == asynSuccess) status = startTrajectory(plan);
+	if (status != asynSuccess) {
+		stopScanQueue(dscsScanAborted);
+		return 1.0;
+	}
+
+	if (scanTile_ > 0) setDoubleParam(ScanQueueGap_rbv_, (trajStart_ - trajEnd_) / 1e9);
+	setIntegerParam(ScanQueueTile_rbv_, scanTile_ + 1);
+	updateScanProgress();
+	return DSCS_SCAN_UPDATE;
+}
+
+void dscsAsyn::updateScanProgress()
+{
+	double done = scanDoneTime_;
+	double eta = 0;
+
+	if (scanState_ == dscsScanDone) {
+		done = scanQueueTime_;
+	} else if (scanTile_ >= 0 && scanTile_ < (int)scanQueue_.size()) {
+		double duration = scanQueue_[scanTile_].duration;
+		done += duration * trajProgress_.fraction();
+		// the running tile at its measured rate, the rest as planned
+		eta = scanQueueTime_ - scanDoneTime_ - duration + trajProgress_.remaining();
+	}
+	setDoubleParam(ScanQueueProgress_rbv_, scanQueueTime_ > 0 ? done / scanQueueTime_ : 0);
+	setDoubleParam(ScanQueueEta_rbv_, scanState_ == dscsScanRunning ? eta : 0);
+}
+
+/*
+ * Start the trajectory in the TRAJ_* registers and follow its progress.
+ * Called with the port lock held.
+ */
+asynStatus dscsAsyn::startTrajectory(const dscsTrajectoryPlan &plan)
+{
+	asynStatus status;
+
+	if (!connected_) return asynDisconnected;
+	status = checkStatus("TRAJ_START", DSCS_startTrajectory(deviceNo));
+	if (status != asynSuccess) return status;
+
+	trajStart_ = epicsMonotonicGet();
+	trajPlan_ = plan;
+	trajProgress_.start(plan);
+	trajRunning_ = true;
+	// the stream's sample clock runs on the controller, so it is preferred
+	// to the host clock for timing the trajectory
+	trajStreamClock_ = streamEnabled_ && streamChannel_[0].rate() > 0;
+	trajStreamX_ = trajStreamClock_ && trajXColumn_ >= 0 && trajXColumn_ < DSCS_TUPLE_SIZE;
+	trajStartSample_ = streamChannel_[0].samples();
+
+	setIntegerParam(TrajRunning_rbv_, 1);
+	setIntegerParam(TrajStreamClock_rbv_, trajStreamClock_);
+	setIntegerParam(TrajMeasured_rbv_, 0);
+	setDoubleParam(TrajPlanLineRate_rbv_, trajProgress_.plannedLineRate());
+	setDoubleParam(TrajLineRate_rbv_, 0);
+	epicsEventSignal(scanEvent_);
+	return asynSuccess;
+}
+
+/*
+ * TRAJ_START: run whatever is in the TRAJ_* registers, e.g. after
+ * SCAN_UPLOAD or hand-set values. Called with the port lock held.
+ */
+asynStatus dscsAsyn::startStagedTrajectory()
+{
+	static const char *functionName = "startStagedTrajectory";
+	dscsTrajectoryPlan plan;
+	std::string error;
+	epicsInt32 value;
+
+	getIntegerParam(param_[dscsParTrajStartX][0], &value);   plan.startX = value;
+	getIntegerParam(param_[dscsParTrajEndX][0], &value);     plan.endX = value;
+	getIntegerParam(param_[dscsParTrajSpeedX][0], &value);   plan.speedX = value;
+	getIntegerParam(param_[dscsParTrajStartY][0], &value);   plan.startY = value;
+	getIntegerParam(param_[dscsParTrajDistY][0], &value);    plan.distY = value;
+	getIntegerParam(param_[dscsParTrajCountY][0], &value);   plan.countY = (unsigned int)value;
+	getIntegerParam(param_[dscsParTrajTurnTime][0], &value); plan.turnTime = (unsigned int)value;
+	getIntegerParam(param_[dscsParTrajPosTime][0], &value);  plan.posTime = (unsigned int)value;
+	getIntegerParam(param_[dscsParTrajAntiHyst][0], &value); plan.antiHyst = value;
+	getIntegerParam(param_[dscsParTrajSettings][0], &value); plan.settings = (unsigned int)value;
+
+	if (scanState_ == dscsScanRunning || testRunning() || !dscsTrajectoryTiming(plan, error)) {
+		if (error.empty()) error = scanState_ == dscsScanRunning ? "the scan queue is running" : "a step test or sweep is running";
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s\n",
+			driverName, functionName, this->portName, error.c_str());
+		return asynError;
+	}
+	return startTrajectory(plan);
+}
+
+/*
+ * Time since the running trajectory started, s
+ */
+double dscsAsyn::trajectoryElapsed(epicsUInt64 now)
+{
+	const dscsStreamChannel &channel = streamChannel_[0];
+
+	if (trajStreamClock_ && streamEnabled_ && channel.rate() > 0 && channel.samples() >= trajStartSample_)
+		return (channel.samples() - trajStartSample_) / channel.rate();
+	trajStreamClock_ = false;
+	return (now - trajStart_) / 1e9;
+}
+
+/*
+ * Publish the progress of the running trajectory. Without X positions from
+ * the stream, the X output of the sample PI controller is read here
+ * instead, at the update rate. TRAJ_RUNNING_RBV ends when the progress
+ * says so, which past the expected end waits for X to come to rest. Returns
+ * the time until the next update. Called with the port lock held.
+ */
+double dscsAsyn::updateTrajectory()
+{
+	epicsUInt64 now = epicsMonotonicGet();
+	double elapsed, x;
+
+	if (!trajRunning_) return 1.0;
+
+	elapsed = trajectoryElapsed(now);
+	if (!trajStreamX_ &&
+	    dscsParamTable[dscsParPISAMOut].get(deviceNo, DSCS_AxisX, &x) == DSCS_Ok) {
+		trajProgress_.addPosition(elapsed, x);
+	}
+	trajProgress_.update(elapsed);
+
+	setIntegerParam(TrajStreamClock_rbv_, trajStreamClock_);
+	setIntegerParam(TrajMeasured_rbv_, trajProgress_.measured());
+	setIntegerParam(TrajLine_rbv_, trajProgress_.line());
+	setDoubleParam(TrajFraction_rbv_, trajProgress_.fraction());
+	setDoubleParam(TrajRemaining_rbv_, trajProgress_.remaining());
+	setDoubleParam(TrajLineRate_rbv_, trajProgress_.actualLineRate());
+
+	if (trajProgress_.finished()) {
+		trajRunning_ = false;
+		trajEnd_ = now;
+		setIntegerParam(TrajRunning_rbv_, 0);
+		return 0;
+	}
+	// past the expected end, check again once X could have come to rest
+	if (trajProgress_.remaining() <= 0) return DSCS_TRAJ_STILL_TIME;
+	return trajProgress_.remaining() < DSCS_SCAN_UPDATE ? trajProgress_.remaining() : DSCS_SCAN_UPDATE;
+}
+
+/*
+ * PI step test. The target of one axis is stepped by TUNE_STEP and the
+ * axis' controlled value is captured from the REL stream at full rate,
+ * TUNE_DURATION * DSCS_TUNE_BASELINE before the step and TUNE_DURATION
+ * after it; the target is put back afterwards. The step is timed by the
+ * stream sample count when it is written, so the metrics include the
+ * command latency. The sequence is run by the scan thread. Called with the
+ * port lock held.
+ */
+asynStatus dscsAsyn::startTuning()
+{
+	static const char *functionName = "startTuning";
+	const dscsStreamChannel &channel = streamChannel_[0];
+	const char *error = NULL;
+	epicsInt32 axis, column = -1, step;
+	double duration, band, target;
+
+	getIntegerParam(TuneAxis_, &axis);
+	getIntegerParam(TuneStep_, &step);
+	getDoubleParam(TuneDuration_, &duration);
+	getDoubleParam(TuneBand_, &band);
+	if (axis >= 0 && axis < DSCS_TUNE_AXES) getIntegerParam(TuneColumn_[axis], &column);
+
+	if (testRunning()) error = "a step test or sweep is running";
+	else if (scanState_ == dscsScanRunning || trajRunning_) error = "a trajectory is running";
+	else if (!connected_) error = "not connected";
+	else if (interlock_) error = "interlock tripped";
+	else if (axis < 0 || axis >= DSCS_TUNE_AXES) error = "TUNE_AXIS must be 0..2";
+	else if (column < 0 || column >= DSCS_TUPLE_SIZE) error = "TUNE_COLUMN of the axis is not set";
+	else if (!streamEnabled_ || !(channel.rate() > 0)) error = "the REL stream is not running";
+	else if (step == 0) error = "TUNE_STEP is 0";
+	else if (!(duration > 0)) error = "TUNE_DURATION must be positive";
+	else if (!(band > 0)) error = "TUNE_BAND must be positive";
+	else if (duration * (1 + DSCS_TUNE_BASELINE) * channel.rate() > DSCS_TUNE_MAX_SAMPLES)
+		error = "TUNE_DURATION too long for the stream rate";
+	else if (checkStatus("PI_TARG_POS_RBV", dscsParamTable[dscsParPITargPos].get(deviceNo, axis, &target)) != asynSuccess)
+		error = "PI_TARG_POS could not be read";
+
+	setStringParam(TuneMessage_rbv_, error ? error : "");
+	if (error) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s\n",
+			driverName, functionName, this->portName, error);
+		return asynError;
+	}
+
+	tuneAxis_ = axis;
+	tuneColumn_ = column;
+	tuneInitial_ = target;
+	tuneTarget_ = target + step;
+	tuneDuration_ = duration;
+	tuneTime_.clear();
+	tuneValue_.clear();
+	tuneStartSample_ = channel.samples();
+	tuneEndSample_ = tuneStartSample_ + (epicsUInt64)(duration * (1 + DSCS_TUNE_BASELINE) * channel.rate());
+	tuneDeadline_ = epicsMonotonicGet() + (epicsUInt64)((2 * duration * (1 + DSCS_TUNE_BASELINE) + 1) * 1e9);
+	tuneState_ = dscsTuneBaseline;
+	setIntegerParam(TuneState_rbv_, tuneState_);
+	epicsEventSignal(scanEvent_);
+	return asynSuccess;
+}
+
+/*
+ * One step of a running step test. Returns the time until the next one.
+ * Called with the port lock held.
+ */
+double dscsAsyn::updateTuning()
+{
+	const dscsStreamChannel &channel = streamChannel_[0];
+
+	if (tuneState_ != dscsTuneBaseline && tuneState_ != dscsTuneResponse) return 1.0;
+	if (!connected_ || interlock_ || !streamEnabled_) {
+		finishTuning(dscsTuneFailed, !connected_ ? "link lost" : interlock_ ? "interlock tripped" : "the REL stream was switched off");
+		return 1.0;
+	}
+
+	if (tuneState_ == dscsTuneBaseline) {
+		epicsUInt64 step = tuneStartSample_ + (epicsUInt64)(tuneDuration_ * DSCS_TUNE_BASELINE * channel.rate());
+		if (channel.samples() >= step) {
+			if (sendSetpoint(dscsParPITargPos, tuneAxis_, tuneTarget_) != asynSuccess) {
+				finishTuning(dscsTuneFailed, "PI_TARG_POS write failed");
+				return 1.0;
+			}
+			// the response window starts at the step actually taken
+			tuneStepTime_ = (channel.samples() - tuneStartSample_) / channel.rate();
+			tuneEndSample_ = channel.samples() + (epicsUInt64)(tuneDuration_ * channel.rate());
+			tuneState_ = dscsTuneResponse;
+			setIntegerParam(TuneState_rbv_, tuneState_);
+		}
+	} else if (channel.samples() >= tuneEndSample_ || tuneValue_.size() >= DSCS_TUNE_MAX_SAMPLES) {
+		finishTuning(dscsTuneDone, NULL);
+		return 1.0;
+	}
+
+	if (epicsMonotonicGet() > tuneDeadline_) {
+		finishTuning(dscsTuneFailed, "the REL stream stopped delivering");
+		return 1.0;
+	}
+	return DSCS_TUNE_UPDATE;
+}
+
+/*
+ * End a step test: put the target back and, if the capture is complete,
+ * publish the metrics and the trace of the axis. Called with the port lock
+ * held.
+ */
+void dscsAsyn::finishTuning(dscsTuneState state, const char *message)
+{
+	static const char *functionName = "finishTuning";
+	dscsStepMetrics metrics;
+	std::string error;
+	double band;
+
+	if (tuneState_ == dscsTuneResponse && connected_ &&
+	    sendSetpoint(dscsParPITargPos, tuneAxis_, tuneInitial_) != asynSuccess && !message) {
+		message = "PI_TARG_POS could not be put back";
+	}
+
+	for (size_t i = 0; i < tuneTime_.size(); ++i) tuneTime_[i] -= tuneStepTime_;
+	if (tuneState_ == dscsTuneResponse) {
+		doCallbacksFloat64Array(tuneValue_.data(), tuneValue_.size(), TuneTrace_[tuneAxis_], 0);
+		doCallbacksFloat64Array(tuneTime_.data(), tuneTime_.size(), TuneTraceTime_[tuneAxis_], 0);
+	}
+
+	if (state == dscsTuneDone) {
+		getDoubleParam(TuneBand_, &band);
+		if (dscsAnalyzeStep(tuneTime_, tuneValue_, tuneTarget_, band, metrics, error)) {
+			setDoubleParam(TuneRise_rbv_[tuneAxis_], metrics.riseTime);
+			setDoubleParam(TuneOvershoot_rbv_[tuneAxis_], metrics.overshoot);
+			setDoubleParam(TuneSettling_rbv_[tuneAxis_], metrics.settlingTime);
+			setDoubleParam(TuneError_rbv_[tuneAxis_], metrics.steadyStateError);
+		} else {
+			state = dscsTuneFailed;
+			message = error.c_str();
+		}
+	}
+
+	if (message) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, step test failed, %s\n",
+			driverName, functionName, this->portName, message);
+	}
+	tuneState_ = state;
+	setIntegerParam(TuneState_rbv_, tuneState_);
+	setStringParam(TuneMessage_rbv_, message ? message : "");
+}
+
+/*
+ * Frequency response sweep. SETPT_FREQ of one axis is stepped through
+ * BODE_POINTS log-spaced frequencies with SETPT_AMP at BODE_AMP; at each,
+ * BODE_SETTLE periods are let pass and BODE_CYCLES periods of the axis'
+ * response (TUNE_COLUMN) and reference (BODE_REF_COLUMN) are demodulated
+ * from the REL stream. The reference is needed: the response is in stream
+ * counts, SETPT_AMP in setpoint units, and only the reference carries the
+ * phase. The modulation is put back afterwards. The sequence is run by the scan thread. Called with the port
+ * lock held.
+ */
+asynStatus dscsAsyn::startBode()
+{
+	static const char *functionName = "startBode";
+	const dscsStreamChannel &channel = streamChannel_[0];
+	const char *error = NULL;
+	DSCS_TargetMode mode = Direct;
+	epicsInt32 axis, column = -1, refColumn = -1, points, amp, cycles;
+	double start, stop, settle;
+
+	getIntegerParam(BodeAxis_, &axis);
+	getDoubleParam(BodeStart_, &start);
+	getDoubleParam(BodeStop_, &stop);
+	getIntegerParam(BodePoints_, &points);
+	getIntegerParam(BodeAmp_, &amp);
+	getIntegerParam(BodeCycles_, &cycles);
+	getDoubleParam(BodeSettle_, &settle);
+	if (axis >= 0 && axis < DSCS_TUNE_AXES) {
+		getIntegerParam(TuneColumn_[axis], &column);
+		getIntegerParam(BodeRefColumn_[axis], &refColumn);
+	}
+
+	if (testRunning()) error = "a step test or sweep is running";
+	else if (scanState_ == dscsScanRunning || trajRunning_) error = "a trajectory is running";
+	else if (!connected_) error = "not connected";
+	else if (interlock_) error = "interlock tripped";
+	else if (axis < 0 || axis >= DSCS_TUNE_AXES) error = "BODE_AXIS must be 0..2";
+	else if (column < 0 || column >= DSCS_TUPLE_SIZE) error = "TUNE_COLUMN of the axis is not set";
+	else if (refColumn < 0 || refColumn >= DSCS_TUPLE_SIZE) error = "BODE_REF_COLUMN of the axis is not set";
+	else if (!streamEnabled_ || !(channel.rate() > 0)) error = "the REL stream is not running";
+	else if (!(start >= DSCS_BODE_FREQ_UNIT) || !(stop >= DSCS_BODE_FREQ_UNIT)) error = "BODE_START and BODE_STOP must be positive";
+	else if (start >= channel.rate() / 2 || stop >= channel.rate() / 2) error = "sweep reaches half the stream rate";
+	else if (points < 1 || points > DSCS_BODE_MAX_POINTS) error = "BODE_POINTS out of range";
+	else if (amp <= 0) error = "BODE_AMP must be positive";
+	else if (cycles < 1) error = "BODE_CYCLES must be at least 1";
+	else if (!(settle >= 0)) error = "BODE_SETTLE must not be negative";
+	else if (checkStatus("PI_TARG_MODE_RBV", DSCS_getPIControllerTargetMode(deviceNo, &mode)) != asynSuccess ||
+	         checkStatus("SETPT_FREQ_RBV", dscsParamTable[dscsParSetptFreq].get(deviceNo, axis, &bodeSavedFreq_)) != asynSuccess ||
+	         checkStatus("SETPT_AMP_RBV", dscsParamTable[dscsParSetptAmp].get(deviceNo, axis, &bodeSavedAmp_)) != asynSuccess)
+		error = "the modulation could not be read";
+	else if (mode != Setpoint) error = "PI_TARG_MODE must be Setpoint for the sweep";
+
+	setStringParam(BodeMessage_rbv_, error ? error : "");
+	if (error) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s\n",
+			driverName, functionName, this->portName, error);
+		return asynError;
+	}
+
+	bodeAxis_ = axis;
+	bodeColumn_ = column;
+	bodeRefColumn_ = refColumn;
+	bodeAmp_ = amp;
+	bodeCycles_ = cycles;
+	bodeSettle_ = settle;
+	dscsLogSweep(start, stop, points, bodeSweep_);
+	bodePoint_ = 0;
+	bodeFreq_ = bodeSweep_[0];
+	bodeFreqs_.clear();
+	bodeMag_.clear();
+	bodePhase_.clear();
+	setIntegerParam(BodePoint_rbv_, 0);
+
+	bodeState_ = dscsBodeRunning;
+	setIntegerParam(BodeState_rbv_, bodeState_);
+	if (sendSetpoint(dscsParSetptAmp, bodeAxis_, bodeAmp_) != asynSuccess || startBodePoint() != asynSuccess) {
+		finishBode(dscsBodeFailed, "the modulation could not be set");
+		return asynError;
+	}
+	epicsEventSignal(scanEvent_);
+	return asynSuccess;
+}
+
+/*
+ * Set the frequency of the current point and the stream samples that will
+ * be demodulated for it. Called with the port lock held.
+ */
+asynStatus dscsAsyn::startBodePoint()
+{
+	const dscsStreamChannel &channel = streamChannel_[0];
+	double counts = floor(bodeSweep_[bodePoint_] / DSCS_BODE_FREQ_UNIT + 0.5);
+	double rate = channel.rate();
+	asynStatus status;
+
+	status = sendSetpoint(dscsParSetptFreq, bodeAxis_, counts);
+	if (status != asynSuccess) return status;
+
+	// whole periods, so the demodulation doesn't leak
+	bodeFreq_ = counts * DSCS_BODE_FREQ_UNIT;
+	epicsUInt64 settle = (epicsUInt64)ceil(bodeSettle_ * rate / bodeFreq_);
+	epicsUInt64 length = (epicsUInt64)floor(bodeCycles_ * rate / bodeFreq_ + 0.5);
+	bodeStartSample_ = channel.samples() + settle;
+	bodeEndSample_ = bodeStartSample_ + (length > 0 ? length : 1);
+	bodeResponse_.start(bodeFreq_, rate);
+	bodeReference_.start(bodeFreq_, rate);
+	bodeDeadline_ = epicsMonotonicGet() + (epicsUInt64)((2 * (bodeEndSample_ - channel.samples()) / rate + 1) * 1e9);
+	return asynSuccess;
+}
+
+/*
+ * One step of a running sweep: when the current point has all its samples,
+ * add it to the curves and go on to the next frequency. Returns the time
+ * until the next step. Called with the port lock held.
+ */
+double dscsAsyn::updateBode()
+{
+	const dscsStreamChannel &channel = streamChannel_[0];
+	double re, im, refRe, refIm, norm;
+
+	if (bodeState_ != dscsBodeRunning) return 1.0;
+	if (!connected_ || interlock_ || !streamEnabled_) {
+		finishBode(dscsBodeFailed, !connected_ ? "link lost" : interlock_ ? "interlock tripped" : "the REL stream was switched off");
+		return 1.0;
+	}
+	if (channel.samples() < bodeEndSample_) {
+		if (epicsMonotonicGet() > bodeDeadline_) {
+			finishBode(dscsBodeFailed, "the REL stream stopped delivering");
+			return 1.0;
+		}
+		return DSCS_TUNE_UPDATE;
+	}
+
+	// response over reference
+	re = bodeResponse_.re();
+	im = bodeResponse_.im();
+	refRe = bodeReference_.re();
+	refIm = bodeReference_.im();
+	norm = refRe * refRe + refIm * refIm;
+	bodeMag_.push_back(norm > 0 ? sqrt((re * re + im * im) / norm) : NAN);
+	bodePhase_.push_back(norm > 0 ? atan2(im * refRe - re * refIm, re * refRe + im * refIm) * 180 / M_PI : NAN);
+	bodeFreqs_.push_back(bodeFreq_);
+	doCallbacksFloat64Array(bodeFreqs_.data(), bodeFreqs_.size(), BodeFreq_, 0);
+	doCallbacksFloat64Array(bodeMag_.data(), bodeMag_.size(), BodeMag_, 0);
+	doCallbacksFloat64Array(bodePhase_.data(), bodePhase_.size(), BodePhase_, 0);
+	setIntegerParam(BodePoint_rbv_, (epicsInt32)bodeFreqs_.size());
+
+	if (++bodePoint_ >= (int)bodeSweep_.size()) {
+		finishBode(dscsBodeDone, NULL);
+		return 1.0;
+	}
+	if (startBodePoint() != asynSuccess) {
+		finishBode(dscsBodeFailed, "SETPT_FREQ write failed");
+		return 1.0;
+	}
+	return DSCS_TUNE_UPDATE;
+}
+
+/*
+ * End a sweep and put the modulation back. Called with the port lock held.
+ */
+void dscsAsyn::finishBode(dscsBodeState state, const char *message)
+{
+	static const char *functionName = "finishBode";
+
+	if (connected_ &&
+	    (sendSetpoint(dscsParSetptAmp, bodeAxis_, bodeSavedAmp_) != asynSuccess ||
+	     sendSetpoint(dscsParSetptFreq, bodeAxis_, bodeSavedFreq_) != asynSuccess) && !message) {
+		message = "the modulation could not be put back";
+	}
+	if (message) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, sweep failed at %g Hz, %s\n",
+			driverName, functionName, this->portName, bodeFreq_, message);
+	}
+	bodeState_ = state;
+	setIntegerParam(BodeState_rbv_, bodeState_);
+	setStringParam(BodeMessage_rbv_, message ? message : "");
+}
+
+/*
+ * Publish the merged packet held in merged_, one array per secondary value.
+ * Called with the port lock held.
+ */
+void dscsAsyn::publishMerged()
+{
+	size_t n = merged_.times.size();
+
+	setTimeStamp(&merged_.stamp);
+	setIntegerParam(MergeAligned_rbv_, merged_.aligned);
+	callParamCallbacks();
+
+	doCallbacksInt32Array(merged_.data.data(), merged_.data.size(), MergeData_, 0);
+	doCallbacksFloat64Array(merged_.times.data(), n, MergeTime_, 0);
+	mergePos_.resize(n);
+	for (int k = 0; k < DSCS_MERGE_WIDTH; ++k) {
+		for (size_t i = 0; i < n; ++i) mergePos_[i] = merged_.values[i * DSCS_MERGE_WIDTH + k];
+		doCallbacksFloat64Array(mergePos_.data(), n, MergePos_[k], 0);
+	}
+
+	// capture, records laid out as described at DSCS_CAPTURE_MERGE
+	if (captureActive_[DSCS_CAPTURE_MERGE] && n > 0 && merged_.data.size() == n * DSCS_TUPLE_SIZE) {
+		dscsStreamChannel &channel = streamChannel_[mergeChannel_];
+		dscsCapturePacket capture;
+		capture.command = dscsCaptureData;
+		capture.codec = 0;
+		capture.nSamples = (int)n;
+		capture.width = DSCS_MERGE_CAPTURE_WIDTH;
+		capture.firstSample = merged_.firstSample;
+		capture.firstTime = merged_.times[0];
+		capture.period = n > 1 ? (merged_.times[n - 1] - merged_.times[0]) / (n - 1) :
+		                 channel.rate() > 0 ? 1 / channel.rate() : 0;
+		mergeCapture_.resize(n * DSCS_MERGE_CAPTURE_WIDTH);
+		for (size_t i = 0; i < n; ++i) {
+			epicsInt32 *record = &mergeCapture_[i * DSCS_MERGE_CAPTURE_WIDTH];
+			std::copy(&merged_.data[i * DSCS_TUPLE_SIZE], &merged_.data[(i + 1) * DSCS_TUPLE_SIZE], record);
+			for (int k = 0; k < DSCS_MERGE_WIDTH; ++k) {
+				double value = merged_.values[i * DSCS_MERGE_WIDTH + k] * DSCS_MERGE_CAPTURE_SCALE;
+				epicsUInt64 word = fabs(value) < 9e18 ? (epicsUInt64)llround(value) : (epicsUInt64)DSCS_MERGE_CAPTURE_NONE;
+				record[DSCS_TUPLE_SIZE + 2 * k] = (epicsInt32)(word & 0xffffffffu);
+				record[DSCS_TUPLE_SIZE + 2 * k + 1] = (epicsInt32)(word >> 32);
+			}
+		}
+		if (captureQueue_[DSCS_CAPTURE_MERGE]->push(capture, mergeCapture_.data())) epicsEventSignal(captureEvent_);
+	}
+}
+
+/*
+ * Merge stream channel `channel` (REL/ABS) with the secondary stream
+ * sourceChannel of port sourcePort. Called from iocsh before iocInit.
+ */
+asynStatus dscsAsyn::setMerge(const char *channel, const char *sourcePort, const char *sourceChannel)
+{
+	static const char *functionName = "setMerge";
+	int ch;
+
+	for (ch = 0; ch < DSCS_STREAM_CHANNELS; ++ch) {
+		if (channel && strcmp(channel, streamTags[ch]) == 0) break;
+	}
+	if (ch == DSCS_STREAM_CHANNELS || !sourcePort || !sourceChannel) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, invalid merge %s <- %s:%s\n",
+			driverName, functionName, this->portName, channel, sourcePort, sourceChannel);
+		return asynError;
+	}
+
+	lock(dscsLockShell);
+	merge_ = dscsStreamMerge::create(sourcePort, sourceChannel, DSCS_MERGE_WIDTH);
+	mergeChannel_ = ch;
+	unlock();
+	return merge_ ? asynSuccess : asynError;
+}
+
+/*
+ * Save a snapshot of every setpoint the controller can read back to file.
+ * The controller is read in one sweep under the port lock, so the snapshot
+ * is consistent with respect to writes through this driver.
+ */
+asynStatus dscsAsyn::saveSettings(const char *file)
+{
+	static const char *functionName = "saveSettings";
+	dscsSettings settings;
+	std::string error;
+	epicsUInt64 start = epicsMonotonicGet();
+	asynStatus status;
+
+	lock(dscsLockShell);
+	status = connected_ ? readSettings(settings) : asynDisconnected;
+	unlock();
+
+	if (status == asynSuccess && !settings.save(file, this->portName, error)) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s\n",
+			driverName, functionName, this->portName, error.c_str());
+		status = asynError;
+	}
+
+	lock(dscsLockShell);
+	setDoubleParam(SettingsTime_rbv_, (epicsMonotonicGet() - start) / 1e9);
+	setParamStatus(SettingsSave_, status);
+	callParamCallbacks();
+	unlock();
+	return status;
+}
+
+/*
+ * Scheduling of one driver thread, see dscsAsynThread and dscsThread.h
+ */
+asynStatus dscsAsyn::setThreadOptions(const char *thread, int priority, const char *cpus, const char *policy)
+{
+	static const char *functionName = "setThreadOptions";
+	int t;
+
+	for (t = 0; t < DSCS_NUM_THREADS && (!thread || epicsStrCaseCmp(thread, threadTags[t]) != 0); ++t) {}
+	if (t == DSCS_NUM_THREADS || !threads_[t]) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, unknown thread %s\n",
+			driverName, functionName, this->portName, thread ? thread : "");
+		return asynError;
+	}
+	return dscsSetThreadOptions(threads_[t], threadTags[t], priority, cpus, policy, this->pasynUserSelf, this->portName);
+}
+
+void dscsAsyn::reportThreads(FILE *fp)
+{
+	fprintf(fp, "  Thread       priority  policy      cpus\n");
+	for (int t = 0; t < DSCS_NUM_THREADS; ++t) {
+		if (threads_[t]) dscsReportThread(fp, threadTags[t], threads_[t]);
+	}
+}
+
+/*
+ * Restore a snapshot saved by saveSettings. Only settings that differ from
+ * the controller's current state are written, in dscsRestoreStage order.
+ * A restore overrides setpoints still waiting in the write queue.
+ */
+asynStatus dscsAsyn::restoreSettings(const char *file)
+{
+	static const char *functionName = "restoreSettings";
+	dscsSettings settings;
+	std::string error;
+	epicsUInt64 start = epicsMonotonicGet();
+	asynStatus status;
+	int writes = 0;
+
+	if (!settings.load(file, error)) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, %s\n",
+			driverName, functionName, this->portName, error.c_str());
+		lock(dscsLockShell);
+		setParamStatus(SettingsRestore_, asynError);
+		callParamCallbacks();
+		unlock();
+		return asynError;
+	}
+
+	lock(dscsLockShell);
+	status = connected_ ? applySettings(settings, &writes) : asynDisconnected;
+	double elapsed = (epicsMonotonicGet() - start) / 1e9;
+	asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+		"%s:%s, port %s, restored %s: %d of %d settings written in %.3f s, status=%d\n",
+		driverName, functionName, this->portName, file, writes, (int)settings.size(), elapsed, status);
+	setIntegerParam(SettingsWrites_rbv_, writes);
+	setDoubleParam(SettingsTime_rbv_, elapsed);
+	setParamStatus(SettingsRestore_, status);
+	callParamCallbacks();
+	unlock();
+	return status;
+}
+
+/*
+ * Read every snapshot row from the controller. Called with the port lock
+ * held.
+ */
+asynStatus dscsAsyn::readSettings(dscsSettings &settings)
+{
+	asynStatus status;
+	char name[64];
+	double value;
+
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		const dscsParamDesc &desc = dscsParamTable[row];
+		if (!dscsHasSnapshot(desc)) continue;
+
+		for (int chan = 0; chan < dscsChannelCount(desc.chans); ++chan) {
+			dscsParamName(desc, chan, false, name, sizeof(name));
+			status = checkStatus(name, desc.get(deviceNo, chan, &value));
+			if (status != asynSuccess) return status;
+			settings.set(name, value);
+		}
+	}
+	return asynSuccess;
+}
+
+/*
+ * Write the settings that differ from the controller, stage by stage. Both
+ * halves of a limit pair go in one call. A rejected setting is reported and
+ * the rest still applied; a link error ends the restore. Called with the
+ * port lock held.
+ */
+asynStatus dscsAsyn::applySettings(const dscsSettings &settings, int *writes)
+{
+	static const char *functionName = "applySettings";
+	asynStatus status, result = asynSuccess;
+	const dscsLimitPair *pair;
+	char name[64];
+	double want, have, dropped;
+
+	for (int stage = 0; stage < DSCS_NUM_STAGES; ++stage) {
+		for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+			const dscsParamDesc &desc = dscsParamTable[row];
+			if (!dscsHasSnapshot(desc) || dscsRestoreStageOf(desc.id) != stage) continue;
+
+			pair = findLimitPair(row);
+			if (pair) {
+				if (row != pair->min) continue;  // sent with its min row
+				int rows[2] = { pair->min, pair->max };
+				double pairWant[2], pairHave[2];
+				for (int k = 0; k < 2; ++k) {
+					dscsParamName(dscsParamTable[rows[k]], 0, false, name, sizeof(name));
+					status = checkStatus(name, dscsParamTable[rows[k]].get(deviceNo, 0, &pairHave[k]));
+					if (status != asynSuccess) return status;
+					if (!settings.find(name, &pairWant[k])) pairWant[k] = pairHave[k];
+				}
+				if (pairWant[0] == pairHave[0] && pairWant[1] == pairHave[1]) {
+					setSetpointValue(pair->min, 0, pairHave[0]);
+					setSetpointValue(pair->max, 0, pairHave[1]);
+					continue;
+				}
+				status = sendLimitPair(*pair, pairWant[0], pairWant[1]);
+				if (status == asynDisconnected) return status;
+				if (status != asynSuccess) { result = status; continue; }
+				for (int k = 0; k < 2; ++k) {
+					takePendingWrite(param_[rows[k]][0], &dropped);
+					writtenSetpoints_[param_[rows[k]][0]] = pairWant[k];
+				}
+				(*writes)++;
+				continue;
+			}
+
+			for (int chan = 0; chan < dscsChannelCount(desc.chans); ++chan) {
+				int function = param_[row][chan];
+				dscsParamName(desc, chan, false, name, sizeof(name));
+				if (!settings.find(name, &want)) continue;
+
+				status = checkStatus(name, desc.get(deviceNo, chan, &have));
+				if (status != asynSuccess) return status;
+				if (want == have) {
+					setSetpointValue(row, chan, have);
+					continue;
+				}
+
+				takePendingWrite(function, &dropped);
+				status = writeSetpoint(function, want);
+				if (status == asynDisconnected) return status;
+				if (status != asynSuccess) {
+					asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+						"%s:%s, port %s, failed to restore %s = %g\n",
+						driverName, functionName, this->portName, name, want);
+					result = status;
+					continue;
+				}
+				setSetpointValue(row, chan, want);
+				writtenSetpoints_[function] = want;
+				(*writes)++;
+			}
+		}
+	}
+	return result;
+}
+
+/*
+ * Set the setpoint and readback parameters of a row/channel to a value the
+ * controller is known to hold. Called with the port lock held.
+ */
+void dscsAsyn::setSetpointValue(int row, int chan, double value)
+{
+	int functions[2] = { param_[row][chan], rbvParam_[row][chan] };
+
+	for (int k = 0; k < 2; ++k) {
+		if (functions[k] < 0) continue;
+		if (dscsParamTable[row].type == asynParamFloat64) {
+			setDoubleParam(functions[k], value);
+		} else {
+			setIntegerParam(functions[k], (epicsInt32)value);
+		}
+		setParamStatus(functions[k], asynSuccess);
+	}
+}
+
+/*
+ * Decide whether a freshly polled readback is posted. A value is posted when
+ * it moves from the last posted one by more than the larger of the absolute
+ * and relative deadbands, but at most once per minInterval; a change held
+ * back by the rate limit is posted with the current value as soon as the
+ * interval has passed. Rows without a publish filter always pass. Called
+ * with the port lock held.
+ */
+bool dscsAsyn::filterReadback(int row, int chan, double value, epicsUInt64 now)
+{
+	if (filterParam_[row][0] < 0) return true;
+
+	const dscsPublishFilter &f = filter_[row];
+	dscsPublishState &st = publishState_[row][chan];
+	double threshold = f.adel > f.rdel * fabs(st.value) ? f.adel : f.rdel * fabs(st.value);
+	bool changed = st.time == 0 || fabs(value - st.value) > threshold;
 
-    	else if (function == PITargMode_) status = setPIControllerTargetMode(value);
+	if (!changed && !st.pending) return false;
+	if (st.time != 0 && (now - st.time) / 1e9 < f.minInterval) {
+		st.pending = true;
+		return false;
+	}
+
+	st.value = value;
+	st.time = now;
+	st.pending = false;
+	return true;
+}
 
-    	else if (function == NFOADCLimMin_) status = setNFOADCLimMin(value);
-    	else if (function == NFOADCLimMax_) status = setNFOADCLimMax(value);
+/*
+ * Store a publish filter setting if function is one. Called with the port
+ * lock held.
+ */
+bool dscsAsyn::setFilterParam(int function, double value)
+{
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		for (int which = 0; which < DSCS_NUM_FILTER_PARAMS; ++which) {
+			if (filterParam_[row][which] != function) continue;
+			if (value < 0) value = 0;
+			switch (which) {
+			case dscsFilterAdel:    filter_[row].adel = value; break;
+			case dscsFilterRdel:    filter_[row].rdel = value; break;
+			case dscsFilterMaxRate: filter_[row].minInterval = value > 0 ? 1.0 / value : 0; break;
+			}
+			// post the next poll's values under the new settings
+			for (int chan = 0; chan < DSCS_MAX_CHANNELS; ++chan) publishState_[row][chan].pending = true;
+			return true;
+		}
+	}
+	return false;
+}
 
-    	else if (function == NFOSlewLim_) status = setNFOSlewRateLimit(value);
+/*
+ *
+ * writeInt32
+ *
+ */
+asynStatus dscsAsyn::writeInt32(asynUser *pasynUser, epicsInt32 value)
+{
+	int function = pasynUser->reason;
+	asynStatus status = asynSuccess;
+	static const char *functionName = "writeInt32";
+	int captureChannel = -1;
 
-    	else if (function == SAMADCLimMin_) status = setSAMADCLimMin(value);
-    	else if (function == SAMADCLimMax_) status = setSAMADCLimMax(value);
+    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
+			"%s:%s, port %s, function = %d\n",
+			driverName, functionName, this->portName, function);
 
-    	else if (function == SAMSlewLim_) status = setSAMSlewRateLimit(value);
+	setIntegerParam(function, value);
+	for (int ch = 0; ch < DSCS_CAPTURE_CHANNELS; ++ch) {
+		if (function == CaptureEnable_[ch]) captureChannel = ch;
+	}
 
-    	else if (function == TrajStartX_) status = setTrajectoryLineStartX(value);
-    	else if (function == TrajEndX_) status = setTrajectoryLineEndX(value);
-    	else if (function == TrajSpeedX_) status = setTrajectoryLineSpeedX(value);
-    	else if (function == TrajStartY_) status = setTrajectoryLineStartY(value);
-    	else if (function == TrajDistY_) status = setTrajectoryLineDistY(value);
-    	else if (function == TrajCountY_) status = setTrajectoryLineCountY(value);
-    	else if (function == TrajTurnTime_) status = setTrajectoryTurnTime(value);
-    	else if (function == TrajPosTime_) status = setTrajectoryPosTime(value);
-    	else if (function == TrajAntiHyst_) status = setTrajectoryAntiHyst(value);
-    	else if (function == TrajSettings_) status = setTrajectorySettings(value);
+	if (function == PollTimingReset_) {
+		resetPollTiming();
+	}
+	else if (function == LockStatsReset_ && value) {
+		resetLockStats();
+	}
+	else if (function == StreamEnable_) {
+		// the replay stands in for the controller until it is done
+		status = value && replayState_ == dscsReplayRunning ? asynError : enableStream(value != 0);
+	}
+	else if (function == ReplayStart_ && value) {
+		status = startReplay();
+	}
+	else if (function == ReplayStop_ && value) {
+		if (replayState_ == dscsReplayRunning) finishReplay(dscsReplayAborted, NULL);
+	}
+	else if (captureChannel >= 0) {
+		status = enableCapture(captureChannel, value != 0);
+	}
+	else if (function == ReadFresh_) {
+		readFresh_ = value != 0;
+	}
+	else if (function == ScanPlan_ && value) {
+		status = planScan();
+	}
+	else if (function == ScanUpload_ && value) {
+		status = planValid_ ? uploadPlan(plan_) : asynError;
+	}
+	else if (function == TrajStart_ && value) {
+		status = startStagedTrajectory();
+	}
+	else if (function == TrajXColumn_) {
+		trajXColumn_ = value;
+	}
+	else if (function == InterlockLimColumn_) {
+		interlockLimColumn_ = value;
+	}
+	else if (function == InterlockTransColumn_) {
+		interlockTransColumn_ = value;
+	}
+	else if (function == TuneStart_ && value) {
+		status = startTuning();
+	}
+	else if (function == BodeRun_ && value) {
+		status = startBode();
+	}
+	else if (function == BodeAbort_ && value) {
+		if (bodeState_ == dscsBodeRunning) finishBode(dscsBodeAborted, NULL);
+	}
+	else if (function == ScanQueueLoad_ && value) {
+		char file[256];
+		getStringParam(ScanQueueFile_, sizeof(file), file);
+		status = loadScanQueue(file);
+	}
+	else if (function == ScanQueueStart_ && value) {
+		status = startScanQueue();
+	}
+	else if (function == ScanQueueStop_ && value) {
+		if (scanState_ == dscsScanRunning) stopScanQueue(dscsScanAborted);
+	}
+	else if (function == ScanQueueClear_ && value) {
+		if (scanState_ == dscsScanRunning) {
+			status = asynError;
+		} else {
+			scanQueue_.clear();
+			scanQueueTime_ = 0;
+			scanState_ = dscsScanIdle;
+			setIntegerParam(ScanQueueState_rbv_, scanState_);
+			setIntegerParam(ScanQueueLength_rbv_, 0);
+		}
+	}
+	else if (function == HistoryClear_ && value) {
+		for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+			for (int chan = 0; chan < DSCS_MAX_CHANNELS; ++chan) {
+				if (history_[row][chan]) history_[row][chan]->clear();
+			}
+		}
+		historyPublished_ = 0;
+	}
+	else if (function == InterlockReset_ && value) {
+		// a condition that is still there trips it again on the next check
+		interlock_ = 0;
+		setIntegerParam(Interlock_rbv_, 0);
+	}
+	else if ((function == SettingsSave_ || function == SettingsRestore_) && value) {
+		char file[256];
+		getStringParam(SettingsFile_, sizeof(file), file);
+		if (!file[0]) {
+			asynPrint(pasynUser, ASYN_TRACE_ERROR,
+				"%s:%s, port %s, SETTINGS_FILE is not set\n",
+				driverName, functionName, this->portName);
+			status = asynError;
+		} else if (function == SettingsSave_) {
+			status = saveSettings(file);
+		} else {
+			status = restoreSettings(file);
+		}
+	}
+	else {
+		status = queueSetpoint(function, value);
+	}
 
 	callParamCallbacks();
 
@@ -961,255 +2936,504 @@ asynStatus dscsAsyn::writeInt32(asynUser *pasynUser, epicsInt32 value)
 	return (status==0) ? asynSuccess : asynError;
 }
 
-// OSA_PS
-asynStatus dscsAsyn::setOSA_PS(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setOSA_PS";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setOSA_PS(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
+/*
+ *
+ * readInt32/readFloat64
+ *
+ * With READ_FRESH set, a read of a readback parameter fetches the value from
+ * the controller instead of returning what the poller last stored.
+ */
+asynStatus dscsAsyn::readInt32(asynUser *pasynUser, epicsInt32 *value)
+{
+	if (readFresh_) refreshReadback(pasynUser->reason);
+	return asynPortDriver::readInt32(pasynUser, value);
 }
 
-// BS_PS
-asynStatus dscsAsyn::setBS_PS(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setBS_PS";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setBS_PS(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
+asynStatus dscsAsyn::readFloat64(asynUser *pasynUser, epicsFloat64 *value)
+{
+	if (readFresh_) refreshReadback(pasynUser->reason);
+	return asynPortDriver::readFloat64(pasynUser, value);
 }
 
-// AUX_DAC
-asynStatus dscsAsyn::setAUX_DAC(DSCS_AUX_ADC aux, epicsInt32 value) {
-    static const char *functionName = "setAUX_DAC";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, aux = %d, value = %d\n", driverName, functionName, this->portName, aux, value);
-    return (DSCS_setAUX_DAC(deviceNo, aux, value) == 0) ? asynSuccess : asynError;
-}
+/*
+ * Read one readback from the controller unless it was read within
+ * freshWindow_. Requests are serialised by the port thread, so clients that
+ * read the same readback at the same instant queue up behind the first one
+ * and share its vendor call; a poll that stored the value counts as a read
+ * too. Called with the port lock held.
+ */
+asynStatus dscsAsyn::refreshReadback(int function)
+{
+	char name[64];
+	double value;
+
+	const dscsParamRef *ref = findParamRef(function);
+	if (!ref || !ref->readback || !connected_) return asynSuccess;
+	const dscsParamDesc &desc = dscsParamTable[ref->row];
+	if (!desc.get || (desc.type != asynParamInt32 && desc.type != asynParamFloat64)) return asynSuccess;
+
+	epicsUInt64 now = epicsMonotonicGet();
+	epicsUInt64 &last = readTime_[ref->row][ref->chan];
+	if (last != 0 && (now - last) / 1e9 < freshWindow_) {
+		setIntegerParam(ReadShared_rbv_, ++freshSharedReads_);
+		return asynSuccess;
+	}
 
-// NFO_PS
-asynStatus dscsAsyn::setNFO_PS(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setNFO_PS";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setNFO_PS(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
+	dscsParamName(desc, ref->chan, true, name, sizeof(name));
+	asynStatus status = checkStatus(name, desc.get(deviceNo, ref->chan, &value));
+	setIntegerParam(ReadDevice_rbv_, ++freshDeviceReads_);
+	if (status == asynSuccess) {
+		last = now;
+		if (desc.type == asynParamFloat64) {
+			setDoubleParam(function, value);
+		} else {
+			setIntegerParam(function, (epicsInt32)value);
+		}
+	}
+	setParamStatus(function, status);
+	return status;
 }
 
-// SAM_PS
-asynStatus dscsAsyn::setSAM_PS(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setSAM_PS";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setSAM_PS(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
+/*
+ *
+ * writeFloat64
+ *
+ */
+asynStatus dscsAsyn::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
+{
+	int function = pasynUser->reason;
+	asynStatus status = asynSuccess;
+	static const char *functionName = "writeFloat64";
 
-// SetpointModulationFrequency
-asynStatus dscsAsyn::setSetpointModulationFrequency(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setSetpointModulationFrequency";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setSetpointModulationFrequency(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
+    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
+			"%s:%s, port %s, function = %d\n",
+			driverName, functionName, this->portName, function);
 
-// SetpointModulationPhase
-asynStatus dscsAsyn::setSetpointModulationPhase(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setSetpointModulationPhase";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setSetpointModulationPhase(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
+	setDoubleParam(function, value);
 
-// SetpointModulationAmplitude
-asynStatus dscsAsyn::setSetpointModulationAmplitude(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setSetpointModulationAmplitude";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setSetpointModulationAmplitude(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
+	if (function == PollPeriod_) {
+		if (value > 0) {
+			pollTime_ = value;
+			resetPollTiming();
+		} else {
+			status = asynError;
+		}
+	}
+	else if (function == ReadFreshWindow_) {
+		freshWindow_ = value > 0 ? value : 0;
+	}
+	else if (function == InterlockPeriod_) {
+		interlockPeriod_ = value > 0 ? value : 0;
+	}
+	else if (function == HistoryPeriod_) {
+		historyPeriod_ = value > 0 ? value : 0;
+	}
+	else if (!setFilterParam(function, value)) {
+		status = queueSetpoint(function, value);
+	}
 
-// ExternalADCShift
-asynStatus dscsAsyn::setExternalADCShift(epicsInt32 value) {
-    static const char *functionName = "setExternalADCShift";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setExternalADCShift(deviceNo, value) == 0) ? asynSuccess : asynError;
-}
+	callParamCallbacks();
 
-// PI Controller NFO
-asynStatus dscsAsyn::setPIControllerEnabledNFO(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setPIControllerEnabledNFO";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setPIControllerEnabledNFO(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
-// move to float64
-// asynStatus dscsAsyn::setPIControllerIValueNFO(DSCS_Axis axis, epicsInt32 value) {
-//     static const char *functionName = "setPIControllerIValueNFO";
-//     asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-//     return (DSCS_setPIControllerIValueNFO(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-// }
-asynStatus dscsAsyn::setPIControllerPValueNFO(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setPIControllerPValueNFO";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setPIControllerPValueNFO(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
+	if (status == 0) {
+		asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
+             "%s:%s, port %s, wrote %f\n",
+             driverName, functionName, this->portName, value);
+	} else {
+		asynPrint(pasynUser, ASYN_TRACE_ERROR, 
+             "%s:%s, port %s, ERROR writing %f, status=%d\n",
+             driverName, functionName, this->portName, value, status);
+	}
+	
+	return (status==0) ? asynSuccess : asynError;
 }
 
-// NOT FOUND IN LIB YET
-asynStatus dscsAsyn::setPIControllerLimitNFO(epicsInt32 value) {
-    static const char *functionName = "setPIControllerLimitNFO";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    // return (DSCS_setPIControllerLimitNFO(deviceNo, value) == 0) ? asynSuccess : asynError;
-    return asynSuccess;
-}
-asynStatus dscsAsyn::setPIControllerAverageNFO(epicsInt32 value) {
-    static const char *functionName = "setPIControllerAverageNFO";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setPIControllerAverageNFO(deviceNo, (unsigned short)value) == 0) ? asynSuccess : asynError;
-}
-
-// PI Controller SAM
-asynStatus dscsAsyn::setPIControllerEnabledSAM(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setPIControllerEnabledSAM";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setPIControllerEnabledSAM(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
-// move to float64
-// asynStatus dscsAsyn::setPIControllerIValueSAM(DSCS_Axis axis, epicsInt32 value) {
-//     static const char *functionName = "setPIControllerIValueSAM";
-//     asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-//     return (DSCS_setPIControllerIValueSAM(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-// }
-asynStatus dscsAsyn::setPIControllerPValueSAM(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setPIControllerPValueSAM";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setPIControllerPValueSAM(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
-asynStatus dscsAsyn::setPIControllerLimitSAM(epicsInt32 value) {
-    static const char *functionName = "setPIControllerLimitSAM";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setPIControllerLimitSAM(deviceNo, value) == 0) ? asynSuccess : asynError;
-}
-
-// PI Controller Target
-asynStatus dscsAsyn::setPIControllerTargetPosition(DSCS_Axis axis, epicsInt32 value) {
-    static const char *functionName = "setPIControllerTargetPosition";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, axis = %d, value = %d\n", driverName, functionName, this->portName, axis, value);
-    return (DSCS_setPIControllerTargetPosition(deviceNo, axis, value) == 0) ? asynSuccess : asynError;
-}
-asynStatus dscsAsyn::setPIControllerTargetMode(epicsInt32 value) {
-    static const char *functionName = "setPIControllerTargetMode";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setPIControllerTargetMode(deviceNo, (DSCS_TargetMode)value) == 0) ? asynSuccess : asynError; // cast to DSCS_TargetMode
-}
-
-// NFOADCLimits (min/max)
-asynStatus dscsAsyn::setNFOADCLimMin(epicsInt32 value) {
-    static const char *functionName = "setNFOADCLimMin";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, min = %d\n", driverName, functionName, this->portName, value);
-    int max = 0;
-    int err = DSCS_getNFOADCLimits(deviceNo, nullptr, &max);
-    if (err != 0) {
-        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, ERROR reading max: %d\n", driverName, functionName, this->portName, err);
-        return asynError;
-    }
-    return (DSCS_setNFOADCLimits(deviceNo, value, max) == 0) ? asynSuccess : asynError;
-}
-asynStatus dscsAsyn::setNFOADCLimMax(epicsInt32 value) {
-    static const char *functionName = "setNFOADCLimMax";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, max = %d\n", driverName, functionName, this->portName, value);
-    int min = 0;
-    int err = DSCS_getNFOADCLimits(deviceNo, &min, nullptr);
-    if (err != 0) {
-        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, ERROR reading min: %d\n", driverName, functionName, this->portName, err);
-        return asynError;
-    }
-    return (DSCS_setNFOADCLimits(deviceNo, min, value) == 0) ? asynSuccess : asynError;
-}
+/*
+ * Queue a table setpoint for the writer thread and return at once, so a
+ * caller dragging a slider is not held up by the USB round trip of every
+ * intermediate value. A value still waiting for the same function is
+ * replaced, keeping its place in the queue. Functions that are not table
+ * setpoints are accepted and only stored in the parameter library. Called
+ * with the port lock held.
+ */
+asynStatus dscsAsyn::queueSetpoint(int function, double value)
+{
+	const dscsParamRef *ref = findParamRef(function);
+	if (!ref || ref->readback) return asynSuccess;
 
-// NFOSlewRateLimit
-asynStatus dscsAsyn::setNFOSlewRateLimit(epicsInt32 value) {
-    static const char *functionName = "setNFOSlewRateLimit";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setNFOSlewRateLimit(deviceNo, value) == 0) ? asynSuccess : asynError;
+	std::map<int, dscsPendingWrite>::iterator it = pendingWrites_.find(function);
+	if (it != pendingWrites_.end()) {
+		it->second.value = value;
+		setIntegerParam(WriteCoalesced_rbv_, ++writesCoalesced_);
+	} else {
+		dscsPendingWrite pending = { value, epicsMonotonicGet() };
+		pendingWrites_[function] = pending;
+		writeOrder_.push_back(function);
+		setIntegerParam(WriteQueue_rbv_, (int)writeOrder_.size());
+	}
+	epicsEventSignal(writeEvent_);
+	return asynSuccess;
 }
 
-// SAMADCLimits (min/max)
-asynStatus dscsAsyn::setSAMADCLimMin(epicsInt32 value) {
-    static const char *functionName = "setSAMADCLimMin";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, min = %d\n", driverName, functionName, this->portName, value);
-    int max = 0;
-    int err = DSCS_getSAMADCLimits(deviceNo, nullptr, &max);
-    if (err != 0) {
-        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, ERROR reading max: %d\n", driverName, functionName, this->portName, err);
-        return asynError;
-    }
-    return (DSCS_setSAMADCLimits(deviceNo, value, max) == 0) ? asynSuccess : asynError;
-}
-asynStatus dscsAsyn::setSAMADCLimMax(epicsInt32 value) {
-    static const char *functionName = "setSAMADCLimMax";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, max = %d\n", driverName, functionName, this->portName, value);
-    int min = 0;
-    int err = DSCS_getSAMADCLimits(deviceNo, &min, nullptr);
-    if (err != 0) {
-        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s, port %s, ERROR reading min: %d\n", driverName, functionName, this->portName, err);
-        return asynError;
-    }
-    return (DSCS_setSAMADCLimits(deviceNo, min, value) == 0) ? asynSuccess : asynError;
+/*
+ * Sends queued setpoints, oldest first. The outcome of each write is posted
+ * as the status of its parameter, so output records with asyn:READBACK show
+ * a rejected value as an alarm. The lock is dropped between writes so that
+ * new values can replace queued ones while a long queue drains. Writes wait
+ * in the queue while the link is down, and a limit half held by nextWrite
+ * until its partner arrives or its window ends.
+ */
+void dscsAsyn::writerThread()
+{
+	static const char *functionName = "writerThread";
+	asynStatus status;
+	int function;
+	double value, wait = -1;
+	epicsUInt64 queued;
+	const dscsParamRef *ref;
+	const dscsLimitPair *pair;
+
+	while (1) {
+		if (wait < 0) epicsEventWait(writeEvent_);
+		else epicsEventWaitWithTimeout(writeEvent_, wait);
+
+		lock(dscsLockWriter);
+		wait = -1;
+		while (connected_ && nextWrite(&function, &wait)) {
+			queued = pendingWrites_[function].queued;
+			takePendingWrite(function, &value);
+
+			ref = findParamRef(function);
+			pair = ref ? findLimitPair(ref->row) : NULL;
+			if (pair) {
+				status = writeLimitPair(*pair, function, value);
+			} else {
+				status = writeSetpoint(function, value);
+			}
+			if (status == asynSuccess) {
+				writtenSetpoints_[function] = value;
+			} else if (status == asynDisconnected) {
+				// send it again after the reconnect unless it was superseded
+				dscsPendingWrite pending = { value, queued };
+				if (pendingWrites_.insert(std::make_pair(function, pending)).second) {
+					writeOrder_.push_front(function);
+					setIntegerParam(WriteQueue_rbv_, (int)writeOrder_.size());
+				}
+			} else {
+				setIntegerParam(WriteErrors_rbv_, ++writeErrors_);
+				asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+					"%s:%s, port %s, ERROR writing function %d, value %g, status=%d\n",
+					driverName, functionName, this->portName, function, value, status);
+			}
+			setParamStatus(function, status);
+			callParamCallbacks();
+
+			unlock();
+			lock(dscsLockWriter);
+		}
+		unlock();
+	}
 }
 
-// SAMSlewRateLimit
-asynStatus dscsAsyn::setSAMSlewRateLimit(epicsInt32 value) {
-    static const char *functionName = "setSAMSlewRateLimit";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setSAMSlewRateLimit(deviceNo, value) == 0) ? asynSuccess : asynError;
+/*
+ * Pick the oldest queued write that can go now. A limit half queued without
+ * its partner is held for DSCS_LIMIT_WRITE_WINDOW and skipped meanwhile;
+ * wait is set to the s until the first held half is due, or -1 if none is
+ * held. Called with the port lock held.
+ */
+bool dscsAsyn::nextWrite(int *function, double *wait)
+{
+	epicsUInt64 now = epicsMonotonicGet();
+	const dscsParamRef *ref;
+	const dscsLimitPair *pair;
+	double left;
+
+	*wait = -1;
+	for (std::deque<int>::const_iterator it = writeOrder_.begin(); it != writeOrder_.end(); ++it) {
+		ref = findParamRef(*it);
+		pair = ref ? findLimitPair(ref->row) : NULL;
+		if (pair && !pendingWrites_.count(param_[ref->row == pair->min ? pair->max : pair->min][0])) {
+			left = DSCS_LIMIT_WRITE_WINDOW - (now - pendingWrites_[*it].queued) / 1e9;
+			if (left > 0) {
+				if (*wait < 0 || left < *wait) *wait = left;
+				continue;
+			}
+		}
+		*function = *it;
+		return true;
+	}
+	return false;
 }
 
-// Trajectory line parameters
-asynStatus dscsAsyn::setTrajectoryLineStartX(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryLineStartX";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryLineStartX(deviceNo, value) == 0) ? asynSuccess : asynError;
-}
-asynStatus dscsAsyn::setTrajectoryLineEndX(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryLineEndX";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryLineEndX(deviceNo, value) == 0) ? asynSuccess : asynError;
+/*
+ * Remove function from the write queue, returning its value. Called with the
+ * port lock held.
+ */
+bool dscsAsyn::takePendingWrite(int function, double *value)
+{
+	std::map<int, dscsPendingWrite>::iterator it = pendingWrites_.find(function);
+	if (it == pendingWrites_.end()) return false;
+
+	*value = it->second.value;
+	pendingWrites_.erase(it);
+	writeOrder_.erase(std::find(writeOrder_.begin(), writeOrder_.end(), function));
+	setIntegerParam(WriteQueue_rbv_, (int)writeOrder_.size());
+	return true;
 }
-asynStatus dscsAsyn::setTrajectoryLineSpeedX(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryLineSpeedX";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryLineSpeedX(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+const dscsLimitPair *dscsAsyn::findLimitPair(int row) const
+{
+	for (int i = 0; i < DSCS_NUM_LIMIT_PAIRS; ++i) {
+		if (dscsLimitPairs[i].min == row || dscsLimitPairs[i].max == row) return &dscsLimitPairs[i];
+	}
+	return NULL;
 }
-asynStatus dscsAsyn::setTrajectoryLineStartY(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryLineStartY";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryLineStartY(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+/*
+ * Write one half of a min/max pair from the queue. The other half is taken
+ * from the queue if it is waiting there, so a client that changes both sends
+ * one vendor call; nextWrite holds a half queued alone for up to
+ * DSCS_LIMIT_WRITE_WINDOW to give its partner the chance. Otherwise the
+ * other half is the value the controller last accepted through the driver,
+ * or its current one. Called from the writer thread with the port lock held.
+ */
+asynStatus dscsAsyn::writeLimitPair(const dscsLimitPair &pair, int function, double value)
+{
+	bool isMin = findParamRef(function)->row == pair.min;
+	int otherRow = isMin ? pair.max : pair.min;
+	int other = param_[otherRow][0];
+	double otherValue;
+	char name[64];
+	std::map<int, double>::const_iterator written = writtenSetpoints_.find(other);
+
+	if (takePendingWrite(other, &otherValue)) {
+		setIntegerParam(WriteCoalesced_rbv_, ++writesCoalesced_);
+	} else if (written != writtenSetpoints_.end()) {
+		// not the parameter, which may hold a value the controller rejected
+		otherValue = written->second;
+	} else {
+		dscsParamName(dscsParamTable[otherRow], 0, true, name, sizeof(name));
+		asynStatus status = checkStatus(name, dscsParamTable[otherRow].get(deviceNo, 0, &otherValue));
+		if (status != asynSuccess) return status;
+	}
+
+	asynStatus status = isMin ? sendLimitPair(pair, value, otherValue) : sendLimitPair(pair, otherValue, value);
+	if (status == asynSuccess) writtenSetpoints_[other] = otherValue;
+	setParamStatus(other, status);
+	return status;
 }
-asynStatus dscsAsyn::setTrajectoryLineDistY(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryLineDistY";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryLineDistY(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+/*
+ * Validate and send a min/max pair in one vendor call, then update the
+ * setpoints and readbacks of both halves. Called with the port lock held.
+ */
+asynStatus dscsAsyn::sendLimitPair(const dscsLimitPair &pair, double min, double max)
+{
+	static const char *functionName = "sendLimitPair";
+	char minName[64], maxName[64];
+
+	dscsParamName(dscsParamTable[pair.min], 0, false, minName, sizeof(minName));
+	dscsParamName(dscsParamTable[pair.max], 0, false, maxName, sizeof(maxName));
+
+	if (!(min < max)) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, rejected %s %g, must be below %s %g\n",
+			driverName, functionName, this->portName, minName, min, maxName, max);
+		return asynError;
+	}
+
+	asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, %s = %g, %s = %g\n",
+		driverName, functionName, this->portName, minName, min, maxName, max);
+	asynStatus status = checkStatus(minName, pair.set(deviceNo, min, max));
+	if (status != asynSuccess) return status;
+
+	setIntegerParam(param_[pair.min][0], (epicsInt32)min);
+	setIntegerParam(param_[pair.max][0], (epicsInt32)max);
+	setIntegerParam(rbvParam_[pair.min][0], (epicsInt32)min);
+	setIntegerParam(rbvParam_[pair.max][0], (epicsInt32)max);
+	return asynSuccess;
 }
-asynStatus dscsAsyn::setTrajectoryLineCountY(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryLineCountY";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryLineCountY(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+/*
+ * Send one setpoint to the controller through its table row. Shared by the
+ * write methods and the post-reconnect restore. Functions that are not table
+ * setpoints are accepted and only stored in the parameter library. Called
+ * with the port lock held.
+ */
+asynStatus dscsAsyn::writeSetpoint(int function, double value)
+{
+	static const char *functionName = "writeSetpoint";
+	char name[64];
+
+	const dscsParamRef *ref = findParamRef(function);
+	if (!ref || ref->readback) return asynSuccess;
+
+	const dscsParamDesc &desc = dscsParamTable[ref->row];
+	dscsParamName(desc, ref->chan, false, name, sizeof(name));
+
+	if (!desc.set) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, %s is not supported by the vendor library\n",
+			driverName, functionName, this->portName, name);
+		return asynError;
+	}
+
+	asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, %s = %g\n",
+		driverName, functionName, this->portName, name, value);
+	return checkStatus(name, desc.set(deviceNo, ref->chan, value));
 }
-asynStatus dscsAsyn::setTrajectoryTurnTime(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryTurnTime";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryTurnTime(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+/*
+ * Create the setpoint and readback parameters of every table row and record
+ * which row/channel each asyn function belongs to.
+ */
+void dscsAsyn::createTableParams()
+{
+	char name[64];
+
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		const dscsParamDesc &desc = dscsParamTable[row];
+
+		for (int chan = 0; chan < DSCS_MAX_CHANNELS; ++chan) {
+			param_[row][chan] = -1;
+			rbvParam_[row][chan] = -1;
+		}
+
+		for (int chan = 0; chan < dscsChannelCount(desc.chans); ++chan) {
+			dscsParamRef ref = { row, chan, false };
+
+			if (desc.flags & dscsParamSetpoint) {
+				dscsParamName(desc, chan, false, name, sizeof(name));
+				createParam(name, desc.type, &param_[row][chan]);
+				if ((int)paramRefs_.size() <= param_[row][chan]) paramRefs_.resize(param_[row][chan] + 1);
+				paramRefs_[param_[row][chan]] = ref;
+			}
+			if (desc.flags & dscsParamReadback) {
+				ref.readback = true;
+				dscsParamName(desc, chan, true, name, sizeof(name));
+				createParam(name, desc.type, &rbvParam_[row][chan]);
+				if ((int)paramRefs_.size() <= rbvParam_[row][chan]) paramRefs_.resize(rbvParam_[row][chan] + 1);
+				paramRefs_[rbvParam_[row][chan]] = ref;
+			}
+		}
+	}
+
+	// after all table parameters, so paramRefs_ has no holes
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		const dscsParamDesc &desc = dscsParamTable[row];
+
+		for (int which = 0; which < DSCS_NUM_FILTER_PARAMS; ++which) {
+			filterParam_[row][which] = -1;
+			if (!dscsHasPublishFilter(desc)) continue;
+			dscsFilterParamName(desc, which, name, sizeof(name));
+			createParam(name, asynParamFloat64, &filterParam_[row][which]);
+			setDoubleParam(filterParam_[row][which], 0);
+		}
+	}
 }
-asynStatus dscsAsyn::setTrajectoryPosTime(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryPosTime";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryPosTime(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+/*
+ * Create the history arrays of the DSCS_HI rows and cut their histories from
+ * one arena, so polling never allocates.
+ */
+void dscsAsyn::createHistories()
+{
+	char name[64];
+	size_t histories = 0, offset = 0;
+
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		if (dscsHasHistory(dscsParamTable[row])) histories += dscsChannelCount(dscsParamTable[row].chans);
+	}
+	historyArena_.resize(histories * DSCS_HISTORY_BLOCKS * DSCS_HISTORY_BLOCK_BYTES);
+
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		const dscsParamDesc &desc = dscsParamTable[row];
+
+		for (int chan = 0; chan < DSCS_MAX_CHANNELS; ++chan) {
+			historyParam_[row][chan] = -1;
+			historyTimeParam_[row][chan] = -1;
+			history_[row][chan] = NULL;
+			if (!dscsHasHistory(desc) || chan >= dscsChannelCount(desc.chans)) continue;
+
+			dscsHistoryParamName(desc, chan, false, name, sizeof(name));
+			createParam(name, asynParamInt32Array, &historyParam_[row][chan]);
+			dscsHistoryParamName(desc, chan, true, name, sizeof(name));
+			createParam(name, asynParamFloat64Array, &historyTimeParam_[row][chan]);
+			history_[row][chan] = new dscsHistory(historyArena_.data() + offset, DSCS_HISTORY_BLOCKS);
+			offset += DSCS_HISTORY_BLOCKS * DSCS_HISTORY_BLOCK_BYTES;
+		}
+	}
+
+	createParam("HISTORY_PERIOD",       asynParamFloat64, &HistoryPeriod_);
+	createParam("HISTORY_CLEAR",        asynParamInt32,   &HistoryClear_);
+	createParam("HISTORY_BYTES_RBV",    asynParamInt32,   &HistoryBytes_rbv_);
+	setDoubleParam(HistoryPeriod_, historyPeriod_);
+	setIntegerParam(HistoryBytes_rbv_, (epicsInt32)historyArena_.size());
 }
-asynStatus dscsAsyn::setTrajectoryAntiHyst(epicsInt32 value) {
-    static const char *functionName = "setTrajectoryAntiHyst";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectoryAntiHyst(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+/*
+ * Post every history with its time axis, at most every historyPeriod_.
+ * Decoding is cheap next to a poll sweep, and a trend display only needs a
+ * refresh now and then. Called with the port lock held.
+ */
+void dscsAsyn::publishHistories(epicsUInt64 now)
+{
+	if (historyPeriod_ <= 0 || now - historyPublished_ < historyPeriod_ * 1e9) return;
+	historyPublished_ = now;
+
+	for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+		for (int chan = 0; chan < DSCS_MAX_CHANNELS; ++chan) {
+			if (!history_[row][chan]) continue;
+			history_[row][chan]->copy(historyValues_, historyTimes_);
+			doCallbacksInt32Array(historyValues_.data(), historyValues_.size(), historyParam_[row][chan], 0);
+			doCallbacksFloat64Array(historyTimes_.data(), historyTimes_.size(), historyTimeParam_[row][chan], 0);
+		}
+	}
 }
-asynStatus dscsAsyn::setTrajectorySettings(epicsInt32 value) {
-    static const char *functionName = "setTrajectorySettings";
-    asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, value = %d\n", driverName, functionName, this->portName, value);
-    return (DSCS_setTrajectorySettings(deviceNo, value) == 0) ? asynSuccess : asynError;
+
+const dscsAsyn::dscsParamRef *dscsAsyn::findParamRef(int function) const
+{
+	if (function < 0 || function >= (int)paramRefs_.size()) return NULL;
+	if (paramRefs_[function].row < 0) return NULL;
+	return &paramRefs_[function];
 }
 
 
 void dscsAsyn::report(FILE *fp, int details)
 {
+    dscsLockStats stats[DSCS_NUM_LOCK_SITES];
+
     asynPortDriver::report(fp, details);
     fprintf(fp, "* Port: %s\n", 
         this->portName);
+
+    if (details >= 1) {
+        reportThreads(fp);
+
+        lock(dscsLockShell);
+        for (int site = 0; site < DSCS_NUM_LOCK_SITES; ++site) stats[site] = lockStats_[site];
+        unlock();
+
+        fprintf(fp, "  Port lock          count   wait mean    p99      max    hold mean    p99      max  (ms)\n");
+        for (int site = 0; site < DSCS_NUM_LOCK_SITES; ++site) {
+            const dscsLockStats &s = stats[site];
+            if (s.count == 0) continue;
+            fprintf(fp, "    %-12s %9d  %8.3f %8.3f %8.3f  %8.3f %8.3f %8.3f\n", lockSiteTags[site], s.count,
+                s.wait.total / 1e6 / s.count, s.wait.percentile(0.99) * 1e3, s.wait.max / 1e6,
+                s.hold.total / 1e6 / s.count, s.hold.percentile(0.99) * 1e3, s.hold.max / 1e6);
+        }
+        if (details >= 2) {
+            fprintf(fp, "  Histograms, acquisitions per bucket; bucket k holds times under 2^k us\n");
+            for (int site = 0; site < DSCS_NUM_LOCK_SITES; ++site) {
+                if (stats[site].count == 0) continue;
+                for (int which = 0; which < 2; ++which) {
+                    const dscsLockHistogram &h = which ? stats[site].hold : stats[site].wait;
+                    fprintf(fp, "    %-12s %s", lockSiteTags[site], which ? "hold" : "wait");
+                    for (int k = 0; k < DSCS_LOCK_BUCKETS; ++k) fprintf(fp, " %d", h.counts[k]);
+                    fprintf(fp, "\n");
+                }
+            }
+        }
+    }
     fprintf(fp, "\n");
 }
 
@@ -1230,9 +3454,100 @@ static void dscsAsynCallFunc(const iocshArgBuf *args)
     dscsAsynConfig(args[0].sval, args[1].sval, args[2].ival);
 }
 
+extern "C" int dscsAsynMerge(const char *portName, const char *channel, const char *sourcePort, const char *sourceChannel)
+{
+    dscsAsyn *pdscsAsyn = (dscsAsyn *)findAsynPortDriver(portName);
+    if (!pdscsAsyn) {
+        printf("dscsAsynMerge: port %s not found\n", portName);
+        return(asynError);
+    }
+    return(pdscsAsyn->setMerge(channel, sourcePort, sourceChannel));
+}
+
+static const iocshArg dscsAsynMergeArg0 = { "Port name", iocshArgString};
+static const iocshArg dscsAsynMergeArg1 = { "Stream channel (REL/ABS)", iocshArgString};
+static const iocshArg dscsAsynMergeArg2 = { "Source port name", iocshArgString};
+static const iocshArg dscsAsynMergeArg3 = { "Source channel", iocshArgString};
+static const iocshArg * const dscsAsynMergeArgs[4] = {&dscsAsynMergeArg0, &dscsAsynMergeArg1, &dscsAsynMergeArg2, &dscsAsynMergeArg3};
+static const iocshFuncDef dscsAsynMergeFuncDef = {"dscsAsynMerge", 4, dscsAsynMergeArgs};
+static void dscsAsynMergeCallFunc(const iocshArgBuf *args)
+{
+    dscsAsynMerge(args[0].sval, args[1].sval, args[2].sval, args[3].sval);
+}
+
+extern "C" int dscsAsynSaveSettings(const char *portName, const char *file)
+{
+    dscsAsyn *pdscsAsyn = (dscsAsyn *)findAsynPortDriver(portName);
+    if (!pdscsAsyn) {
+        printf("dscsAsynSaveSettings: port %s not found\n", portName);
+        return(asynError);
+    }
+    return(pdscsAsyn->saveSettings(file));
+}
+
+extern "C" int dscsAsynRestoreSettings(const char *portName, const char *file)
+{
+    dscsAsyn *pdscsAsyn = (dscsAsyn *)findAsynPortDriver(portName);
+    if (!pdscsAsyn) {
+        printf("dscsAsynRestoreSettings: port %s not found\n", portName);
+        return(asynError);
+    }
+    return(pdscsAsyn->restoreSettings(file));
+}
+
+static const iocshArg dscsAsynSettingsArg0 = { "Port name", iocshArgString};
+static const iocshArg dscsAsynSettingsArg1 = { "Settings file", iocshArgString};
+static const iocshArg * const dscsAsynSettingsArgs[2] = {&dscsAsynSettingsArg0, &dscsAsynSettingsArg1};
+static const iocshFuncDef dscsAsynSaveSettingsFuncDef = {"dscsAsynSaveSettings", 2, dscsAsynSettingsArgs};
+static const iocshFuncDef dscsAsynRestoreSettingsFuncDef = {"dscsAsynRestoreSettings", 2, dscsAsynSettingsArgs};
+static void dscsAsynSaveSettingsCallFunc(const iocshArgBuf *args)
+{
+    dscsAsynSaveSettings(args[0].sval, args[1].sval);
+}
+static void dscsAsynRestoreSettingsCallFunc(const iocshArgBuf *args)
+{
+    dscsAsynRestoreSettings(args[0].sval, args[1].sval);
+}
+
+/*
+ * dscsAsynThread(port, thread, priority, cpus, policy), after dscsAsynConfig.
+ * thread is POLLER, WRITER, STREAM, WATCH, SCAN, CAPTURE or REPLAY;
+ * priority 0-99 or -1 to keep it, cpus e.g. "2,3" or "4-7", policy FIFO or
+ * OTHER; see dscsThread.h. E.g. to give the stream publisher
+ * core 3 at real-time priority:
+ *   dscsAsynThread("DSCS1", "STREAM", 80, "3", "FIFO")
+ */
+extern "C" int dscsAsynThread(const char *portName, const char *thread, int priority, const char *cpus,
+                              const char *policy)
+{
+    dscsAsyn *pdscsAsyn = (dscsAsyn *)findAsynPortDriver(portName);
+    if (!pdscsAsyn) {
+        printf("dscsAsynThread: port %s not found\n", portName);
+        return(asynError);
+    }
+    return(pdscsAsyn->setThreadOptions(thread, priority, cpus, policy));
+}
+
+static const iocshArg dscsAsynThreadArg0 = { "Port name", iocshArgString};
+static const iocshArg dscsAsynThreadArg1 = { "Thread (POLLER/WRITER/STREAM/WATCH/SCAN/CAPTURE/REPLAY)", iocshArgString};
+static const iocshArg dscsAsynThreadArg2 = { "Priority (0-99, -1 to keep)", iocshArgInt};
+static const iocshArg dscsAsynThreadArg3 = { "CPUs (e.g. 2,3 or 4-7)", iocshArgString};
+static const iocshArg dscsAsynThreadArg4 = { "Policy (FIFO/OTHER)", iocshArgString};
+static const iocshArg * const dscsAsynThreadArgs[5] = {&dscsAsynThreadArg0, &dscsAsynThreadArg1, &dscsAsynThreadArg2,
+                                                       &dscsAsynThreadArg3, &dscsAsynThreadArg4};
+static const iocshFuncDef dscsAsynThreadFuncDef = {"dscsAsynThread", 5, dscsAsynThreadArgs};
+static void dscsAsynThreadCallFunc(const iocshArgBuf *args)
+{
+    dscsAsynThread(args[0].sval, args[1].sval, args[2].ival, args[3].sval, args[4].sval);
+}
+
 void drvdscsAsynRegister(void)
 {
     iocshRegister(&dscsAsynFuncDef, dscsAsynCallFunc);
+    iocshRegister(&dscsAsynMergeFuncDef, dscsAsynMergeCallFunc);
+    iocshRegister(&dscsAsynSaveSettingsFuncDef, dscsAsynSaveSettingsCallFunc);
+    iocshRegister(&dscsAsynRestoreSettingsFuncDef, dscsAsynRestoreSettingsCallFunc);
+    iocshRegister(&dscsAsynThreadFuncDef, dscsAsynThreadCallFunc);
 }
 
 extern "C" {
@@ -6,8 +6,25 @@
 
 
 
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
 #include <asynPortDriver.h>
 
+#include "dscsAsynParams.h"
+#include "dscsStream.h"
+#include "dscsStreamMerge.h"
+#include "dscsSettings.h"
+#include "dscsTrajectory.h"
+#include "dscsStepResponse.h"
+#include "dscsBode.h"
+#include "dscsHistory.h"
+#include "dscsCapture.h"
+#include "dscsThread.h"
+
 static const char *driverName = "dscsAsyn";
 
 #define MAX_CONTROLLERS	1
@@ -15,6 +32,212 @@ static const char *driverName = "dscsAsyn";
 
 #define DEFAULT_CONTROLLER_TIMEOUT 2.0
 
+#define DEFAULT_RECONNECT_TIME 2.0
+
+#define DEFAULT_SLOW_POLL_DIVISOR 10
+
+#define POLL_STATS_WEIGHT 0.1 // weight of the newest cycle in the rate/jitter averages
+
+#define DSCS_LIMIT_WRITE_WINDOW 0.02 // s a limit half waits in the queue for the other half
+#define DSCS_FRESH_WINDOW 0.01       // s a readback read from the controller counts as fresh
+
+#define DSCS_INTERLOCK_PERIOD 0.05   // s between limiter/transformation state reads when not streamed
+#define DSCS_INTERLOCK_HISTORY 4096  // tuples per stream channel kept for the interlock snapshot
+
+#define DSCS_HISTORY_BLOCKS 64       // dscsHistory blocks per DSCS_HI readback channel
+#define DSCS_HISTORY_PERIOD 1.0      // s between history publishes
+
+#define DSCS_SCAN_UPDATE 0.1         // s between scan queue progress updates
+#define DSCS_SCAN_SETTLE 0.1         // default SCAN_QUEUE_SETTLE, s
+#define DSCS_SCAN_TILE_VALUES 4      // SCAN_QUEUE_TILES values per tile: start X, start Y, width, height
+
+// SCAN_QUEUE_STATE_RBV
+typedef enum {
+    dscsScanIdle,
+    dscsScanRunning,
+    dscsScanDone,
+    dscsScanAborted
+} dscsScanState;
+
+#define DSCS_TUNE_AXES 3             // PI_TARG_POS_X..Z
+#define DSCS_TUNE_UPDATE 0.01        // s between checks of a running step test or sweep
+#define DSCS_TUNE_BASELINE 0.2       // fraction of TUNE_DURATION captured before the step
+#define DSCS_TUNE_MAX_SAMPLES 200000 // tuples captured per step test
+
+// TUNE_STATE_RBV
+typedef enum {
+    dscsTuneIdle,
+    dscsTuneBaseline,   // capturing before the step
+    dscsTuneResponse,   // step applied, capturing the response
+    dscsTuneDone,
+    dscsTuneFailed
+} dscsTuneState;
+
+#define DSCS_BODE_MAX_POINTS 1000    // frequencies per sweep
+
+// BODE_STATE_RBV
+typedef enum {
+    dscsBodeIdle,
+    dscsBodeRunning,
+    dscsBodeDone,
+    dscsBodeFailed,
+    dscsBodeAborted
+} dscsBodeState;
+
+// INTERLOCK_RBV bits
+#define dscsInterlockLimiter        0x1 // limiter set the outputs to 0 V (OutputNull)
+#define dscsInterlockTransformation 0x2 // input transformation error
+
+#define DSCS_STREAM_CHANNELS 2 // data callback channels, REL and ABS
+#define DSCS_STREAM_QUEUE_PACKETS 1024
+#define DSCS_STREAM_QUEUE_VALUES (1 << 20) // Int32 values buffered per channel
+#define DSCS_MERGE_WIDTH 3 // values per sample of a merged secondary stream (interferometer axes)
+#define DSCS_CAPTURE_QUEUE_PACKETS 4096
+#define DSCS_CAPTURE_QUEUE_VALUES (1 << 22) // Int32 values waiting for the capture writer per channel
+#define DSCS_CAPTURE_UPDATE 0.5 // s between capture statistics updates
+
+/*
+ * Captures, one per stream channel plus DSCS_CAPTURE_MERGE for the merged
+ * records (dscsAsynMerge). A merged record is the primary tuple followed by
+ * each secondary value in thousandths of its unit (pm for quDIS nm), as a
+ * 64-bit integer stored low word first; DSCS_MERGE_CAPTURE_NONE marks a
+ * value the merge could not interpolate.
+ */
+#define DSCS_CAPTURE_CHANNELS (DSCS_STREAM_CHANNELS + 1)
+#define DSCS_CAPTURE_MERGE DSCS_STREAM_CHANNELS
+#define DSCS_MERGE_CAPTURE_WIDTH (DSCS_TUPLE_SIZE + 2 * DSCS_MERGE_WIDTH)
+#define DSCS_MERGE_CAPTURE_SCALE 1000.0
+#define DSCS_MERGE_CAPTURE_NONE INT64_MIN
+
+/*
+ * A packet on its way to the capture writer. Open and close travel through
+ * the same queue as the samples, so a capture holds exactly the packets
+ * published between them.
+ */
+typedef enum {
+    dscsCaptureData,
+    dscsCaptureOpen,    // next file in captureFiles_
+    dscsCaptureClose
+} dscsCaptureCommand;
+
+struct dscsCapturePacket {
+    int command;             // dscsCaptureCommand
+    int codec;               // dscsCaptureCodec, for dscsCaptureOpen
+    int nSamples;
+    int width;
+    epicsUInt64 firstSample; // unwrapped stream sample number
+    double firstTime;        // s past the EPICS epoch
+    double period;           // s per sample
+};
+
+#define DSCS_REPLAY_PACKET 1000 // default tuples per replayed packet
+#define DSCS_REPLAY_UPDATE 0.2  // s between replay progress updates
+
+// REPLAY_STATE_RBV
+typedef enum {
+    dscsReplayIdle,
+    dscsReplayRunning,
+    dscsReplayDone,
+    dscsReplayFailed,
+    dscsReplayAborted
+} dscsReplayState;
+
+/*
+ * Poll cycle timing, in monotonic ns and seconds
+ */
+struct dscsPollTiming {
+    epicsUInt64 deadline = 0;  // scheduled start of the next cycle, 0 = not scheduled
+    epicsUInt64 lastStart = 0; // start of the previous cycle
+    double lastCycle = 0;      // duration of the last sweep
+    double maxCycle = 0;       // longest sweep since reset
+    double avgPeriod = 0;      // averaged start-to-start interval
+    double jitterVar = 0;      // averaged squared deviation from pollTime_
+    int overruns = 0;          // sweeps that ran past the next deadline
+};
+
+/*
+ * Port lock call sites, see dscsAsyn::lock. LOCK_*_<tag> parameters hold
+ * the statistics of each.
+ */
+typedef enum {
+    dscsLockAsyn,       // asyn requests from the port thread, and unlabelled sites
+    dscsLockConnect,
+    dscsLockDisconnect,
+    dscsLockPoller,
+    dscsLockWriter,
+    dscsLockStream,
+    dscsLockCapture,
+    dscsLockReplay,
+    dscsLockWatch,
+    dscsLockScan,
+    dscsLockShell,      // iocsh commands: merge, settings save/restore
+    DSCS_NUM_LOCK_SITES
+} dscsLockSite;
+
+#define DSCS_LOCK_BUCKETS 24 // bucket 0 < 1 us, bucket k < 2^k us, the last one open
+#define DSCS_LOCK_UPDATE 1.0 // s between lock statistics updates
+
+/*
+ * log2 histogram of lock wait or hold times
+ */
+struct dscsLockHistogram {
+    epicsInt32 counts[DSCS_LOCK_BUCKETS] = {};
+    epicsUInt64 total = 0;     // ns
+    epicsUInt64 max = 0;       // ns
+
+    void add(epicsUInt64 ns)
+    {
+        int k = 0;
+        for (epicsUInt64 us = ns / 1000; us && k < DSCS_LOCK_BUCKETS - 1; us >>= 1) k++;
+        counts[k]++;
+        total += ns;
+        if (ns > max) max = ns;
+    }
+
+    // Upper edge of the bucket holding fraction p of the times, s; an
+    // upper bound of the percentile
+    double percentile(double p) const
+    {
+        epicsUInt64 n = 0, seen = 0;
+        for (int k = 0; k < DSCS_LOCK_BUCKETS; ++k) n += counts[k];
+        for (int k = 0; k < DSCS_LOCK_BUCKETS - 1; ++k) {
+            seen += counts[k];
+            if (n > 0 && seen >= p * n) return (1 << k) * 1e-6;
+        }
+        return max / 1e9;
+    }
+};
+
+struct dscsLockStats {
+    epicsInt32 count = 0;      // outermost acquisitions since reset
+    dscsLockHistogram wait;    // from lock() until the lock was granted
+    dscsLockHistogram hold;    // from then until the matching unlock()
+};
+
+/*
+ * Driver threads, whose scheduling dscsAsynThread sets. The step test and
+ * the frequency response sweep run on the scan thread.
+ */
+typedef enum {
+    dscsThreadPoller,
+    dscsThreadWriter,
+    dscsThreadStream,   // stream publisher
+    dscsThreadWatch,    // interlock watcher
+    dscsThreadScan,     // scan queue and the tuning analyses
+    dscsThreadCapture,  // capture writer
+    dscsThreadReplay,
+    DSCS_NUM_THREADS
+} dscsThread;
+
+/*
+ * Classification of vendor library return codes
+ */
+typedef enum {
+    dscsErrorNone,    // DSCS_Ok
+    dscsErrorCommand, // the call failed but the link is still usable
+    dscsErrorLink     // timeout/not connected/driver error; link is down
+} dscsErrorClass;
+
 /*
  * Class definition for the dscsAsyn class
  */
@@ -38,225 +261,471 @@ public:
     // These should be private but are called from C
 
     virtual asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
+    virtual asynStatus writeFloat64(asynUser *pasynUser, epicsFloat64 value);
+    virtual asynStatus readInt32(asynUser *pasynUser, epicsInt32 *value);
+    virtual asynStatus readFloat64(asynUser *pasynUser, epicsFloat64 *value);
+    virtual asynStatus writeFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements);
+
+    // The port lock, timed per call site; plain lock() counts as dscsLockAsyn
+    virtual asynStatus lock();
+    asynStatus lock(dscsLockSite site);
+    virtual asynStatus unlock();
 
     virtual asynStatus connect(asynUser *pasynUser);
     virtual asynStatus disconnect(asynUser *pasynUser);
     virtual void pollerThread(void);
+    asynStatus pollReadbacks(dscsPollClass pollClass);
 
 	void pollAnalogIn();
 
+	void dataCallback(int channel, int length, int index, const epicsInt32 *data,
+	                  const epicsTimeStamp *arrival = NULL);
+	void streamThread(void);
+	void writerThread(void);
+	void watchThread(void);
+	void scanThread(void);
+	void captureThread(void);
+	void replayThread(void);
+	asynStatus setMerge(const char *channel, const char *sourcePort, const char *sourceChannel);
+	asynStatus saveSettings(const char *file);
+	asynStatus restoreSettings(const char *file);
+	asynStatus setThreadOptions(const char *thread, int priority, const char *cpus, const char *policy);
+
 protected:
 
-	int OSA_PS_[2];          // x and y axis; DSCS_setOSA_PS
-	int OSA_PS_rbv_[2];      // x and y axis; DSCS_getOSA_PS
-	
-	int BS_PS_[2];           // x and y axis; DSCS_setBS_PS
-	int BS_PS_rbv_[2];       // x and y axis; DSCS_getBS_PS
-	
-	int AUX_DAC_[4];         // index 0-3; DSCS_setAUX_DAC
-	int AUX_DAC_rbv_[4];     // index 0-3; DSCS_getAUX_DAC
-	
-	int NFO_PS_[3];          // x, y, z axis; DSCS_setNFO_PS
-	int NFO_PS_rbv_[3];      // x, y, z axis; DSCS_getNFO_PS
-	
-	int SAM_PS_[3];          // x, y, z axis; DSCS_setSAM_PS
-	int SAM_PS_rbv_[3];      // x, y, z axis; DSCS_getSAM_PS
-	
-	int NFO_SG_rbv_[3];      // x, y, z axis; DSCS_getNFO_SG
-	int SAM_CP_D_rbv_[3];    // x, y, z axis; DSCS_getSAM_CP_D
-	int XZ_ZX_rbv_[2];       // index 0-1; DSCS_getXZ_ZX
-	int AUX_ADC_rbv_[3];     // index 0-2; DSCS_getAUX_ADC
-	int NFO_rbv_[3];         // x, y, z axis; DSCS_getNFO
-	int SAM_rbv_[3];         // x, y, z axis; DSCS_getSAM
-	
-	int SetptFreq_[3];       // x, y, z axis; full: SetpointModulationFrequency; DSCS_setSetpointModulationFrequency
-	int SetptFreq_rbv_[3];   // x, y, z axis; full: SetpointModulationFrequency; DSCS_getSetpointModulationFrequency
-	
-	int SetptPhase_[3];      // x, y, z axis; full: SetpointModulationPhase; DSCS_setSetpointModulationPhase
-	int SetptPhase_rbv_[3];  // x, y, z axis; full: SetpointModulationPhase; DSCS_getSetpointModulationPhase
-	
-	int SetptAmp_[3];        // x, y, z axis; full: SetpointModulationAmplitude; DSCS_setSetpointModulationAmplitude
-	int SetptAmp_rbv_[3];    // x, y, z axis; full: SetpointModulationAmplitude; DSCS_getSetpointModulationAmplitude
-	
-	int ExtADCShift_;        // single value; full: ExternalADCShift; DSCS_setExternalADCShift
-	int ExtADCShift_rbv_;    // single value; full: ExternalADCShift; DSCS_getExternalADCShift
-	
-	int PIEnNFO_[3];         // x, y, z axis; full: PIControllerEnabledNFO; DSCS_setPIControllerEnabledNFO
-	int PIEnNFO_rbv_[3];     // x, y, z axis; full: PIControllerEnabledNFO; DSCS_getPIControllerEnabledNFO
-	
-	int PIIValNFO_[3];       // x, y, z axis; full: PIControllerIValueNFO; DSCS_setPIControllerIValueNFO
-	int PIIValNFO_rbv_[3];   // x, y, z axis; full: PIControllerIValueNFO; DSCS_getPIControllerIValueNFO
-	
-	int PIPValNFO_[3];       // x, y, z axis; full: PIControllerPValueNFO; DSCS_setPIControllerPValueNFO
-	int PIPValNFO_rbv_[3];   // x, y, z axis; full: PIControllerPValueNFO; DSCS_getPIControllerPValueNFO
-	
-	int PILimNFO_;           // single value; full: PIControllerLimitNFO; DSCS_setPIControllerLimitNFO
-	int PILimNFO_rbv_;       // single value; full: PIControllerLimitNFO; DSCS_getPIControllerLimitNFO
-	
-	int PIAvgNFO_;           // single value; full: PIControllerAverageNFO; DSCS_setPIControllerAverageNFO
-	int PIAvgNFO_rbv_;       // single value; full: PIControllerAverageNFO; DSCS_getPIControllerAverageNFO
-	
-	int PIEnSAM_[3];         // x, y, z axis; full: PIControllerEnabledSAM; DSCS_setPIControllerEnabledSAM
-	int PIEnSAM_rbv_[3];     // x, y, z axis; full: PIControllerEnabledSAM; DSCS_getPIControllerEnabledSAM
-	
-	int PIIValSAM_[3];       // x, y, z axis; full: PIControllerIValueSAM; DSCS_setPIControllerIValueSAM
-	int PIIValSAM_rbv_[3];   // x, y, z axis; full: PIControllerIValueSAM; DSCS_getPIControllerIValueSAM
-	
-	int PIPValSAM_[3];       // x, y, z axis; full: PIControllerPValueSAM; DSCS_setPIControllerPValueSAM
-	int PIPValSAM_rbv_[3];   // x, y, z axis; full: PIControllerPValueSAM; DSCS_getPIControllerPValueSAM
-	
-	int PILimSAM_;           // single value; full: PIControllerLimitSAM; DSCS_setPIControllerLimitSAM
-	int PILimSAM_rbv_;       // single value; full: PIControllerLimitSAM; DSCS_getPIControllerLimitSAM
-	
-	int PITargPos_[3];       // x, y, z axis; full: PIControllerTargetPosition; DSCS_setPIControllerTargetPosition
-	int PITargPos_rbv_[3];   // x, y, z axis; full: PIControllerTargetPosition; DSCS_getPIControllerTargetPosition
-	
-	int PITargMode_;         // single value; full: PIControllerTargetMode; DSCS_setPIControllerTargetMode
-	int PITargMode_rbv_;     // single value; full: PIControllerTargetMode; DSCS_getPIControllerTargetMode
-	
-	int PINFOOut_rbv_[3];    // x, y, z axis; full: PIControllerNFOOutput; DSCS_getPIControllerNFOOutput
-	int PISAMOut_rbv_[3];    // x, y, z axis; full: PIControllerSAMOutput; DSCS_getPIControllerSAMOutput
-	
-	int NFOADCLimMin_;       // single value; full: NFOADCLimitsMin; DSCS_setNFOADCLimits
-	int NFOADCLimMax_;       // single value; full: NFOADCLimitsMax; DSCS_setNFOADCLimits
-	int NFOADCLimMin_rbv_;   // single value; full: NFOADCLimitsMin; DSCS_getNFOADCLimits
-	int NFOADCLimMax_rbv_;   // single value; full: NFOADCLimitsMax; DSCS_getNFOADCLimits
-	
-	int NFOSlewLim_;         // single value; full: NFOSlewRateLimit; DSCS_setNFOSlewRateLimit
-	int NFOSlewLim_rbv_;     // single value; full: NFOSlewRateLimit; DSCS_getNFOSlewRateLimit
-	
-	int SAMADCLimMin_;       // single value; full: SAMADCLimitsMin; DSCS_setSAMADCLimits
-	int SAMADCLimMax_;       // single value; full: SAMADCLimitsMax; DSCS_setSAMADCLimits
-	int SAMADCLimMin_rbv_;   // single value; full: SAMADCLimitsMin; DSCS_getSAMADCLimits
-	int SAMADCLimMax_rbv_;   // single value; full: SAMADCLimitsMax; DSCS_getSAMADCLimits
-	
-	int SAMSlewLim_;         // single value; full: SAMSlewRateLimit; DSCS_setSAMSlewRateLimit
-	int SAMSlewLim_rbv_;     // single value; full: SAMSlewRateLimit; DSCS_getSAMSlewRateLimit
-	
-	int LimState_rbv_;       // single value; full: LimiterState; DSCS_getLimiterState
-	
-	int InpTransMat_[45]; // matrix 3x15; full: InputTransformationMatrix; DSCS_setInputTransformationMatrix
-	int InpTransRes_rbv_[3]; // x, y, z axis; full: InputTransformationResult; DSCS_getInputTransformationResult
-	int InpTransAvg_rbv_;    // single value; full: InputTransformationAverage; DSCS_getInputTransformationAverage
-	int InpTransState_rbv_;  // single value; full: InputTransformationState; DSCS_getInputTransformationState
-	
-	int OutTransMat_[42];  // matrix 6x7; full: OutputTransformationMatrix; DSCS_setOutputTransformationMatrix
-	int OutTransNFORes_rbv_[3]; // x, y, z axis; full: OutputTransformationNFOResult; DSCS_getOutputTransformationResult
-	int OutTransSAMRes_rbv_[3]; // x, y, z axis; full: OutputTransformationSAMResult; DSCS_getOutputTransformationResult
-	
-	int TrajStartX_;         // single value; full: TrajectoryLineStartX; DSCS_setTrajectoryLineStartX
-	int TrajStartX_rbv_;     // single value; full: TrajectoryLineStartX; DSCS_getTrajectoryLineStartX
-	
-	int TrajEndX_;           // single value; full: TrajectoryLineEndX; DSCS_setTrajectoryLineEndX
-	int TrajEndX_rbv_;       // single value; full: TrajectoryLineEndX; DSCS_getTrajectoryLineEndX
-	
-	int TrajSpeedX_;         // single value; full: TrajectoryLineSpeedX; DSCS_setTrajectoryLineSpeedX
-	int TrajSpeedX_rbv_;     // single value; full: TrajectoryLineSpeedX; DSCS_getTrajectoryLineSpeedX
-	
-	int TrajStartY_;         // single value; full: TrajectoryLineStartY; DSCS_setTrajectoryLineStartY
-	int TrajStartY_rbv_;     // single value; full: TrajectoryLineStartY; DSCS_getTrajectoryLineStartY
-	
-	int TrajDistY_;          // single value; full: TrajectoryLineDistY; DSCS_setTrajectoryLineDistY
-	int TrajDistY_rbv_;      // single value; full: TrajectoryLineDistY; DSCS_getTrajectoryLineDistY
-	
-	int TrajCountY_;         // single value; full: TrajectoryLineCountY; DSCS_setTrajectoryLineCountY
-	int TrajCountY_rbv_;     // single value; full: TrajectoryLineCountY; DSCS_getTrajectoryLineCountY
-	
-	int TrajTurnTime_;       // single value; full: TrajectoryTurnTime; DSCS_setTrajectoryTurnTime
-	int TrajTurnTime_rbv_;   // single value; full: TrajectoryTurnTime; DSCS_getTrajectoryTurnTime
-	
-	int TrajPosTime_;        // single value; full: TrajectoryPosTime; DSCS_setTrajectoryPosTime
-	int TrajPosTime_rbv_;    // single value; full: TrajectoryPosTime; DSCS_getTrajectoryPosTime
-	
-	int TrajAntiHyst_;       // single value; full: TrajectoryAntiHyst; DSCS_setTrajectoryAntiHyst
-	int TrajAntiHyst_rbv_;   // single value; full: TrajectoryAntiHyst; DSCS_getTrajectoryAntiHyst
-	
-	int TrajSettings_;       // single value; full: TrajectorySettings; DSCS_setTrajectorySettings
-	int TrajSettings_rbv_;   // single value; full: TrajectorySettings; DSCS_getTrajectorySettings
+	// Vendor-backed parameters, indexed by dscsParamId and channel; -1 where
+	// the row has no setpoint/readback or fewer channels. See dscsAsynParams.h.
+	int param_[DSCS_NUM_PARAMS][DSCS_MAX_CHANNELS];
+	int rbvParam_[DSCS_NUM_PARAMS][DSCS_MAX_CHANNELS];
+	// Publish filter settings, indexed by dscsParamId and dscsFilterParam;
+	// -1 for rows without a filter. See dscsHasPublishFilter.
+	int filterParam_[DSCS_NUM_PARAMS][DSCS_NUM_FILTER_PARAMS];
+	// History arrays, indexed by dscsParamId and channel; -1 for rows
+	// without one. See dscsHasHistory.
+	int historyParam_[DSCS_NUM_PARAMS][DSCS_MAX_CHANNELS];
+	int historyTimeParam_[DSCS_NUM_PARAMS][DSCS_MAX_CHANNELS];
+	
+	int Connected_rbv_;      // single value; driver link state, 1 = connected
+	int Reconnects_rbv_;     // single value; number of link losses since IOC start
+	
+	int PollPeriod_;         // configured poll period, s
+	int PollLastCycle_rbv_;  // duration of the last poll sweep, s
+	int PollMaxCycle_rbv_;   // longest poll sweep since reset, s
+	int PollRate_rbv_;       // achieved poll rate, Hz
+	int PollJitter_rbv_;     // RMS deviation of the achieved period from POLL_PERIOD, s
+	int PollOverruns_rbv_;   // sweeps that missed the next deadline
+	int PollTimingReset_;    // write 1 to clear the timing statistics
+	
+	int LockCount_rbv_[DSCS_NUM_LOCK_SITES];   // acquisitions since reset
+	int LockWaitP99_rbv_[DSCS_NUM_LOCK_SITES]; // 99th percentile wait for the lock, s, upper bucket edge
+	int LockWaitMax_rbv_[DSCS_NUM_LOCK_SITES]; // longest wait, s
+	int LockHoldP99_rbv_[DSCS_NUM_LOCK_SITES]; // 99th percentile hold time, s, upper bucket edge
+	int LockHoldMax_rbv_[DSCS_NUM_LOCK_SITES]; // longest hold, s
+	int LockWaitHist_[DSCS_NUM_LOCK_SITES];    // Int32Array; wait histogram, see DSCS_LOCK_BUCKETS
+	int LockHoldHist_[DSCS_NUM_LOCK_SITES];    // Int32Array; hold histogram
+	int LockHistEdges_;      // Float64Array; upper bucket edges, s
+	int LockStatsReset_;     // write 1 to clear the lock statistics
+	
+	int HistoryPeriod_;      // s between publishes of the readback histories, 0 = off
+	int HistoryClear_;       // write 1 to empty the histories
+	int HistoryBytes_rbv_;   // size of the history arena
+	
+	int WriteQueue_rbv_;     // setpoints waiting for the writer thread
+	int WriteCoalesced_rbv_; // queued setpoints replaced by a newer value before they were sent
+	int WriteErrors_rbv_;    // queued setpoints the controller rejected
+	
+	int StreamEnable_;                            // 1 = data output and callback enabled
+	int StreamData_[DSCS_STREAM_CHANNELS];        // Int32Array; one packet of tuples
+	int StreamTime_[DSCS_STREAM_CHANNELS];        // Float64Array; acquisition time of each tuple, s past EPICS epoch
+	int StreamRate_rbv_[DSCS_STREAM_CHANNELS];    // estimated sample rate, Hz
+	int StreamTimeResid_rbv_[DSCS_STREAM_CHANNELS]; // RMS packet arrival jitter around the clock model, s
+	int StreamLost_rbv_[DSCS_STREAM_CHANNELS];    // samples missing from the index sequence
+	int StreamOverflows_rbv_[DSCS_STREAM_CHANNELS]; // packets dropped because the queue was full
+	
+	int MergeData_;          // Int32Array; merged packet, primary tuples
+	int MergeTime_;          // Float64Array; acquisition time of each tuple, s past EPICS epoch
+	int MergePos_[DSCS_MERGE_WIDTH]; // Float64Array; secondary value at each tuple's time, NaN if not covered
+	int MergeAligned_rbv_;   // tuples of the last merged packet that got secondary values
+	
+	int SettingsFile_;       // Octet; snapshot file for SETTINGS_SAVE/SETTINGS_RESTORE
+	int SettingsSave_;       // write 1 to save a snapshot of the controller setpoints
+	int SettingsRestore_;    // write 1 to restore the snapshot
+	int SettingsWrites_rbv_; // setpoints the last restore had to write
+	int SettingsTime_rbv_;   // duration of the last save or restore, s
+	
+	int ReadFresh_;          // 1 = reads of readbacks go to the controller, 0 = last polled value
+	int ReadFreshWindow_;    // s a controller read is shared with later reads of the same readback
+	int ReadDevice_rbv_;     // fresh reads that went to the controller
+	int ReadShared_rbv_;     // fresh reads answered by a controller read within the window
+	
+	int InterlockPeriod_;    // s between interlock checks, 0 = watcher off
+	int InterlockState_rbv_; // current dscsInterlock* bits
+	int Interlock_rbv_;      // dscsInterlock* bits latched since the last reset
+	int InterlockStamp_rbv_; // Octet; time the interlock tripped
+	int InterlockReset_;     // write 1 to clear the latch
+	int InterlockLimColumn_;   // stream tuple column of the limiter state, -1 = read by the watcher
+	int InterlockTransColumn_; // stream tuple column of the transformation state, -1 = read by the watcher
+	int InterlockData_[DSCS_STREAM_CHANNELS];  // Int32Array; stream tuples before the trip
+	int InterlockTime_[DSCS_STREAM_CHANNELS];  // Float64Array; their acquisition times, s past EPICS epoch
+	
+	// stream capture to disk, see dscsCapture.h
+	int CaptureFile_[DSCS_CAPTURE_CHANNELS];     // Octet; file CAPTURE_ENABLE writes to
+	int CaptureCodec_[DSCS_CAPTURE_CHANNELS];    // dscsCaptureCodec
+	int CaptureEnable_[DSCS_CAPTURE_CHANNELS];   // 1 = capture the published packets
+	int CaptureSamples_rbv_[DSCS_CAPTURE_CHANNELS]; // tuples written to the current or last file
+	int CaptureBytes_rbv_[DSCS_CAPTURE_CHANNELS];   // its size
+	int CaptureRatio_rbv_[DSCS_CAPTURE_CHANNELS];   // raw tuple bytes over file bytes
+	int CaptureDropped_rbv_[DSCS_CAPTURE_CHANNELS]; // packets dropped because the writer fell behind
+	int CaptureMessage_rbv_[DSCS_CAPTURE_CHANNELS]; // Octet; why the last capture failed
+	
+	// replay of a capture through the stream pipeline
+	int ReplayFile_;         // Octet; capture to replay
+	int ReplayChannel_;      // stream channel the packets are fed to, 0 = REL, 1 = ABS
+	int ReplaySpeed_;        // 1 = original timing, >1 faster, 0 = as fast as the pipeline takes them
+	int ReplayPacket_;       // tuples per packet
+	int ReplayStart_;        // write 1 to start; STREAM_ENABLE must be 0
+	int ReplayStop_;         // write 1 to stop
+	int ReplayState_rbv_;    // dscsReplayState
+	int ReplaySamples_rbv_;  // tuples fed so far
+	int ReplayProgress_rbv_; // fraction of the capture fed
+	int ReplayRate_rbv_;     // tuples/s published, averaged over the replay
+	int ReplayMessage_rbv_;  // Octet; why the last replay failed
+	
+	// fly-scan planner, see dscsTrajectory.h
+	int ScanStartX_;         // nm
+	int ScanStartY_;         // nm
+	int ScanWidth_;          // nm
+	int ScanHeight_;         // nm
+	int ScanPixel_;          // nm
+	int ScanDwell_;          // s per pixel
+	int ScanTurnTime_;       // s
+	int ScanPosTime_;        // s
+	int ScanAntiHyst_;       // nm
+	int ScanMode_;           // dscsTraj* bits
+	int ScanPlan_;           // write 1 to plan from the SCAN_* parameters
+	int ScanUpload_;         // write 1 to write the plan to the TRAJ_* registers
+	int PlanValid_rbv_;      // 1 = a plan is staged for upload
+	int PlanMessage_rbv_;    // Octet; why the last plan failed
+	int PlanPixels_rbv_;     // pixels per line
+	int PlanLines_rbv_;      // lines
+	int PlanDwell_rbv_;      // s per pixel after rounding
+	int PlanLineTime_rbv_;   // s
+	int PlanDuration_rbv_;   // s for one raster
+	int PlanSamples_rbv_;    // stream tuples expected at the current stream rate
+	
+	// scan queue; tiles share the SCAN_* pixel, dwell, times and mode
+	int ScanQueueTiles_;     // Float64Array; append tiles, DSCS_SCAN_TILE_VALUES each, nm
+	int ScanQueueFile_;      // Octet; tile file for SCAN_QUEUE_LOAD, one "x y width height" per line
+	int ScanQueueLoad_;      // write 1 to append the tiles in SCAN_QUEUE_FILE
+	int ScanQueueStart_;     // write 1 to run the queue from the first tile
+	int ScanQueueStop_;      // write 1 to abort the queue and the running trajectory
+	int ScanQueueClear_;     // write 1 to empty the queue
+	int ScanQueueSettle_;    // s from the end of one tile's trajectory to the start of the next
+	int ScanQueueState_rbv_; // dscsScanState
+	int ScanQueueLength_rbv_; // tiles in the queue
+	int ScanQueueTile_rbv_;  // running tile, 1 based; 0 before the first
+	int ScanQueueProgress_rbv_; // fraction of the queue's planned time done
+	int ScanQueueEta_rbv_;   // s until the last tile ends
+	int ScanQueueGap_rbv_;   // s from the end of the last tile to the start of the next
+	
+	// running trajectory, see dscsTrajectoryProgress
+	int TrajStart_;          // write 1 to start the trajectory in the TRAJ_* registers
+	int TrajXColumn_;        // column of the X position in the REL stream tuples, -1 = none
+	int TrajRunning_rbv_;    // 1 while a trajectory started by the driver runs
+	int TrajStreamClock_rbv_; // 1 = progress timed by the stream's sample clock, 0 = host clock
+	int TrajMeasured_rbv_;   // 1 = remaining time from measured line ends, 0 = from the plan
+	int TrajLine_rbv_;       // running line, 0 based
+	int TrajFraction_rbv_;   // 0..1
+	int TrajRemaining_rbv_;  // s
+	int TrajLineRate_rbv_;   // measured lines/s, 0 until two line ends were seen
+	int TrajPlanLineRate_rbv_; // planned lines/s
+	
+	// PI step test, see dscsStepResponse.h; results and traces per axis
+	int TuneAxis_;           // axis to step, 0..2 = X..Z
+	int TuneStep_;           // PI_TARG_POS counts added to the current target
+	int TuneDuration_;       // s of response captured after the step
+	int TuneBand_;           // settling band, fraction of the step
+	int TuneColumn_[DSCS_TUNE_AXES]; // column of the axis' controlled value in the REL stream tuples, -1 = none
+	int TuneStart_;          // write 1 to run the step test
+	int TuneState_rbv_;      // dscsTuneState
+	int TuneMessage_rbv_;    // Octet; why the last test failed
+	int TuneRise_rbv_[DSCS_TUNE_AXES];      // s, 10 % to 90 %
+	int TuneOvershoot_rbv_[DSCS_TUNE_AXES]; // % of the step
+	int TuneSettling_rbv_[DSCS_TUNE_AXES];  // s
+	int TuneError_rbv_[DSCS_TUNE_AXES];     // steady-state error, PI_TARG_POS counts
+	int TuneTrace_[DSCS_TUNE_AXES];         // Float64Array; captured response
+	int TuneTraceTime_[DSCS_TUNE_AXES];     // Float64Array; s relative to the step
+	
+	// frequency response sweep, see dscsBode.h; the response is read from
+	// the axis' TUNE_COLUMN
+	int BodeAxis_;           // axis to modulate, 0..2 = X..Z
+	int BodeStart_;          // Hz, first frequency
+	int BodeStop_;           // Hz, last frequency
+	int BodePoints_;         // frequencies, log spaced
+	int BodeAmp_;            // SETPT_AMP during the sweep
+	int BodeCycles_;         // periods demodulated per frequency
+	int BodeSettle_;         // periods skipped after each frequency change
+	int BodeRefColumn_[DSCS_TUNE_AXES]; // column of the axis' modulated setpoint in the REL stream tuples, -1 = none
+	int BodeRun_;            // write 1 to run the sweep
+	int BodeAbort_;          // write 1 to stop it
+	int BodeState_rbv_;      // dscsBodeState
+	int BodePoint_rbv_;      // frequencies measured
+	int BodeMessage_rbv_;    // Octet; why the last sweep failed
+	int BodeFreq_;           // Float64Array; Hz, as set after rounding
+	int BodeMag_;            // Float64Array; response over reference
+	int BodePhase_;          // Float64Array; deg, NaN without a reference column
 	
 
     asynUser* pasynUserdscsAsyn_;
 
 private:
-	// OSA_PS
-	asynStatus setOSA_PS(DSCS_Axis axis, epicsInt32 value);
-	
-	// BS_PS
-	asynStatus setBS_PS(DSCS_Axis axis, epicsInt32 value);
-	
-	// AUX_DAC
-	asynStatus setAUX_DAC(DSCS_AUX_ADC aux, epicsInt32 value);
-	
-	// NFO_PS
-	asynStatus setNFO_PS(DSCS_Axis axis, epicsInt32 value);
-	
-	// SAM_PS
-	asynStatus setSAM_PS(DSCS_Axis axis, epicsInt32 value);
-	
-	// SetpointModulationFrequency
-	asynStatus setSetpointModulationFrequency(DSCS_Axis axis, epicsInt32 value);
-	
-	// SetpointModulationPhase
-	asynStatus setSetpointModulationPhase(DSCS_Axis axis, epicsInt32 value);
-	
-	// SetpointModulationAmplitude
-	asynStatus setSetpointModulationAmplitude(DSCS_Axis axis, epicsInt32 value);
-	
-	// ExternalADCShift
-	asynStatus setExternalADCShift(epicsInt32 value);
-	
-	// PI Controller NFO
-	asynStatus setPIControllerEnabledNFO(DSCS_Axis axis, epicsInt32 value);
-	asynStatus setPIControllerIValueNFO(DSCS_Axis axis, epicsInt32 value);
-	asynStatus setPIControllerPValueNFO(DSCS_Axis axis, epicsInt32 value);
-	asynStatus setPIControllerLimitNFO(epicsInt32 value);
-	asynStatus setPIControllerAverageNFO(epicsInt32 value);
-	
-	// PI Controller SAM
-	asynStatus setPIControllerEnabledSAM(DSCS_Axis axis, epicsInt32 value);
-	asynStatus setPIControllerIValueSAM(DSCS_Axis axis, epicsInt32 value);
-	asynStatus setPIControllerPValueSAM(DSCS_Axis axis, epicsInt32 value);
-	asynStatus setPIControllerLimitSAM(epicsInt32 value);
-	
-	// PI Controller Target
-	asynStatus setPIControllerTargetPosition(DSCS_Axis axis, epicsInt32 value);
-	asynStatus setPIControllerTargetMode(epicsInt32 value);
-	
-	// NFOADCLimits (min/max)
-	asynStatus setNFOADCLimMin(epicsInt32 value);
-	asynStatus setNFOADCLimMax(epicsInt32 value);
-	
-	// NFOSlewRateLimit
-	asynStatus setNFOSlewRateLimit(epicsInt32 value);
-	
-	// SAMADCLimits (min/max)
-	asynStatus setSAMADCLimMin(epicsInt32 value);
-	asynStatus setSAMADCLimMax(epicsInt32 value);
-	
-	// SAMSlewRateLimit
-	asynStatus setSAMSlewRateLimit(epicsInt32 value);
-	
-	// Trajectory line parameters
-	asynStatus setTrajectoryLineStartX(epicsInt32 value);
-	asynStatus setTrajectoryLineEndX(epicsInt32 value);
-	asynStatus setTrajectoryLineSpeedX(epicsInt32 value);
-	asynStatus setTrajectoryLineStartY(epicsInt32 value);
-	asynStatus setTrajectoryLineDistY(epicsInt32 value);
-	asynStatus setTrajectoryLineCountY(epicsInt32 value);
-	asynStatus setTrajectoryTurnTime(epicsInt32 value);
-	asynStatus setTrajectoryPosTime(epicsInt32 value);
-	asynStatus setTrajectoryAntiHyst(epicsInt32 value);
-	asynStatus setTrajectorySettings(epicsInt32 value);
+	// Table row/channel behind each asyn parameter, indexed by function
+	struct dscsParamRef {
+		int row;       // dscsParamId, -1 for driver-internal parameters
+		int chan;
+		bool readback;
+	};
+	std::vector<dscsParamRef> paramRefs_;
+
+	void createTableParams();
+	const dscsParamRef *findParamRef(int function) const;
+
+	// publish filter of the fast readbacks; guarded by the port lock
+	struct dscsPublishFilter {
+		double adel = 0;         // absolute deadband
+		double rdel = 0;         // relative deadband
+		double minInterval = 0;  // s between posts, 1/MAX_RATE
+	};
+	struct dscsPublishState {
+		double value = 0;        // last posted value
+		epicsUInt64 time = 0;    // monotonic ns of the last post, 0 = never posted
+		bool pending = false;    // a change was held back by the rate limit
+	};
+	dscsPublishFilter filter_[DSCS_NUM_PARAMS];
+	dscsPublishState publishState_[DSCS_NUM_PARAMS][DSCS_MAX_CHANNELS];
+	bool filterReadback(int row, int chan, double value, epicsUInt64 now);
+	bool setFilterParam(int function, double value);
+
+	asynStatus writeSetpoint(int function, double value);
+
+	// Setpoint write queue, one entry per function (parameter and axis). A
+	// newer value replaces a queued one in place. Guarded by the port lock.
+	struct dscsPendingWrite {
+		double value;
+		epicsUInt64 queued;  // monotonic ns the function was first queued
+	};
+	std::map<int, dscsPendingWrite> pendingWrites_;
+	std::deque<int> writeOrder_;  // functions in pendingWrites_, oldest first
+	int writesCoalesced_ = 0;
+	int writeErrors_ = 0;
+	epicsEventId writeEvent_;
+	asynStatus queueSetpoint(int function, double value);
+	bool nextWrite(int *function, double *wait);
+	bool takePendingWrite(int function, double *value);
+
+	// min/max pairs set in one vendor call, see dscsLimitPairs
+	const dscsLimitPair *findLimitPair(int row) const;
+	asynStatus writeLimitPair(const dscsLimitPair &pair, int function, double value);
+	asynStatus sendLimitPair(const dscsLimitPair &pair, double min, double max);
 
+	// settings snapshot; called with the port lock held
+	asynStatus readSettings(dscsSettings &settings);
+	asynStatus applySettings(const dscsSettings &settings, int *writes);
+	void setSetpointValue(int row, int chan, double value);
 
 	void report(FILE *fp, int details);
 
 	double pollTime_;
+	double reconnectTime_;
+	int slowPollDivisor_;    // dscsPollSlow rows are read every this many cycles
+	unsigned int pollCycle_ = 0;
+	dscsPollTiming pollTiming_;
+	void updatePollTiming(epicsUInt64 cycleStart, epicsUInt64 cycleEnd);
+	void resetPollTiming();
+
+	// port lock statistics, see lock(). Guarded by the port lock itself.
+	dscsLockStats lockStats_[DSCS_NUM_LOCK_SITES];
+	int lockDepth_ = 0;                     // recursion depth of the holder
+	dscsLockSite lockSite_ = dscsLockAsyn;  // site of the outermost lock()
+	epicsUInt64 lockGranted_ = 0;           // monotonic ns
+	epicsUInt64 lockPublished_ = 0;
+	void publishLockStats(epicsUInt64 now);
+	void resetLockStats();
+
+	epicsThreadId threads_[DSCS_NUM_THREADS] = {}; // see dscsThread
+	void reportThreads(FILE *fp);
+
+	// readback histories; one arena for all, allocated in the constructor.
+	// Guarded by the port lock.
+	std::vector<epicsUInt8> historyArena_;
+	dscsHistory *history_[DSCS_NUM_PARAMS][DSCS_MAX_CHANNELS];
+	double historyPeriod_ = DSCS_HISTORY_PERIOD;
+	epicsUInt64 historyPublished_ = 0;  // monotonic ns
+	std::vector<epicsInt32> historyValues_;
+	std::vector<epicsFloat64> historyTimes_;
+	void createHistories();
+	void publishHistories(epicsUInt64 now);
 
 	int deviceId = -2;
 	unsigned int deviceNo = 0;
 
-	void checkError(const char * context, int code);
+	// link state; all guarded by the port lock
+	bool connected_ = false;
+	bool autoReconnect_ = true;   // poller retries the connection while set
+	bool restorePending_ = false; // setpoints must be re-sent after reconnect
+	bool seeded_ = false;         // setpoints have been loaded from the controller once
+	int reconnectCount_ = 0;
+	std::map<int, double> writtenSetpoints_; // functions written since IOC start, to the value last accepted
+
+	dscsErrorClass checkError(const char * context, int code);
+	asynStatus checkStatus(const char * context, int code);
+	void linkLost();
+	asynStatus seedSetpoints();
+	void restoreSetpoints();
+
+	// fresh reads; guarded by the port lock
+	bool readFresh_ = false;
+	double freshWindow_ = DSCS_FRESH_WINDOW;
+	int freshDeviceReads_ = 0;
+	int freshSharedReads_ = 0;
+	epicsUInt64 readTime_[DSCS_NUM_PARAMS][DSCS_MAX_CHANNELS] = {}; // monotonic ns the readback was last read
+	asynStatus refreshReadback(int function);
+
+	// interlock watcher; guarded by the port lock
+	double interlockPeriod_ = DSCS_INTERLOCK_PERIOD;
+	int interlock_ = 0;  // latched dscsInterlock* bits
+	int interlockLimColumn_ = -1;
+	int interlockTransColumn_ = -1;
+	dscsStreamHistory<epicsInt32> *streamHistory_[DSCS_STREAM_CHANNELS];
+	std::vector<epicsInt32> interlockData_;
+	std::vector<epicsFloat64> interlockTime_;
+	bool streamedInterlock();
+	void checkInterlock(int limiter, int transformation);
+	void tripInterlock(int cause);
+	void leaveTrajectory();
+
+	// staged fly-scan plan; guarded by the port lock
+	dscsTrajectoryPlan plan_;
+	bool planValid_ = false;
+	void getScanRequest(dscsScanRequest &request);
+	asynStatus planScan();
+	asynStatus uploadPlan(const dscsTrajectoryPlan &plan, bool changedOnly = false);
+	asynStatus sendSetpoint(int row, int chan, double value);
+
+	// scan queue; guarded by the port lock
+	std::vector<dscsTrajectoryPlan> scanQueue_;
+	dscsScanState scanState_ = dscsScanIdle;
+	int scanTile_ = -1;          // index of the running tile
+	double scanQueueTime_ = 0;   // s, planned time of all tiles
+	double scanDoneTime_ = 0;    // s, planned time of the finished tiles
+	epicsEventId scanEvent_;
+	asynStatus queueTile(const dscsScanRequest &request);
+	asynStatus loadScanQueue(const char *file);
+	asynStatus startScanQueue();
+	void stopScanQueue(dscsScanState state);
+	double runScanQueue();
+	void updateScanProgress();
+
+	// running trajectory; guarded by the port lock
+	bool trajRunning_ = false;
+	bool trajStreamClock_ = false;   // elapsed time from the REL stream sample count
+	bool trajStreamX_ = false;       // X positions from the REL stream
+	int trajXColumn_ = -1;
+	dscsTrajectoryPlan trajPlan_;
+	dscsTrajectoryProgress trajProgress_;
+	epicsUInt64 trajStart_ = 0;      // monotonic ns
+	epicsUInt64 trajEnd_ = 0;        // monotonic ns the last trajectory was seen to end
+	epicsUInt64 trajStartSample_ = 0;
+	asynStatus startTrajectory(const dscsTrajectoryPlan &plan);
+	asynStatus startStagedTrajectory();
+	double trajectoryElapsed(epicsUInt64 now);
+	double updateTrajectory();
+
+	// PI step test; guarded by the port lock
+	dscsTuneState tuneState_ = dscsTuneIdle;
+	int tuneAxis_ = 0;
+	int tuneColumn_ = -1;
+	double tuneInitial_ = 0;         // PI_TARG_POS before the step
+	double tuneTarget_ = 0;          // PI_TARG_POS during the step
+	double tuneDuration_ = 0;        // s
+	double tuneStepTime_ = 0;        // s from the capture start to the step
+	epicsUInt64 tuneStartSample_ = 0;
+	epicsUInt64 tuneEndSample_ = 0;  // first REL sample not captured
+	epicsUInt64 tuneDeadline_ = 0;   // monotonic ns, the test fails if the stream hasn't delivered by then
+	std::vector<epicsFloat64> tuneTime_;  // s from the capture start
+	std::vector<epicsFloat64> tuneValue_;
+	asynStatus startTuning();
+	double updateTuning();
+	void finishTuning(dscsTuneState state, const char *message);
+
+	// frequency response sweep; guarded by the port lock
+	dscsBodeState bodeState_ = dscsBodeIdle;
+	int bodeAxis_ = 0;
+	int bodeColumn_ = -1;
+	int bodeRefColumn_ = -1;
+	int bodeCycles_ = 0;
+	double bodeSettle_ = 0;
+	double bodeAmp_ = 0;             // SETPT_AMP during the sweep
+	double bodeSavedFreq_ = 0;       // SETPT_FREQ and SETPT_AMP before the sweep
+	double bodeSavedAmp_ = 0;
+	std::vector<double> bodeSweep_;  // Hz, requested
+	int bodePoint_ = 0;
+	double bodeFreq_ = 0;            // Hz, set for the current point
+	epicsUInt64 bodeStartSample_ = 0; // first REL sample demodulated
+	epicsUInt64 bodeEndSample_ = 0;   // first REL sample not demodulated
+	epicsUInt64 bodeDeadline_ = 0;    // monotonic ns
+	dscsLockIn bodeResponse_;
+	dscsLockIn bodeReference_;
+	std::vector<epicsFloat64> bodeFreqs_, bodeMag_, bodePhase_;
+	asynStatus startBode();
+	asynStatus startBodePoint();
+	double updateBode();
+	void finishBode(dscsBodeState state, const char *message);
+	bool testRunning() const {
+		return tuneState_ == dscsTuneBaseline || tuneState_ == dscsTuneResponse || bodeState_ == dscsBodeRunning;
+	}
+
+	// streaming; the queues are filled from the vendor thread without the
+	// port lock, everything else is guarded by it
+	bool streamEnabled_ = false;
+	dscsStreamQueue<epicsInt32> *streamQueue_[DSCS_STREAM_CHANNELS];
+	dscsStreamChannel streamChannel_[DSCS_STREAM_CHANNELS];
+	epicsEventId streamEvent_;
+	std::vector<epicsInt32> streamData_;
+	std::vector<epicsFloat64> streamTime_;
+	asynStatus enableStream(bool enable);
+	void publishPacket(const dscsStreamPacket &packet);
+
+	// stream capture; the queues are filled by publishPacket and
+	// publishMerged with the port lock held and drained by the capture
+	// thread, which writes without it
+	bool captureActive_[DSCS_CAPTURE_CHANNELS] = {};
+	std::deque<std::string> captureFiles_[DSCS_CAPTURE_CHANNELS];  // guarded by the port lock
+	dscsStreamQueue<epicsInt32, dscsCapturePacket> *captureQueue_[DSCS_CAPTURE_CHANNELS];
+	dscsCaptureWriter captureWriter_[DSCS_CAPTURE_CHANNELS];  // capture thread only
+	epicsEventId captureEvent_;
+	std::vector<epicsInt32> captureValues_;  // capture thread only
+	asynStatus enableCapture(int ch, bool enable);
+	void writeCapture(int ch);
+
+	// replay; the thread feeds dataCallback without the port lock, the
+	// state is guarded by it
+	dscsReplayState replayState_ = dscsReplayIdle;
+	int replayRun_ = 0;              // counts replays started, so a stopped one can tell
+	epicsUInt64 replayPublished_ = 0; // tuples of the current replay the stream thread published
+	epicsEventId replayEvent_;
+	asynStatus startReplay();
+	void runReplay(const char *file, int ch, double speed, int packetSamples, int run);
+	bool replayRunning(int run);
+	void finishReplay(dscsReplayState state, const char *message);
+
+	// merge of one stream channel with a secondary source, NULL if none
+	dscsStreamMerge *merge_ = NULL;
+	int mergeChannel_ = -1;
+	dscsMergedPacket merged_;
+	std::vector<epicsFloat64> mergePos_;
+	std::vector<epicsInt32> mergeCapture_;
+	void publishMerged();
 
   
 };
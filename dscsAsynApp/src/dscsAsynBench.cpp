@@ -0,0 +1,454 @@
+/*
+ * dscsAsynBench
+ *
+ * Benchmark of the poll path. Runs the driver against the simulated
+ * controller of dscsSim.cpp, whose vendor calls take a set latency like the
+ * USB link, and measures for 1..N devices and 0..M subscribers
+ *   - the poll sweep time (POLL_LAST_CYCLE_RBV) and the poll rate achieved
+ *   - the setpoint write latency while the poller runs, from the asyn write
+ *     to the end of the vendor set call
+ *   - the callback fan-out: every subscriber monitors all readbacks of all
+ *     devices through asyn interrupt callbacks, as the records behind a CA
+ *     client's monitors do. The fan-out time is the span of the callback
+ *     burst one poll cycle of one device causes.
+ *
+ *   dscsAsynBench [-d devices] [-s subscribers] [-l latency_us] [-j jitter_us]
+ *                 [-p period] [-w writes] [-t seconds] [-o file]
+ *
+ *   -d  most devices (4); runs 1, 2, 4, ... devices
+ *   -s  most subscribers (8); runs 0, 1, 2, 4, ... subscribers
+ *   -l  latency of a vendor call, us (100)
+ *   -j  random extra latency of a vendor call, up to, us (0)
+ *   -p  POLL_PERIOD, s (0.1)
+ *   -w  setpoint writes per s, round robin over the devices (20)
+ *   -t  s per configuration (10)
+ *   -o  results file (dscsAsynBench.txt)
+ *
+ * One line per configuration, space separated, in the results file and on
+ * stdout. The writes are sequential, so a write rate beyond what the
+ * latency allows is not reached. Devices are added as the run goes on and
+ * keep polling, asyn ports cannot be removed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <epicsMutex.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <dbAccess.h>
+#include <asynDriver.h>
+#include <asynInt32.h>
+#include <asynFloat64.h>
+#include <asynDrvUser.h>
+#include <asynInt32SyncIO.h>
+#include <asynFloat64SyncIO.h>
+
+#include "dscsAsynParams.h"
+#include "dscsSim.h"
+
+extern "C" int dscsAsynConfig(const char *portName, const char *dscsAsynPortName, int dscsId);
+
+#define BENCH_TIMEOUT 1.0        // s, asyn requests and waiting for a write to reach the device
+#define BENCH_WRITE_PARAM "SETPT_FREQ_X"
+
+struct benchPort {
+    char name[16];
+    unsigned int devNo;      // of the simulated device
+    asynInt32 *int32;
+    void *int32Pvt;
+    asynFloat64 *float64;
+    void *float64Pvt;
+    asynDrvUser *drvUser;
+    void *drvUserPvt;
+    asynUser *setpoint;      // SyncIO users
+    asynUser *reset;
+    asynUser *rate;
+    asynUser *overruns;
+
+    epicsMutexId lock;       // the rest is filled in by the callbacks
+    std::vector<double> cycles;        // s
+    epicsUInt64 gap;                   // ns between callbacks that ends a burst
+    epicsUInt64 burstFirst;
+    epicsUInt64 burstLast;
+    unsigned long burstCallbacks;
+    std::vector<double> bursts;        // us
+    double burstTime;                  // us, all bursts
+    unsigned long callbacks;
+};
+
+struct benchSubscription {
+    benchPort *port;
+    asynUser *pasynUser;
+    void *registrarPvt;
+    bool float64;
+    double value;            // last one, a record keeps it too
+};
+
+static double processCpu()
+{
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+    return NAN;
+}
+
+static double percentile(std::vector<double> &values, double p)
+{
+    if (values.empty()) return NAN;
+    size_t i = (size_t)(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+static double mean(const std::vector<double> &values)
+{
+    double sum = 0;
+    for (size_t i = 0; i < values.size(); ++i) sum += values[i];
+    return values.empty() ? NAN : sum / values.size();
+}
+
+// Called with port.lock held
+static void closeBurst(benchPort &port)
+{
+    double span = (port.burstLast - port.burstFirst) / 1e3;
+
+    if (port.burstCallbacks > 1) {
+        port.bursts.push_back(span);
+        port.burstTime += span;
+    }
+    port.burstCallbacks = 0;
+}
+
+/*
+ * Callbacks of one cycle come back to back from the poller's
+ * callParamCallbacks; a pause of half a poll period starts the next burst.
+ */
+static void fanout(benchPort &port)
+{
+    epicsUInt64 now = epicsMonotonicGet();
+
+    epicsMutexMustLock(port.lock);
+    if (port.burstCallbacks && now - port.burstLast > port.gap) closeBurst(port);
+    if (!port.burstCallbacks) port.burstFirst = now;
+    port.burstLast = now;
+    port.burstCallbacks++;
+    port.callbacks++;
+    epicsMutexUnlock(port.lock);
+}
+
+static void int32Callback(void *userPvt, asynUser *pasynUser, epicsInt32 value)
+{
+    benchSubscription &sub = *(benchSubscription *)userPvt;
+    sub.value = value;
+    fanout(*sub.port);
+}
+
+static void float64Callback(void *userPvt, asynUser *pasynUser, epicsFloat64 value)
+{
+    benchSubscription &sub = *(benchSubscription *)userPvt;
+    sub.value = value;
+    fanout(*sub.port);
+}
+
+static void cycleCallback(void *userPvt, asynUser *pasynUser, epicsFloat64 value)
+{
+    benchPort &port = *((benchSubscription *)userPvt)->port;
+
+    epicsMutexMustLock(port.lock);
+    port.cycles.push_back(value);
+    epicsMutexUnlock(port.lock);
+}
+
+static bool subscribe(benchSubscription &sub, benchPort &port, const char *param, bool float64,
+                      interruptCallbackInt32 onInt32, interruptCallbackFloat64 onFloat64)
+{
+    asynStatus status;
+
+    sub.port = &port;
+    sub.float64 = float64;
+    sub.value = 0;
+    sub.pasynUser = pasynManager->createAsynUser(NULL, NULL);
+    status = pasynManager->connectDevice(sub.pasynUser, port.name, 0);
+    if (status == asynSuccess) status = port.drvUser->create(port.drvUserPvt, sub.pasynUser, param, NULL, NULL);
+    if (status == asynSuccess && float64) {
+        status = port.float64->registerInterruptUser(port.float64Pvt, sub.pasynUser, onFloat64, &sub,
+                                                     &sub.registrarPvt);
+    } else if (status == asynSuccess) {
+        status = port.int32->registerInterruptUser(port.int32Pvt, sub.pasynUser, onInt32, &sub,
+                                                   &sub.registrarPvt);
+    }
+    if (status != asynSuccess) {
+        fprintf(stderr, "%s %s: %s\n", port.name, param, sub.pasynUser->errorMessage);
+        pasynManager->freeAsynUser(sub.pasynUser);
+        sub.pasynUser = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void unsubscribe(benchSubscription &sub)
+{
+    if (!sub.pasynUser) return;
+    if (sub.float64) sub.port->float64->cancelInterruptUser(sub.port->float64Pvt, sub.pasynUser, sub.registrarPvt);
+    else sub.port->int32->cancelInterruptUser(sub.port->int32Pvt, sub.pasynUser, sub.registrarPvt);
+    pasynManager->disconnect(sub.pasynUser);
+    pasynManager->freeAsynUser(sub.pasynUser);
+    sub.pasynUser = NULL;
+}
+
+static asynUser *connectParam(benchPort &port, const char *param, bool float64)
+{
+    asynUser *pasynUser = NULL;
+    asynStatus status = float64 ? pasynFloat64SyncIO->connect(port.name, 0, &pasynUser, param)
+                                : pasynInt32SyncIO->connect(port.name, 0, &pasynUser, param);
+
+    if (status != asynSuccess) {
+        fprintf(stderr, "%s %s: cannot connect\n", port.name, param);
+        return NULL;
+    }
+    return pasynUser;
+}
+
+static benchPort *addPort(unsigned int devNo, double period, std::list<benchSubscription> &cycleSubs)
+{
+    benchPort *port = new benchPort();
+    asynUser *pasynUser = pasynManager->createAsynUser(NULL, NULL);
+    asynUser *periodUser;
+    asynInterface *pif;
+
+    snprintf(port->name, sizeof(port->name), "BENCH%u", devNo);
+    port->devNo = devNo;
+    port->lock = epicsMutexMustCreate();
+    port->gap = (epicsUInt64)(period / 2 * 1e9);
+
+    dscsAsynConfig(port->name, "", devNo + 1);
+    if (pasynManager->connectDevice(pasynUser, port->name, 0) != asynSuccess) {
+        fprintf(stderr, "%s: %s\n", port->name, pasynUser->errorMessage);
+        return NULL;
+    }
+    pif = pasynManager->findInterface(pasynUser, asynInt32Type, 1);
+    port->int32 = (asynInt32 *)pif->pinterface;
+    port->int32Pvt = pif->drvPvt;
+    pif = pasynManager->findInterface(pasynUser, asynFloat64Type, 1);
+    port->float64 = (asynFloat64 *)pif->pinterface;
+    port->float64Pvt = pif->drvPvt;
+    pif = pasynManager->findInterface(pasynUser, asynDrvUserType, 1);
+    port->drvUser = (asynDrvUser *)pif->pinterface;
+    port->drvUserPvt = pif->drvPvt;
+    pasynManager->disconnect(pasynUser);
+    pasynManager->freeAsynUser(pasynUser);
+
+    port->setpoint = connectParam(*port, BENCH_WRITE_PARAM, false);
+    port->reset = connectParam(*port, "POLL_TIMING_RESET", false);
+    port->rate = connectParam(*port, "POLL_RATE_RBV", true);
+    port->overruns = connectParam(*port, "POLL_OVERRUNS_RBV", false);
+    periodUser = connectParam(*port, "POLL_PERIOD", true);
+    if (!port->setpoint || !port->reset || !port->rate || !port->overruns || !periodUser) return NULL;
+    pasynFloat64SyncIO->write(periodUser, period, BENCH_TIMEOUT);
+    pasynFloat64SyncIO->disconnect(periodUser);
+
+    cycleSubs.push_back(benchSubscription());
+    if (!subscribe(cycleSubs.back(), *port, "POLL_LAST_CYCLE_RBV", true, NULL, cycleCallback)) return NULL;
+    return port;
+}
+
+static void resetPort(benchPort &port)
+{
+    pasynInt32SyncIO->write(port.reset, 1, BENCH_TIMEOUT);
+    epicsMutexMustLock(port.lock);
+    port.cycles.clear();
+    port.bursts.clear();
+    port.burstCallbacks = 0;
+    port.burstTime = 0;
+    port.callbacks = 0;
+    epicsMutexUnlock(port.lock);
+}
+
+/*
+ * Write the benchmark setpoint of port and wait for the vendor set call.
+ * Returns the latency in s, or a negative value if the set never came.
+ */
+static double writeSetpoint(benchPort &port, epicsInt32 value)
+{
+    dscsSimStats before, after;
+    epicsUInt64 start;
+
+    dscsSimGetStats(port.devNo, &before);
+    start = epicsMonotonicGet();
+    if (pasynInt32SyncIO->write(port.setpoint, value, BENCH_TIMEOUT) != asynSuccess) return -1;
+    while (1) {
+        dscsSimGetStats(port.devNo, &after);
+        if (after.sets > before.sets) return (after.lastSet - start) / 1e9;
+        if ((epicsMonotonicGet() - start) / 1e9 > BENCH_TIMEOUT) return -1;
+        epicsThreadSleep(0.0001);
+    }
+}
+
+struct benchOptions {
+    int devices;
+    int subscribers;
+    double latency;          // s
+    double jitter;
+    double period;
+    double writeRate;
+    double seconds;
+};
+
+static void measure(std::vector<benchPort *> &ports, int subscribers, const benchOptions &opt, FILE *out)
+{
+    std::list<benchSubscription> subs;
+    std::vector<double> cycles, writes, bursts;
+    unsigned long writesLost = 0, callbacks = 0;
+    double rate = 0, burstTime = 0, cpu, elapsed;
+    epicsInt32 overruns = 0;
+    epicsUInt64 start;
+    char name[64];
+    char line[512];
+
+    for (int s = 0; s < subscribers; ++s) {
+        for (size_t p = 0; p < ports.size(); ++p) {
+            for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+                const dscsParamDesc &desc = dscsParamTable[row];
+                if (!(desc.flags & dscsParamReadback) ||
+                    (desc.type != asynParamInt32 && desc.type != asynParamFloat64)) continue;
+                for (int chan = 0; chan < dscsChannelCount(desc.chans); ++chan) {
+                    dscsParamName(desc, chan, true, name, sizeof(name));
+                    subs.push_back(benchSubscription());
+                    subscribe(subs.back(), *ports[p], name, desc.type == asynParamFloat64,
+                              int32Callback, float64Callback);
+                }
+            }
+        }
+    }
+    for (size_t p = 0; p < ports.size(); ++p) resetPort(*ports[p]);
+
+    cpu = processCpu();
+    start = epicsMonotonicGet();
+    for (unsigned long n = 0; ; ++n) {
+        double due = n / opt.writeRate, now = (epicsMonotonicGet() - start) / 1e9, latency;
+
+        if (now >= opt.seconds) break;
+        if (due > now) epicsThreadSleep(std::min(due, opt.seconds) - now);
+        if ((epicsMonotonicGet() - start) / 1e9 >= opt.seconds) break;
+
+        latency = writeSetpoint(*ports[n % ports.size()], n % 2 ? 1000 : 2000);
+        if (latency < 0) writesLost++;
+        else writes.push_back(latency * 1e3);
+    }
+    elapsed = (epicsMonotonicGet() - start) / 1e9;
+    cpu = (processCpu() - cpu) / elapsed;
+
+    for (size_t p = 0; p < ports.size(); ++p) {
+        benchPort &port = *ports[p];
+        epicsFloat64 portRate = 0;
+        epicsInt32 portOverruns = 0;
+
+        pasynFloat64SyncIO->read(port.rate, &portRate, BENCH_TIMEOUT);
+        pasynInt32SyncIO->read(port.overruns, &portOverruns, BENCH_TIMEOUT);
+        rate += portRate / ports.size();
+        overruns += portOverruns;
+
+        epicsMutexMustLock(port.lock);
+        if (port.burstCallbacks) closeBurst(port);
+        for (size_t i = 0; i < port.cycles.size(); ++i) cycles.push_back(port.cycles[i] * 1e3);
+        bursts.insert(bursts.end(), port.bursts.begin(), port.bursts.end());
+        burstTime += port.burstTime;
+        callbacks += port.callbacks;
+        epicsMutexUnlock(port.lock);
+    }
+    for (std::list<benchSubscription>::iterator it = subs.begin(); it != subs.end(); ++it) unsubscribe(*it);
+
+    snprintf(line, sizeof(line),
+             "%lu %d %.0f %.0f %g %.3f %.3f %.3f %.3f %.2f %d %lu %.3f %.3f %.3f %lu %.0f %.1f %.1f %.1f %.3f %.3f\n",
+             (unsigned long)ports.size(), subscribers, opt.latency * 1e6, opt.jitter * 1e6, opt.period,
+             mean(cycles), percentile(cycles, 0.5), percentile(cycles, 0.99), percentile(cycles, 1),
+             rate, overruns, (unsigned long)writes.size(),
+             percentile(writes, 0.5), percentile(writes, 0.99), percentile(writes, 1), writesLost,
+             callbacks / elapsed, percentile(bursts, 0.5), percentile(bursts, 0.99), percentile(bursts, 1),
+             callbacks ? burstTime / callbacks : NAN, cpu);
+    fputs(line, out);
+    fflush(out);
+    fputs(line, stdout);
+    fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-d devices] [-s subscribers] [-l latency_us] [-j jitter_us]"
+                    " [-p period] [-w writes] [-t seconds] [-o file]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    benchOptions opt = { 4, 8, 100e-6, 0, 0.1, 20, 10 };
+    const char *file = "dscsAsynBench.txt";
+    std::vector<benchPort *> ports;
+    std::list<benchSubscription> cycleSubs;
+    FILE *out;
+
+    for (int i = 1; i < argc; i += 2) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (!value || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+            usage(argv[0]);
+            return 1;
+        }
+        switch (argv[i][1]) {
+        case 'd': opt.devices = atoi(value); break;
+        case 's': opt.subscribers = atoi(value); break;
+        case 'l': opt.latency = atof(value) * 1e-6; break;
+        case 'j': opt.jitter = atof(value) * 1e-6; break;
+        case 'p': opt.period = atof(value); break;
+        case 'w': opt.writeRate = atof(value); break;
+        case 't': opt.seconds = atof(value); break;
+        case 'o': file = value; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.devices < 1 || opt.devices > DSCS_SIM_MAX_DEVICES || opt.subscribers < 0 ||
+        opt.latency < 0 || opt.jitter < 0 || !(opt.period > 0) || !(opt.writeRate > 0) || !(opt.seconds > 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!(out = fopen(file, "w"))) {
+        perror(file);
+        return 1;
+    }
+
+    // what iocInit would do: asynPortDriver posts no callbacks before it
+    interruptAccept = 1;
+    dscsSimConfigure(opt.devices, opt.latency, opt.jitter);
+
+    fprintf(out, "# devices subscribers latency_us jitter_us period_s"
+                 " cycle_mean_ms cycle_p50_ms cycle_p99_ms cycle_max_ms poll_rate_hz overruns"
+                 " writes write_p50_ms write_p99_ms write_max_ms writes_lost"
+                 " callbacks_per_s fanout_p50_us fanout_p99_us fanout_max_us fanout_us_per_callback cpu\n");
+    for (int d = 1; ; d = std::min(2 * d, opt.devices)) {
+        while ((int)ports.size() < d) {
+            benchPort *port = addPort(ports.size(), opt.period, cycleSubs);
+            if (!port) return 1;
+            ports.push_back(port);
+        }
+        // let the new ports connect and settle into their schedule
+        epicsThreadSleep(5 * opt.period);
+
+        for (int s = 0; ; s = std::min(std::max(2 * s, 1), opt.subscribers)) {
+            measure(ports, s, opt, out);
+            if (s == opt.subscribers) break;
+        }
+        if (d == opt.devices) break;
+    }
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * dscsAsynDbGen
+ *
+ * Writes the dscsAsyn record templates from dscsParamTable, so the database
+ * always matches the parameters the driver creates.
+ *
+ *   dscsAsynDbGen inputs  > dscsAsynIntInputs.db    readback, publish filter and history records
+ *   dscsAsynDbGen outputs > dscsAsynIntOutputs.db   setpoint records
+ *
+ * Array parameters (the transformation matrices) have no records yet.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dscsAsynParams.h"
+
+static void writeRecord(const dscsParamDesc &desc, int chan, bool readback)
+{
+    char name[64];
+    bool isFloat = (desc.type == asynParamFloat64);
+
+    dscsParamName(desc, chan, readback, name, sizeof(name));
+
+    if (readback) {
+        printf("record(%s, \"$(P)$(R)%s\")\n", isFloat ? "ai" : "longin", name);
+        printf("{\n");
+        printf("    field(DTYP, \"%s\")\n", isFloat ? "asynFloat64" : "asynInt32");
+        printf("    field(INP,  \"@asyn($(PORT),$(ADDR))%s\")\n", name);
+        printf("    field(SCAN, \"I/O Intr\")\n");
+        if (isFloat) printf("    field(PREC, \"6\")\n");
+        printf("}\n\n");
+    }
+    else {
+        printf("record(%s, \"$(P)$(R)%s\")\n", isFloat ? "ao" : "longout", name);
+        printf("{\n");
+        printf("    field(DTYP, \"%s\")\n", isFloat ? "asynFloat64" : "asynInt32");
+        printf("    field(OUT,  \"@asyn($(PORT),$(ADDR))%s\")\n", name);
+        if (isFloat) printf("    field(PREC, \"6\")\n");
+        // writes complete on the writer thread; their status comes back here
+        printf("    info(asyn:READBACK, \"1\")\n");
+        printf("}\n\n");
+    }
+}
+
+static void writeFilterRecords(const dscsParamDesc &desc)
+{
+    static const char *egu[DSCS_NUM_FILTER_PARAMS] = {"", "", "Hz"};
+    char name[64];
+
+    for (int which = 0; which < DSCS_NUM_FILTER_PARAMS; ++which) {
+        dscsFilterParamName(desc, which, name, sizeof(name));
+        printf("record(ao, \"$(P)$(R)%s\")\n", name);
+        printf("{\n");
+        printf("    field(DTYP, \"asynFloat64\")\n");
+        printf("    field(OUT,  \"@asyn($(PORT),$(ADDR))%s\")\n", name);
+        printf("    field(DRVL, \"0\")\n");
+        printf("    field(PREC, \"3\")\n");
+        if (egu[which][0]) printf("    field(EGU,  \"%s\")\n", egu[which]);
+        printf("    field(PINI, \"YES\")\n");
+        printf("}\n\n");
+    }
+}
+
+// NHIST must hold the samples of DSCS_HISTORY_BLOCKS blocks, about
+// DSCS_HISTORY_BLOCK_BYTES / 2.5 per block
+static void writeHistoryRecords(const dscsParamDesc &desc, int chan)
+{
+    char name[64];
+
+    dscsHistoryParamName(desc, chan, false, name, sizeof(name));
+    printf("record(waveform, \"$(P)$(R)%s\")\n", name);
+    printf("{\n");
+    printf("    field(DTYP, \"asynInt32ArrayIn\")\n");
+    printf("    field(INP,  \"@asyn($(PORT),$(ADDR))%s\")\n", name);
+    printf("    field(SCAN, \"I/O Intr\")\n");
+    printf("    field(FTVL, \"LONG\")\n");
+    printf("    field(NELM, \"$(NHIST=30000)\")\n");
+    printf("}\n\n");
+
+    dscsHistoryParamName(desc, chan, true, name, sizeof(name));
+    printf("record(waveform, \"$(P)$(R)%s\")\n", name);
+    printf("{\n");
+    printf("    field(DTYP, \"asynFloat64ArrayIn\")\n");
+    printf("    field(INP,  \"@asyn($(PORT),$(ADDR))%s\")\n", name);
+    printf("    field(SCAN, \"I/O Intr\")\n");
+    printf("    field(FTVL, \"DOUBLE\")\n");
+    printf("    field(NELM, \"$(NHIST=30000)\")\n");
+    printf("    field(PREC, \"3\")\n");
+    printf("    field(EGU,  \"s\")\n");
+    printf("}\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+    bool readback;
+
+    if (argc == 2 && strcmp(argv[1], "inputs") == 0) readback = true;
+    else if (argc == 2 && strcmp(argv[1], "outputs") == 0) readback = false;
+    else {
+        fprintf(stderr, "usage: %s inputs|outputs\n", argv[0]);
+        return 1;
+    }
+
+    printf("# Generated by dscsAsynDbGen from dscsAsynParams.h; do not edit.\n\n");
+
+    for (int row = 0; row < DSCS_NUM_PARAMS; ++row) {
+        const dscsParamDesc &desc = dscsParamTable[row];
+        unsigned int flag = readback ? dscsParamReadback : dscsParamSetpoint;
+
+        if (!(desc.flags & flag)) continue;
+        if (desc.type != asynParamInt32 && desc.type != asynParamFloat64) continue;
+
+        for (int chan = 0; chan < dscsChannelCount(desc.chans); ++chan) {
+            writeRecord(desc, chan, readback);
+            if (readback && dscsHasHistory(desc)) writeHistoryRecords(desc, chan);
+        }
+        if (readback && dscsHasPublishFilter(desc)) writeFilterRecords(desc);
+    }
+
+    return 0;
+}
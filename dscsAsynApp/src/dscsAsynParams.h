@@ -0,0 +1,576 @@
+/*
+ * Parameter descriptor table for dscsAsyn
+ *
+ * One row per vendor accessor. The driver creates its asyn parameters,
+ * dispatches writes and sequences the poll from this table, and
+ * dscsAsynDbGen writes the record templates from it, so adding a controller
+ * register means adding one row here.
+ *
+ * Parameter names are built from the row's base name:
+ *   setpoint  <name><suffix>        e.g. NFO_PS_X, EXT_ADC_SHIFT
+ *   readback  <name>_RBV<suffix>    e.g. NFO_PS_RBV_X, EXT_ADC_SHIFT_RBV
+ * where the suffix comes from the row's channel set (_X/_Y/_Z, _0.._3, or
+ * nothing for single values).
+ */
+
+#ifndef DSCS_ASYN_PARAMS_H
+#define DSCS_ASYN_PARAMS_H
+
+#include <stdio.h>
+
+#include <asynPortDriver.h>
+
+#include "dscs.h" // vendor supplied library
+
+#define DSCS_MAX_CHANNELS 4
+
+/*
+ * Row identifiers, in table order
+ */
+typedef enum {
+    dscsParOSA_PS,
+    dscsParBS_PS,
+    dscsParAUX_DAC,
+    dscsParNFO_PS,
+    dscsParSAM_PS,
+    dscsParNFO_SG,
+    dscsParSAM_CP_D,
+    dscsParXZ_ZX,
+    dscsParAUX_ADC,
+    dscsParNFO,
+    dscsParSAM,
+    dscsParSetptFreq,
+    dscsParSetptPhase,
+    dscsParSetptAmp,
+    dscsParExtADCShift,
+    dscsParPIEnNFO,
+    dscsParPIIValNFO,
+    dscsParPIPValNFO,
+    dscsParPILimNFO,
+    dscsParPIAvgNFO,
+    dscsParPIEnSAM,
+    dscsParPIIValSAM,
+    dscsParPIPValSAM,
+    dscsParPILimSAM,
+    dscsParPITargPos,
+    dscsParPITargMode,
+    dscsParPINFOOut,
+    dscsParPISAMOut,
+    dscsParNFOADCLimMin,
+    dscsParNFOADCLimMax,
+    dscsParNFOSlewLim,
+    dscsParSAMADCLimMin,
+    dscsParSAMADCLimMax,
+    dscsParSAMSlewLim,
+    dscsParLimState,
+    dscsParInpTransMat,
+    dscsParInpTransRes,
+    dscsParInpTransAvg,
+    dscsParInpTransState,
+    dscsParOutTransMat,
+    dscsParOutTransNFORes,
+    dscsParOutTransSAMRes,
+    dscsParTrajStartX,
+    dscsParTrajEndX,
+    dscsParTrajSpeedX,
+    dscsParTrajStartY,
+    dscsParTrajDistY,
+    dscsParTrajCountY,
+    dscsParTrajTurnTime,
+    dscsParTrajPosTime,
+    dscsParTrajAntiHyst,
+    dscsParTrajSettings,
+    DSCS_NUM_PARAMS
+} dscsParamId;
+
+/*
+ * Channel sets; the channel number is passed to the vendor call as the
+ * DSCS_Axis, DSCS_AUX_ADC or DSCS_XZ_ZX value
+ */
+typedef enum {
+    dscsChanNone, // single value
+    dscsChanXY,   // DSCS_AxisX, DSCS_AxisY
+    dscsChanXYZ,  // DSCS_AxisX..DSCS_AxisZ
+    dscsChanAux3, // DSCS_AUX_0..DSCS_AUX_2
+    dscsChanAux4, // DSCS_AUX_0..DSCS_AUX_3
+    dscsChanXZZX  // DSCS_XZ, DSCS_ZX
+} dscsChannels;
+
+/*
+ * Poll classes
+ */
+typedef enum {
+    dscsPollNone, // never polled (setpoint only, or no getter in the library)
+    dscsPollFast, // every poll cycle
+    dscsPollSlow  // every slowPollDivisor_ cycles
+} dscsPollClass;
+
+#define dscsParamSetpoint 0x1 // has a writable <name><suffix> parameter
+#define dscsParamReadback 0x2 // has a <name>_RBV<suffix> parameter
+#define dscsParamHistory  0x4 // readback keeps a <name>_HIST<suffix> history, see dscsHasHistory
+
+/*
+ * Uniform accessor signatures. Values travel as double, which holds every
+ * Int32 register exactly.
+ */
+typedef int (*dscsGetFn)(unsigned int devNo, int chan, double *value);
+typedef int (*dscsSetFn)(unsigned int devNo, int chan, double value);
+
+struct dscsParamDesc {
+    dscsParamId   id;
+    const char   *name;  // base name, see above
+    asynParamType type;
+    dscsChannels  chans;
+    unsigned int  flags; // dscsParamSetpoint | dscsParamReadback | dscsParamHistory
+    dscsGetFn     get;   // NULL if the library has no getter
+    dscsSetFn     set;   // NULL if the library has no setter
+    dscsPollClass poll;
+};
+
+/*
+ * Adapters from the vendor signatures to dscsGetFn/dscsSetFn
+ */
+template <typename T> inline T dscsFromDouble(double value) { return (T)(long long)value; }
+template <> inline double dscsFromDouble<double>(double value) { return value; }
+
+// int DSCS_getX(devNo, T *value)
+template <typename T, int (*F)(unsigned int, T *)>
+int dscsGetScalar(unsigned int devNo, int, double *value)
+{
+    T v = T();
+    int err = F(devNo, &v);
+    *value = v;
+    return err;
+}
+
+// int DSCS_setX(devNo, T value)
+template <typename T, int (*F)(unsigned int, T)>
+int dscsSetScalar(unsigned int devNo, int, double value)
+{
+    return F(devNo, dscsFromDouble<T>(value));
+}
+
+// int DSCS_getX(devNo, C chan, T *value)
+template <typename C, typename T, int (*F)(unsigned int, C, T *)>
+int dscsGetChannel(unsigned int devNo, int chan, double *value)
+{
+    T v = T();
+    int err = F(devNo, (C)chan, &v);
+    *value = v;
+    return err;
+}
+
+// int DSCS_setX(devNo, C chan, T value)
+template <typename C, typename T, int (*F)(unsigned int, C, T)>
+int dscsSetChannel(unsigned int devNo, int chan, double value)
+{
+    return F(devNo, (C)chan, dscsFromDouble<T>(value));
+}
+
+// The ADC limits are read and written as a min/max pair; the single-ended
+// setters fetch the other half from the controller.
+inline int dscsGetNFOADCLimMin(unsigned int devNo, int, double *value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getNFOADCLimits(devNo, &min, &max);
+    *value = min;
+    return err;
+}
+inline int dscsGetNFOADCLimMax(unsigned int devNo, int, double *value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getNFOADCLimits(devNo, &min, &max);
+    *value = max;
+    return err;
+}
+inline int dscsSetNFOADCLimMin(unsigned int devNo, int, double value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getNFOADCLimits(devNo, &min, &max);
+    if (err != DSCS_Ok) return err;
+    return DSCS_setNFOADCLimits(devNo, (int)value, max);
+}
+inline int dscsSetNFOADCLimMax(unsigned int devNo, int, double value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getNFOADCLimits(devNo, &min, &max);
+    if (err != DSCS_Ok) return err;
+    return DSCS_setNFOADCLimits(devNo, min, (int)value);
+}
+inline int dscsGetSAMADCLimMin(unsigned int devNo, int, double *value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getSAMADCLimits(devNo, &min, &max);
+    *value = min;
+    return err;
+}
+inline int dscsGetSAMADCLimMax(unsigned int devNo, int, double *value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getSAMADCLimits(devNo, &min, &max);
+    *value = max;
+    return err;
+}
+inline int dscsSetSAMADCLimMin(unsigned int devNo, int, double value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getSAMADCLimits(devNo, &min, &max);
+    if (err != DSCS_Ok) return err;
+    return DSCS_setSAMADCLimits(devNo, (int)value, max);
+}
+inline int dscsSetSAMADCLimMax(unsigned int devNo, int, double value)
+{
+    int min = 0, max = 0;
+    int err = DSCS_getSAMADCLimits(devNo, &min, &max);
+    if (err != DSCS_Ok) return err;
+    return DSCS_setSAMADCLimits(devNo, min, (int)value);
+}
+
+// DSCS_getOutputTransformationResult returns NFO and SAM together
+inline int dscsGetOutTransNFORes(unsigned int devNo, int chan, double *value)
+{
+    int nfo = 0, sam = 0;
+    int err = DSCS_getOutputTransformationResult(devNo, (DSCS_Axis)chan, &nfo, &sam);
+    *value = nfo;
+    return err;
+}
+inline int dscsGetOutTransSAMRes(unsigned int devNo, int chan, double *value)
+{
+    int nfo = 0, sam = 0;
+    int err = DSCS_getOutputTransformationResult(devNo, (DSCS_Axis)chan, &nfo, &sam);
+    *value = sam;
+    return err;
+}
+
+// The ADC limits are set as min/max pairs, see dscsLimitPairs
+inline int dscsSetNFOADCLimits(unsigned int devNo, double min, double max)
+{
+    return DSCS_setNFOADCLimits(devNo, (int)min, (int)max);
+}
+inline int dscsSetSAMADCLimits(unsigned int devNo, double min, double max)
+{
+    return DSCS_setSAMADCLimits(devNo, (int)min, (int)max);
+}
+
+// dscsAsynDbGen only needs names and types. Building it with
+// DSCS_PARAMS_NO_ACCESSORS drops every vendor reference from the table so the
+// host tool does not have to link against libdscs.
+#ifdef DSCS_PARAMS_NO_ACCESSORS
+#define DSCS_FN(f)           nullptr
+#else
+#define DSCS_FN(f)           (f)
+#endif
+
+#define DSCS_GET_AXIS(f)     DSCS_FN((dscsGetChannel<DSCS_Axis, int, f>))
+#define DSCS_SET_AXIS(f)     DSCS_FN((dscsSetChannel<DSCS_Axis, int, f>))
+#define DSCS_GET_AXIS_DBL(f) DSCS_FN((dscsGetChannel<DSCS_Axis, double, f>))
+#define DSCS_SET_AXIS_DBL(f) DSCS_FN((dscsSetChannel<DSCS_Axis, double, f>))
+#define DSCS_GET_AUX(f)      DSCS_FN((dscsGetChannel<DSCS_AUX_ADC, int, f>))
+#define DSCS_SET_AUX(f)      DSCS_FN((dscsSetChannel<DSCS_AUX_ADC, int, f>))
+#define DSCS_GET(T, f)       DSCS_FN((dscsGetScalar<T, f>))
+#define DSCS_SET(T, f)       DSCS_FN((dscsSetScalar<T, f>))
+
+#define DSCS_SP  dscsParamSetpoint
+#define DSCS_RB  dscsParamReadback
+#define DSCS_HI  dscsParamHistory
+
+/*
+ * The table. Registers the controller only reads back are dscsPollFast;
+ * configuration registers that only change when written are dscsPollSlow.
+ * DSCS_setPIControllerLimitNFO and DSCS_getInputTransformationAverage are
+ * declared in dscs.h but missing from libdscs, hence the NULL accessors.
+ * DSCS_HI marks the readbacks worth a short-term trend in the IOC.
+ */
+static constexpr dscsParamDesc dscsParamTable[] = {
+  { dscsParOSA_PS,         "OSA_PS",            asynParamInt32,        dscsChanXY,   DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getOSA_PS), DSCS_SET_AXIS(DSCS_setOSA_PS), dscsPollFast },
+  { dscsParBS_PS,          "BS_PS",             asynParamInt32,        dscsChanXY,   DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getBS_PS), DSCS_SET_AXIS(DSCS_setBS_PS), dscsPollFast },
+  { dscsParAUX_DAC,        "AUX_DAC",           asynParamInt32,        dscsChanAux4, DSCS_SP|DSCS_RB,
+    DSCS_GET_AUX(DSCS_getAUX_DAC), DSCS_SET_AUX(DSCS_setAUX_DAC), dscsPollFast },
+  { dscsParNFO_PS,         "NFO_PS",            asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getNFO_PS), DSCS_SET_AXIS(DSCS_setNFO_PS), dscsPollFast },
+  { dscsParSAM_PS,         "SAM_PS",            asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getSAM_PS), DSCS_SET_AXIS(DSCS_setSAM_PS), dscsPollFast },
+  { dscsParNFO_SG,         "NFO_SG",            asynParamInt32,        dscsChanXYZ,  DSCS_RB|DSCS_HI,
+    DSCS_GET_AXIS(DSCS_getNFO_SG), nullptr, dscsPollFast },
+  { dscsParSAM_CP_D,       "SAM_CP_D",          asynParamInt32,        dscsChanXYZ,  DSCS_RB|DSCS_HI,
+    DSCS_GET_AXIS(DSCS_getSAM_CP_D), nullptr, dscsPollFast },
+  { dscsParXZ_ZX,          "XZ_ZX",             asynParamInt32,        dscsChanXZZX, DSCS_RB|DSCS_HI,
+    DSCS_FN((dscsGetChannel<DSCS_XZ_ZX, int, DSCS_getXZ_ZX>)), nullptr, dscsPollFast },
+  { dscsParAUX_ADC,        "AUX_ADC",           asynParamInt32,        dscsChanAux3, DSCS_RB|DSCS_HI,
+    DSCS_GET_AUX(DSCS_getAUX_ADC), nullptr, dscsPollFast },
+  // NFO and SAM read back 0 on the current firmware
+  { dscsParNFO,            "NFO",               asynParamInt32,        dscsChanXYZ,  DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getNFO), nullptr, dscsPollFast },
+  { dscsParSAM,            "SAM",               asynParamInt32,        dscsChanXYZ,  DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getSAM), nullptr, dscsPollFast },
+  { dscsParSetptFreq,      "SETPT_FREQ",        asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getSetpointModulationFrequency), DSCS_SET_AXIS(DSCS_setSetpointModulationFrequency), dscsPollFast },
+  { dscsParSetptPhase,     "SETPT_PHASE",       asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getSetpointModulationPhase), DSCS_SET_AXIS(DSCS_setSetpointModulationPhase), dscsPollFast },
+  { dscsParSetptAmp,       "SETPT_AMP",         asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getSetpointModulationAmplitude), DSCS_SET_AXIS(DSCS_setSetpointModulationAmplitude), dscsPollFast },
+  { dscsParExtADCShift,    "EXT_ADC_SHIFT",     asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getExternalADCShift), DSCS_SET(int, DSCS_setExternalADCShift), dscsPollSlow },
+  { dscsParPIEnNFO,        "PI_EN_NFO",         asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getPIControllerEnabledNFO), DSCS_SET_AXIS(DSCS_setPIControllerEnabledNFO), dscsPollSlow },
+  { dscsParPIIValNFO,      "PI_I_VAL_NFO",      asynParamFloat64,      dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS_DBL(DSCS_getPIControllerIValueNFO), DSCS_SET_AXIS_DBL(DSCS_setPIControllerIValueNFO), dscsPollSlow },
+  { dscsParPIPValNFO,      "PI_P_VAL_NFO",      asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getPIControllerPValueNFO), DSCS_SET_AXIS(DSCS_setPIControllerPValueNFO), dscsPollSlow },
+  { dscsParPILimNFO,       "PI_LIM_NFO",        asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getPIControllerLimitNFO), nullptr, dscsPollSlow },
+  { dscsParPIAvgNFO,       "PI_AVG_NFO",        asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(unsigned short, DSCS_getPIControllerAverageNFO), DSCS_SET(unsigned short, DSCS_setPIControllerAverageNFO), dscsPollSlow },
+  { dscsParPIEnSAM,        "PI_EN_SAM",         asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getPIControllerEnabledSAM), DSCS_SET_AXIS(DSCS_setPIControllerEnabledSAM), dscsPollSlow },
+  { dscsParPIIValSAM,      "PI_I_VAL_SAM",      asynParamFloat64,      dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS_DBL(DSCS_getPIControllerIValueSAM), DSCS_SET_AXIS_DBL(DSCS_setPIControllerIValueSAM), dscsPollSlow },
+  { dscsParPIPValSAM,      "PI_P_VAL_SAM",      asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getPIControllerPValueSAM), DSCS_SET_AXIS(DSCS_setPIControllerPValueSAM), dscsPollSlow },
+  { dscsParPILimSAM,       "PI_LIM_SAM",        asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getPIControllerLimitSAM), DSCS_SET(int, DSCS_setPIControllerLimitSAM), dscsPollSlow },
+  { dscsParPITargPos,      "PI_TARG_POS",       asynParamInt32,        dscsChanXYZ,  DSCS_SP|DSCS_RB,
+    DSCS_GET_AXIS(DSCS_getPIControllerTargetPosition), DSCS_SET_AXIS(DSCS_setPIControllerTargetPosition), dscsPollSlow },
+  { dscsParPITargMode,     "PI_TARG_MODE",      asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(DSCS_TargetMode, DSCS_getPIControllerTargetMode), DSCS_SET(DSCS_TargetMode, DSCS_setPIControllerTargetMode), dscsPollSlow },
+  { dscsParPINFOOut,       "PI_NFO_OUT",        asynParamInt32,        dscsChanXYZ,  DSCS_RB|DSCS_HI,
+    DSCS_GET_AXIS(DSCS_getPIControllerNFOOutput), nullptr, dscsPollSlow },
+  { dscsParPISAMOut,       "PI_SAM_OUT",        asynParamInt32,        dscsChanXYZ,  DSCS_RB|DSCS_HI,
+    DSCS_GET_AXIS(DSCS_getPIControllerSAMOutput), nullptr, dscsPollSlow },
+  { dscsParNFOADCLimMin,   "NFO_ADC_LIM_MIN",   asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_FN(dscsGetNFOADCLimMin), DSCS_FN(dscsSetNFOADCLimMin), dscsPollSlow },
+  { dscsParNFOADCLimMax,   "NFO_ADC_LIM_MAX",   asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_FN(dscsGetNFOADCLimMax), DSCS_FN(dscsSetNFOADCLimMax), dscsPollSlow },
+  { dscsParNFOSlewLim,     "NFO_SLEW_LIM",      asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getNFOSlewRateLimit), DSCS_SET(int, DSCS_setNFOSlewRateLimit), dscsPollSlow },
+  { dscsParSAMADCLimMin,   "SAM_ADC_LIM_MIN",   asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_FN(dscsGetSAMADCLimMin), DSCS_FN(dscsSetSAMADCLimMin), dscsPollSlow },
+  { dscsParSAMADCLimMax,   "SAM_ADC_LIM_MAX",   asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_FN(dscsGetSAMADCLimMax), DSCS_FN(dscsSetSAMADCLimMax), dscsPollSlow },
+  { dscsParSAMSlewLim,     "SAM_SLEW_LIM",      asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getSAMSlewRateLimit), DSCS_SET(int, DSCS_setSAMSlewRateLimit), dscsPollSlow },
+  { dscsParLimState,       "LIM_STATE",         asynParamInt32,        dscsChanNone, DSCS_RB,
+    DSCS_GET(DSCS_LimiterState, DSCS_getLimiterState), nullptr, dscsPollSlow },
+  { dscsParInpTransMat,    "INP_TRANS_MAT",     asynParamFloat64Array, dscsChanNone, DSCS_SP,
+    nullptr, nullptr, dscsPollNone }, // 3x15
+  { dscsParInpTransRes,    "INP_TRANS_RES",     asynParamInt32,        dscsChanXYZ,  DSCS_RB|DSCS_HI,
+    DSCS_GET_AXIS(DSCS_getInputTransformationResult), nullptr, dscsPollSlow },
+  { dscsParInpTransAvg,    "INP_TRANS_AVG",     asynParamInt32,        dscsChanNone, DSCS_RB,
+    nullptr, nullptr, dscsPollNone },
+  { dscsParInpTransState,  "INP_TRANS_STATE",   asynParamInt32,        dscsChanNone, DSCS_RB,
+    DSCS_GET(DSCS_InputTransformationState, DSCS_getInputTransformationState), nullptr, dscsPollSlow },
+  { dscsParOutTransMat,    "OUT_TRANS_MAT",     asynParamFloat64Array, dscsChanNone, DSCS_SP,
+    nullptr, nullptr, dscsPollNone }, // 6x7
+  { dscsParOutTransNFORes, "OUT_TRANS_NFO_RES", asynParamInt32,        dscsChanXYZ,  DSCS_RB,
+    DSCS_FN(dscsGetOutTransNFORes), nullptr, dscsPollSlow },
+  { dscsParOutTransSAMRes, "OUT_TRANS_SAM_RES", asynParamInt32,        dscsChanXYZ,  DSCS_RB,
+    DSCS_FN(dscsGetOutTransSAMRes), nullptr, dscsPollSlow },
+  { dscsParTrajStartX,     "TRAJ_START_X",      asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getTrajectoryLineStartX), DSCS_SET(int, DSCS_setTrajectoryLineStartX), dscsPollSlow },
+  { dscsParTrajEndX,       "TRAJ_END_X",        asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getTrajectoryLineEndX), DSCS_SET(int, DSCS_setTrajectoryLineEndX), dscsPollSlow },
+  { dscsParTrajSpeedX,     "TRAJ_SPEED_X",      asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getTrajectoryLineSpeedX), DSCS_SET(int, DSCS_setTrajectoryLineSpeedX), dscsPollSlow },
+  { dscsParTrajStartY,     "TRAJ_START_Y",      asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getTrajectoryLineStartY), DSCS_SET(int, DSCS_setTrajectoryLineStartY), dscsPollSlow },
+  { dscsParTrajDistY,      "TRAJ_DIST_Y",       asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getTrajectoryLineDistY), DSCS_SET(int, DSCS_setTrajectoryLineDistY), dscsPollSlow },
+  { dscsParTrajCountY,     "TRAJ_COUNT_Y",      asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(unsigned short, DSCS_getTrajectoryLineCountY), DSCS_SET(unsigned short, DSCS_setTrajectoryLineCountY), dscsPollSlow },
+  { dscsParTrajTurnTime,   "TRAJ_TURN_TIME",    asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(unsigned int, DSCS_getTrajectoryTurnTime), DSCS_SET(unsigned int, DSCS_setTrajectoryTurnTime), dscsPollSlow },
+  { dscsParTrajPosTime,    "TRAJ_POS_TIME",     asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(unsigned int, DSCS_getTrajectoryPosTime), DSCS_SET(unsigned int, DSCS_setTrajectoryPosTime), dscsPollSlow },
+  { dscsParTrajAntiHyst,   "TRAJ_ANTI_HYST",    asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(int, DSCS_getTrajectoryAntiHyst), DSCS_SET(int, DSCS_setTrajectoryAntiHyst), dscsPollSlow },
+  { dscsParTrajSettings,   "TRAJ_SETTINGS",     asynParamInt32,        dscsChanNone, DSCS_SP|DSCS_RB,
+    DSCS_GET(unsigned int, DSCS_getTrajectorySettings), DSCS_SET(unsigned int, DSCS_setTrajectorySettings), dscsPollSlow },
+};
+
+/*
+ * Rows the library only sets together. The per-row setters above have to
+ * read the other half back first; the driver sends both halves of a pair in
+ * one call instead, see dscsAsyn::sendLimitPair.
+ */
+typedef int (*dscsSetPairFn)(unsigned int devNo, double min, double max);
+
+struct dscsLimitPair {
+    dscsParamId   min;
+    dscsParamId   max;
+    dscsSetPairFn set;
+};
+
+static constexpr dscsLimitPair dscsLimitPairs[] = {
+  { dscsParNFOADCLimMin, dscsParNFOADCLimMax, DSCS_FN(dscsSetNFOADCLimits) },
+  { dscsParSAMADCLimMin, dscsParSAMADCLimMax, DSCS_FN(dscsSetSAMADCLimits) },
+};
+
+#define DSCS_NUM_LIMIT_PAIRS ((int)(sizeof(dscsLimitPairs) / sizeof(dscsLimitPairs[0])))
+
+/*
+ * Order in which a settings restore writes the rows: the transformations the
+ * outputs pass through, then the limits that protect the stages, then the
+ * outputs themselves, the PI gains and targets, and only then the PI
+ * enables, so a loop never closes on stale gains. Trajectory parameters go
+ * last, nothing depends on them until a trajectory is started.
+ */
+typedef enum {
+    dscsStageMatrices,
+    dscsStageLimits,
+    dscsStageOutputs,
+    dscsStagePI,
+    dscsStagePIEnable,
+    dscsStageTrajectory,
+    DSCS_NUM_STAGES
+} dscsRestoreStage;
+
+inline dscsRestoreStage dscsRestoreStageOf(dscsParamId id)
+{
+    switch (id) {
+    case dscsParInpTransMat:
+    case dscsParOutTransMat:
+        return dscsStageMatrices;
+    case dscsParNFOADCLimMin:
+    case dscsParNFOADCLimMax:
+    case dscsParNFOSlewLim:
+    case dscsParSAMADCLimMin:
+    case dscsParSAMADCLimMax:
+    case dscsParSAMSlewLim:
+        return dscsStageLimits;
+    case dscsParPIIValNFO:
+    case dscsParPIPValNFO:
+    case dscsParPILimNFO:
+    case dscsParPIAvgNFO:
+    case dscsParPIIValSAM:
+    case dscsParPIPValSAM:
+    case dscsParPILimSAM:
+    case dscsParPITargPos:
+    case dscsParPITargMode:
+        return dscsStagePI;
+    case dscsParPIEnNFO:
+    case dscsParPIEnSAM:
+        return dscsStagePIEnable;
+    case dscsParTrajStartX:
+    case dscsParTrajEndX:
+    case dscsParTrajSpeedX:
+    case dscsParTrajStartY:
+    case dscsParTrajDistY:
+    case dscsParTrajCountY:
+    case dscsParTrajTurnTime:
+    case dscsParTrajPosTime:
+    case dscsParTrajAntiHyst:
+    case dscsParTrajSettings:
+        return dscsStageTrajectory;
+    default:
+        return dscsStageOutputs;
+    }
+}
+
+// Rows a settings snapshot covers: setpoints the library can read back
+constexpr bool dscsHasSnapshot(const dscsParamDesc &desc)
+{
+    return (desc.flags & dscsParamSetpoint) && desc.get && desc.set;
+}
+
+#undef DSCS_SP
+#undef DSCS_RB
+#undef DSCS_FN
+#undef DSCS_HI
+
+constexpr bool dscsParamTableOrdered(int row = 0)
+{
+    return row == DSCS_NUM_PARAMS ||
+           (dscsParamTable[row].id == row && dscsParamTableOrdered(row + 1));
+}
+
+static_assert(sizeof(dscsParamTable) / sizeof(dscsParamTable[0]) == DSCS_NUM_PARAMS,
+              "dscsParamTable needs one row per dscsParamId");
+static_assert(dscsParamTableOrdered(), "dscsParamTable rows must be in dscsParamId order");
+
+constexpr int dscsChannelCount(dscsChannels chans)
+{
+    return chans == dscsChanXY   ? 2 :
+           chans == dscsChanXYZ  ? 3 :
+           chans == dscsChanAux3 ? 3 :
+           chans == dscsChanAux4 ? 4 :
+           chans == dscsChanXZZX ? 2 : 1;
+}
+
+inline const char *dscsChannelSuffix(dscsChannels chans, int chan)
+{
+    static const char *axisSuffix[] = {"_X", "_Y", "_Z"};
+    static const char *indexSuffix[] = {"_0", "_1", "_2", "_3"};
+
+    switch (chans) {
+    case dscsChanXY:
+    case dscsChanXYZ:  return axisSuffix[chan];
+    case dscsChanAux3:
+    case dscsChanAux4:
+    case dscsChanXZZX: return indexSuffix[chan];
+    default:           return "";
+    }
+}
+
+/*
+ * Build the setpoint (readback = false) or readback parameter name for one
+ * channel of a row.
+ */
+inline void dscsParamName(const dscsParamDesc &desc, int chan, bool readback,
+                          char *name, size_t maxChars)
+{
+    snprintf(name, maxChars, "%s%s%s", desc.name, readback ? "_RBV" : "",
+             dscsChannelSuffix(desc.chans, chan));
+}
+
+/*
+ * Publish filter for readbacks polled every cycle: a new value is only
+ * posted when it moves by more than the absolute or relative deadband, and
+ * not more often than the maximum rate. One set per row, shared by its
+ * channels:
+ *   <name>_ADEL      absolute deadband, register units (0 = any change)
+ *   <name>_RDEL      relative deadband, fraction of the last posted value
+ *   <name>_MAX_RATE  maximum posts per second (0 = every poll)
+ */
+typedef enum {
+    dscsFilterAdel,
+    dscsFilterRdel,
+    dscsFilterMaxRate,
+    DSCS_NUM_FILTER_PARAMS
+} dscsFilterParam;
+
+constexpr bool dscsHasPublishFilter(const dscsParamDesc &desc)
+{
+    return (desc.flags & dscsParamReadback) && desc.poll == dscsPollFast &&
+           (desc.type == asynParamInt32 || desc.type == asynParamFloat64);
+}
+
+inline void dscsFilterParamName(const dscsParamDesc &desc, int which,
+                                char *name, size_t maxChars)
+{
+    static const char *suffix[DSCS_NUM_FILTER_PARAMS] = {"_ADEL", "_RDEL", "_MAX_RATE"};
+
+    snprintf(name, maxChars, "%s%s", desc.name, suffix[which]);
+}
+
+/*
+ * Readback history, see dscsHistory.h: the polled values of a DSCS_HI row
+ * as two arrays per channel,
+ *   <name>_HIST<suffix>       Int32Array, oldest first
+ *   <name>_HIST_TIME<suffix>  Float64Array, poll time, s past EPICS epoch
+ */
+constexpr bool dscsHasHistory(const dscsParamDesc &desc)
+{
+    return (desc.flags & dscsParamReadback) && (desc.flags & dscsParamHistory) &&
+           desc.type == asynParamInt32 && desc.poll != dscsPollNone;
+}
+
+inline void dscsHistoryParamName(const dscsParamDesc &desc, int chan, bool time,
+                                 char *name, size_t maxChars)
+{
+    snprintf(name, maxChars, "%s_HIST%s%s", desc.name, time ? "_TIME" : "",
+             dscsChannelSuffix(desc.chans, chan));
+}
+
+#endif // DSCS_ASYN_PARAMS_H
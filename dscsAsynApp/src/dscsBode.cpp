@@ -0,0 +1,51 @@
+/*
+ * dscsBode
+ *
+ * See dscsBode.h
+ */
+
+#include <math.h>
+
+#include "dscsBode.h"
+
+void dscsLogSweep(double start, double stop, int points, std::vector<double> &freqs)
+{
+    freqs.clear();
+    if (points < 1 || !(start > 0) || !(stop > 0)) return;
+    if (points == 1) {
+        freqs.push_back(start);
+        return;
+    }
+    double step = log(stop / start) / (points - 1);
+    for (int i = 0; i < points; ++i) freqs.push_back(start * exp(step * i));
+}
+
+void dscsLockIn::start(double freq, double rate)
+{
+    omega_ = 2 * M_PI * freq / rate;
+    n_ = 0;
+    sum_ = sumCos_ = sumSin_ = sumXCos_ = sumXSin_ = 0;
+}
+
+void dscsLockIn::add(double value)
+{
+    double c = cos(omega_ * n_), s = sin(omega_ * n_);
+
+    sum_ += value;
+    sumCos_ += c;
+    sumSin_ += s;
+    sumXCos_ += value * c;
+    sumXSin_ += value * s;
+    n_++;
+}
+
+// x(n) = A cos(omega n + phi) gives re + j im = A e^(j phi)
+double dscsLockIn::re() const
+{
+    return n_ > 0 ? 2 * (sumXCos_ - sum_ / n_ * sumCos_) / n_ : 0;
+}
+
+double dscsLockIn::im() const
+{
+    return n_ > 0 ? -2 * (sumXSin_ - sum_ / n_ * sumSin_) / n_ : 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Frequency response from setpoint modulation
+ *
+ * The controller injects a sine through SETPT_FREQ/SETPT_AMP. At each
+ * frequency of a sweep the response, and where the stream has it the
+ * injected reference, are demodulated against a sine and cosine at that
+ * frequency over a whole number of periods; their complex ratio is one
+ * point of the closed-loop frequency response.
+ *
+ *   frequency   1/2^32 MHz per SETPT_FREQ count
+ */
+
+#ifndef DSCS_BODE_H
+#define DSCS_BODE_H
+
+#include <vector>
+
+#define DSCS_BODE_FREQ_UNIT (1e6 / 4294967296.0) // Hz per SETPT_FREQ count
+
+// points frequencies from start to stop, equally spaced on a log scale
+void dscsLogSweep(double start, double stop, int points, std::vector<double> &freqs);
+
+/*
+ * Lock-in of one signal at one frequency. Samples are taken to be evenly
+ * spaced at the stream rate; the mean is removed, so an offset doesn't leak
+ * into the result. Not thread safe, the owner serialises access.
+ */
+class dscsLockIn {
+public:
+    void start(double freq, double rate);
+    void add(double value);
+
+    // complex amplitude of the signal at freq, peak units; 0 before any sample
+    double re() const;
+    double im() const;
+    int samples() const { return n_; }
+
+private:
+    double omega_;  // rad per sample
+    int n_;
+    double sum_, sumCos_, sumSin_, sumXCos_, sumXSin_;
+};
+
+#endif /* DSCS_BODE_H */
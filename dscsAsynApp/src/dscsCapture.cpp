@@ -0,0 +1,463 @@
+/*
+ * dscsCapture
+ *
+ * See dscsCapture.h
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "dscsCodec.h"
+#include "dscsCapture.h"
+
+static const char captureMagic[8] = { 'D', 'S', 'C', 'S', 'C', 'A', 'P', '\0' };
+
+const char *dscsCaptureCodecName(int codec)
+{
+    switch (codec) {
+    case dscsCaptureRaw:     return "raw";
+    case dscsCaptureVarint:  return "varint";
+    case dscsCaptureBitpack: return "bitpack";
+    default:                 return "unknown";
+    }
+}
+
+static int bitWidth(epicsUInt64 value)
+{
+    int bits = 0;
+    while (value) {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+void dscsCaptureEncode(dscsCaptureCodec codec, const epicsInt32 *values, size_t samples, int width,
+                       std::vector<epicsUInt8> &payload)
+{
+    payload.clear();
+
+    if (codec == dscsCaptureRaw) {
+        const epicsUInt8 *p = (const epicsUInt8 *)values;
+        payload.assign(p, p + samples * width * sizeof(epicsInt32));
+        return;
+    }
+
+    if (codec == dscsCaptureVarint) {
+        std::vector<epicsInt64> prev(width, 0);
+        size_t n = 0;
+
+        // room for the worst case, trimmed after
+        payload.resize(samples * width * DSCS_VARINT_MAX);
+        for (size_t i = 0; i < samples; ++i) {
+            for (int k = 0; k < width; ++k) {
+                epicsInt32 v = values[i * width + k];
+                n += dscsPutVarint(&payload[n], dscsZigzag(v - prev[k]));
+                prev[k] = v;
+            }
+        }
+        payload.resize(n);
+        return;
+    }
+
+    // bitpack, column by column
+    epicsUInt64 z[DSCS_CAPTURE_PACK_SAMPLES];
+    for (int k = 0; k < width; ++k) {
+        epicsInt64 prev = 0;
+
+        for (size_t first = 0; first < samples; first += DSCS_CAPTURE_PACK_SAMPLES) {
+            size_t n = samples - first < DSCS_CAPTURE_PACK_SAMPLES ? samples - first : DSCS_CAPTURE_PACK_SAMPLES;
+            epicsUInt64 all = 0, acc = 0;
+            int bits, accBits = 0;
+
+            for (size_t i = 0; i < n; ++i) {
+                epicsInt32 v = values[(first + i) * width + k];
+                z[i] = dscsZigzag(v - prev);
+                all |= z[i];
+                prev = v;
+            }
+            bits = bitWidth(all);
+            payload.push_back((epicsUInt8)bits);
+            if (bits == 0) continue;
+
+            for (size_t i = 0; i < n; ++i) {
+                acc |= z[i] << accBits;
+                accBits += bits;
+                while (accBits >= 8) {
+                    payload.push_back((epicsUInt8)acc);
+                    acc >>= 8;
+                    accBits -= 8;
+                }
+            }
+            if (accBits > 0) payload.push_back((epicsUInt8)acc);
+        }
+    }
+}
+
+bool dscsCaptureDecode(dscsCaptureCodec codec, const epicsUInt8 *payload, size_t bytes,
+                       size_t samples, int width, epicsInt32 *values)
+{
+    const epicsUInt8 *p = payload, *end = payload + bytes;
+
+    if (codec == dscsCaptureRaw) {
+        if (bytes != samples * width * sizeof(epicsInt32)) return false;
+        memcpy(values, payload, bytes);
+        return true;
+    }
+
+    if (codec == dscsCaptureVarint) {
+        std::vector<epicsInt64> prev(width, 0);
+        epicsUInt64 z;
+        size_t n;
+
+        for (size_t i = 0; i < samples; ++i) {
+            for (int k = 0; k < width; ++k) {
+                if (!(n = dscsGetVarint(p, end, &z))) return false;
+                p += n;
+                prev[k] += dscsUnzigzag(z);
+                values[i * width + k] = (epicsInt32)prev[k];
+            }
+        }
+        return p == end;
+    }
+
+    if (codec != dscsCaptureBitpack) return false;
+    for (int k = 0; k < width; ++k) {
+        epicsInt64 prev = 0;
+
+        for (size_t first = 0; first < samples; first += DSCS_CAPTURE_PACK_SAMPLES) {
+            size_t n = samples - first < DSCS_CAPTURE_PACK_SAMPLES ? samples - first : DSCS_CAPTURE_PACK_SAMPLES;
+            epicsUInt64 acc = 0, mask;
+            int bits, accBits = 0;
+
+            if (p >= end) return false;
+            bits = *p++;
+            if (bits > 64) return false;
+            mask = bits == 64 ? ~(epicsUInt64)0 : ((epicsUInt64)1 << bits) - 1;
+
+            for (size_t i = 0; i < n; ++i) {
+                while (accBits < bits) {
+                    if (p >= end) return false;
+                    acc |= (epicsUInt64)*p++ << accBits;
+                    accBits += 8;
+                }
+                if (bits > 0) {
+                    prev += dscsUnzigzag(acc & mask);
+                    acc >>= bits;
+                    accBits -= bits;
+                }
+                values[(first + i) * width + k] = (epicsInt32)prev;
+            }
+        }
+    }
+    return p == end;
+}
+
+/*
+ * dscsCaptureWriter
+ */
+
+dscsCaptureWriter::dscsCaptureWriter()
+  : fp_(NULL), width_(0), codec_(dscsCaptureRaw), offset_(0), samples_(0)
+{
+}
+
+dscsCaptureWriter::~dscsCaptureWriter()
+{
+    std::string error;
+    close(error);
+}
+
+bool dscsCaptureWriter::open(const char *file, int width, dscsCaptureCodec codec, std::string &error)
+{
+    dscsCaptureHeader header;
+
+    if (fp_ && !close(error)) return false;
+    if (width <= 0 || codec < 0 || codec >= DSCS_NUM_CAPTURE_CODECS) {
+        error = "invalid capture width or codec";
+        return false;
+    }
+
+    fp_ = fopen(file, "wb");
+    if (!fp_) {
+        error = std::string(file) + ": " + strerror(errno);
+        return false;
+    }
+    file_ = file;
+    width_ = width;
+    codec_ = codec;
+    offset_ = 0;
+    samples_ = 0;
+    index_.clear();
+    block_.clear();
+    block_.reserve((size_t)DSCS_CAPTURE_BLOCK_SAMPLES * width);
+
+    memcpy(header.magic, captureMagic, sizeof(header.magic));
+    header.version = DSCS_CAPTURE_VERSION;
+    header.width = width;
+    return write(&header, sizeof(header), error);
+}
+
+bool dscsCaptureWriter::add(epicsUInt64 firstSample, double firstTime, double period,
+                            const epicsInt32 *values, size_t samples, std::string &error)
+{
+    if (!fp_) {
+        error = "capture is not open";
+        return false;
+    }
+
+    for (size_t i = 0; i < samples; ++i) {
+        size_t held = block_.size() / width_;
+
+        // a block only holds consecutive samples
+        if (held > 0 && header_.firstSample + held != firstSample + i && !flush(error)) return false;
+        if (block_.empty()) {
+            header_.firstSample = firstSample + i;
+            header_.firstTime = firstTime + period * i;
+            header_.period = period;
+        }
+        block_.insert(block_.end(), values + i * width_, values + (i + 1) * width_);
+        if (block_.size() / width_ >= DSCS_CAPTURE_BLOCK_SAMPLES && !flush(error)) return false;
+    }
+    return true;
+}
+
+bool dscsCaptureWriter::flush(std::string &error)
+{
+    dscsCaptureIndexEntry entry;
+    size_t samples = block_.size() / width_;
+
+    if (samples == 0) return true;
+    dscsCaptureEncode(codec_, block_.data(), samples, width_, payload_);
+
+    header_.magic = DSCS_CAPTURE_BLOCK_MAGIC;
+    header_.codec = codec_;
+    header_.samples = (epicsUInt32)samples;
+    header_.bytes = (epicsUInt32)payload_.size();
+
+    entry.offset = offset_;
+    entry.firstSample = header_.firstSample;
+    entry.firstTime = header_.firstTime;
+    entry.samples = header_.samples;
+    entry.reserved = 0;
+
+    if (!write(&header_, sizeof(header_), error) || !write(payload_.data(), payload_.size(), error)) return false;
+    index_.push_back(entry);
+    samples_ += samples;
+    block_.clear();
+    return true;
+}
+
+bool dscsCaptureWriter::close(std::string &error)
+{
+    dscsCaptureTrailer trailer;
+    bool ok;
+
+    if (!fp_) return true;
+
+    trailer.indexOffset = 0;
+    ok = flush(error);
+    if (ok) {
+        trailer.indexOffset = offset_;
+        trailer.blocks = (epicsUInt32)index_.size();
+        trailer.magic = DSCS_CAPTURE_INDEX_MAGIC;
+        ok = write(index_.data(), index_.size() * sizeof(dscsCaptureIndexEntry), error) &&
+             write(&trailer, sizeof(trailer), error);
+    }
+    if (!fp_) return false;  // a failed write closed it
+    if (fclose(fp_) && ok) {
+        error = file_ + ": " + strerror(errno);
+        ok = false;
+    }
+    fp_ = NULL;
+    return ok;
+}
+
+bool dscsCaptureWriter::write(const void *data, size_t bytes, std::string &error)
+{
+    if (bytes && fwrite(data, 1, bytes, fp_) != bytes) {
+        error = file_ + ": " + strerror(errno);
+        fail();
+        return false;
+    }
+    offset_ += bytes;
+    return true;
+}
+
+// Leave what was written; the reader rebuilds the index of a capture
+// without one
+void dscsCaptureWriter::fail()
+{
+    fclose(fp_);
+    fp_ = NULL;
+}
+
+/*
+ * dscsCaptureReader
+ */
+
+dscsCaptureReader::dscsCaptureReader()
+  : fp_(NULL), width_(0), indexed_(false)
+{
+}
+
+dscsCaptureReader::~dscsCaptureReader()
+{
+    close();
+}
+
+void dscsCaptureReader::close()
+{
+    if (fp_) fclose(fp_);
+    fp_ = NULL;
+    index_.clear();
+}
+
+bool dscsCaptureReader::open(const char *file, std::string &error)
+{
+    dscsCaptureHeader header;
+    long end;
+
+    close();
+    fp_ = fopen(file, "rb");
+    if (!fp_) {
+        error = std::string(file) + ": " + strerror(errno);
+        return false;
+    }
+
+    if (fread(&header, sizeof(header), 1, fp_) != 1 ||
+        memcmp(header.magic, captureMagic, sizeof(header.magic)) != 0) {
+        error = std::string(file) + ": not a dscsAsyn capture";
+        close();
+        return false;
+    }
+    if (header.version < 1 || header.version > DSCS_CAPTURE_VERSION || header.width == 0) {
+        error = std::string(file) + ": unsupported capture version";
+        close();
+        return false;
+    }
+    width_ = header.width;
+
+    fseek(fp_, 0, SEEK_END);
+    end = ftell(fp_);
+    indexed_ = readIndex(end);
+    if (!indexed_ && !scanBlocks(end)) {
+        error = std::string(file) + ": damaged capture";
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool dscsCaptureReader::readIndex(epicsUInt64 end)
+{
+    dscsCaptureTrailer trailer;
+
+    if (end < sizeof(dscsCaptureHeader) + sizeof(trailer)) return false;
+    if (fseek(fp_, (long)(end - sizeof(trailer)), SEEK_SET) ||
+        fread(&trailer, sizeof(trailer), 1, fp_) != 1 ||
+        trailer.magic != DSCS_CAPTURE_INDEX_MAGIC ||
+        trailer.indexOffset + (epicsUInt64)trailer.blocks * sizeof(dscsCaptureIndexEntry) + sizeof(trailer) != end)
+        return false;
+
+    index_.resize(trailer.blocks);
+    if (trailer.blocks &&
+        (fseek(fp_, (long)trailer.indexOffset, SEEK_SET) ||
+         fread(index_.data(), sizeof(dscsCaptureIndexEntry), trailer.blocks, fp_) != trailer.blocks)) {
+        index_.clear();
+        return false;
+    }
+    return true;
+}
+
+// Walk the block headers up to the first incomplete one
+bool dscsCaptureReader::scanBlocks(epicsUInt64 end)
+{
+    dscsCaptureBlockHeader header;
+    dscsCaptureIndexEntry entry;
+    epicsUInt64 offset = sizeof(dscsCaptureHeader);
+
+    index_.clear();
+    while (offset + sizeof(header) <= end) {
+        if (fseek(fp_, (long)offset, SEEK_SET) || fread(&header, sizeof(header), 1, fp_) != 1) break;
+        if (header.magic != DSCS_CAPTURE_BLOCK_MAGIC || offset + sizeof(header) + header.bytes > end) break;
+        entry.offset = offset;
+        entry.firstSample = header.firstSample;
+        entry.firstTime = header.firstTime;
+        entry.samples = header.samples;
+        entry.reserved = 0;
+        index_.push_back(entry);
+        offset += sizeof(header) + header.bytes;
+    }
+    return offset > sizeof(dscsCaptureHeader) || offset == end;
+}
+
+epicsUInt64 dscsCaptureReader::samples() const
+{
+    epicsUInt64 n = 0;
+    for (size_t i = 0; i < index_.size(); ++i) n += index_[i].samples;
+    return n;
+}
+
+size_t dscsCaptureReader::findSample(epicsUInt64 sample) const
+{
+    size_t lo = 0, hi = index_.size();
+
+    // first block that ends after sample
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (index_[mid].firstSample + index_[mid].samples <= sample) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t dscsCaptureReader::findTime(double time) const
+{
+    size_t lo = 0, hi = index_.size();
+
+    // last block starting at or before time
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (index_[mid].firstTime <= time) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+bool dscsCaptureReader::readHeader(size_t i, dscsCaptureBlockHeader &header, std::string &error)
+{
+    if (!fp_ || i >= index_.size()) {
+        error = "no such block";
+        return false;
+    }
+    if (fseek(fp_, (long)index_[i].offset, SEEK_SET) || fread(&header, sizeof(header), 1, fp_) != 1 ||
+        header.magic != DSCS_CAPTURE_BLOCK_MAGIC) {
+        error = "damaged block header";
+        return false;
+    }
+    return true;
+}
+
+bool dscsCaptureReader::read(size_t i, std::vector<epicsInt32> &values, std::vector<epicsFloat64> &times,
+                             std::string &error)
+{
+    dscsCaptureBlockHeader header;
+
+    if (!readHeader(i, header, error)) return false;
+    payload_.resize(header.bytes);
+    if (header.bytes && fread(payload_.data(), 1, header.bytes, fp_) != header.bytes) {
+        error = "truncated block";
+        return false;
+    }
+
+    values.resize((size_t)header.samples * width_);
+    if (!dscsCaptureDecode((dscsCaptureCodec)header.codec, payload_.data(), payload_.size(),
+                           header.samples, width_, values.data())) {
+        error = "block does not decode";
+        return false;
+    }
+    times.resize(header.samples);
+    for (size_t k = 0; k < header.samples; ++k) times[k] = header.firstTime + header.period * k;
+    return true;
+}
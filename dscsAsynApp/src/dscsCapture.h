@@ -0,0 +1,171 @@
+/*
+ * Stream capture files
+ *
+ * A capture holds the tuples of one stream channel as a sequence of
+ * independent blocks, each covering up to DSCS_CAPTURE_BLOCK_SAMPLES
+ * consecutive samples, followed by an index of the blocks:
+ *
+ *   dscsCaptureHeader
+ *   dscsCaptureBlockHeader, payload     repeated
+ *   dscsCaptureIndexEntry               one per block
+ *   dscsCaptureTrailer
+ *
+ * All fields are in host byte order. A block starts over at lost samples,
+ * so every block is contiguous and its sample times are firstTime + period
+ * * i. The index makes a capture seekable by sample or time; a capture that
+ * was never closed has none, and the reader rebuilds it by walking the
+ * block headers.
+ *
+ * Payload codecs, see dscsCodec.h for zigzag and varint:
+ *   raw      Int32 tuples as they came
+ *   varint   per column, the zigzag delta from the previous sample as a
+ *            varint, tuple by tuple
+ *   bitpack  per column, the zigzag deltas in chunks of
+ *            DSCS_CAPTURE_PACK_SAMPLES, each chunk packed at the bit width
+ *            of its largest delta, which is stored in the byte before it
+ * Deltas start from 0 in every block. The tuples are strongly correlated
+ * from sample to sample, so most deltas take a few bits.
+ *
+ * Neither class is thread safe, the owner serialises access.
+ */
+
+#ifndef DSCS_CAPTURE_H
+#define DSCS_CAPTURE_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <epicsTypes.h>
+
+#define DSCS_CAPTURE_VERSION 1
+#define DSCS_CAPTURE_BLOCK_SAMPLES 4096
+#define DSCS_CAPTURE_PACK_SAMPLES 128
+
+typedef enum {
+    dscsCaptureRaw,
+    dscsCaptureVarint,
+    dscsCaptureBitpack,
+    DSCS_NUM_CAPTURE_CODECS
+} dscsCaptureCodec;
+
+struct dscsCaptureHeader {
+    char magic[8];             // "DSCSCAP\0"
+    epicsUInt32 version;
+    epicsUInt32 width;         // values per tuple
+};
+
+struct dscsCaptureBlockHeader {
+    epicsUInt32 magic;         // DSCS_CAPTURE_BLOCK_MAGIC
+    epicsUInt32 codec;         // dscsCaptureCodec
+    epicsUInt32 samples;
+    epicsUInt32 bytes;         // payload
+    epicsUInt64 firstSample;   // unwrapped stream sample number
+    epicsFloat64 firstTime;    // s past the EPICS epoch
+    epicsFloat64 period;       // s per sample
+};
+
+struct dscsCaptureIndexEntry {
+    epicsUInt64 offset;        // of the block header
+    epicsUInt64 firstSample;
+    epicsFloat64 firstTime;
+    epicsUInt32 samples;
+    epicsUInt32 reserved;
+};
+
+struct dscsCaptureTrailer {
+    epicsUInt64 indexOffset;
+    epicsUInt32 blocks;
+    epicsUInt32 magic;         // DSCS_CAPTURE_INDEX_MAGIC
+};
+
+#define DSCS_CAPTURE_BLOCK_MAGIC 0x4b424344u  // "DCBK"
+#define DSCS_CAPTURE_INDEX_MAGIC 0x58444944u  // "DIDX"
+
+const char *dscsCaptureCodecName(int codec);
+
+// Encode/decode one block payload; width values per tuple
+void dscsCaptureEncode(dscsCaptureCodec codec, const epicsInt32 *values, size_t samples, int width,
+                       std::vector<epicsUInt8> &payload);
+bool dscsCaptureDecode(dscsCaptureCodec codec, const epicsUInt8 *payload, size_t bytes,
+                       size_t samples, int width, epicsInt32 *values);
+
+/*
+ * Writes a capture. add() collects tuples into the current block and writes
+ * it when it is full or the samples stop being consecutive.
+ */
+class dscsCaptureWriter {
+public:
+    dscsCaptureWriter();
+    ~dscsCaptureWriter();
+
+    // All return false and fill error on failure; the file is then closed
+    bool open(const char *file, int width, dscsCaptureCodec codec, std::string &error);
+    bool add(epicsUInt64 firstSample, double firstTime, double period,
+             const epicsInt32 *values, size_t samples, std::string &error);
+    bool close(std::string &error);
+
+    bool isOpen() const { return fp_ != NULL; }
+    epicsUInt64 samples() const { return samples_; }
+    epicsUInt64 rawBytes() const { return samples_ * width_ * sizeof(epicsInt32); }
+    epicsUInt64 fileBytes() const { return offset_; }
+
+private:
+    FILE *fp_;
+    std::string file_;
+    int width_;
+    dscsCaptureCodec codec_;
+    epicsUInt64 offset_;
+    epicsUInt64 samples_;
+    std::vector<dscsCaptureIndexEntry> index_;
+
+    // current block
+    std::vector<epicsInt32> block_;
+    dscsCaptureBlockHeader header_;
+    std::vector<epicsUInt8> payload_;
+
+    bool write(const void *data, size_t bytes, std::string &error);
+    bool flush(std::string &error);
+    void fail();
+};
+
+/*
+ * Reads a capture block by block
+ */
+class dscsCaptureReader {
+public:
+    dscsCaptureReader();
+    ~dscsCaptureReader();
+
+    bool open(const char *file, std::string &error);
+    void close();
+
+    int width() const { return width_; }
+    bool indexed() const { return indexed_; }      // false if the index was rebuilt
+    size_t blocks() const { return index_.size(); }
+    const dscsCaptureIndexEntry &block(size_t i) const { return index_[i]; }
+    epicsUInt64 samples() const;
+
+    // Block holding sample, or the first one after it; blocks() if none
+    size_t findSample(epicsUInt64 sample) const;
+    // Last block starting at or before time; 0 if time precedes them all
+    size_t findTime(double time) const;
+
+    // Tuples and times of block i
+    bool read(size_t i, std::vector<epicsInt32> &values, std::vector<epicsFloat64> &times,
+              std::string &error);
+    // Its header, e.g. for the codec and period
+    bool readHeader(size_t i, dscsCaptureBlockHeader &header, std::string &error);
+
+private:
+    FILE *fp_;
+    int width_;
+    bool indexed_;
+    std::vector<dscsCaptureIndexEntry> index_;
+    std::vector<epicsUInt8> payload_;
+
+    bool readIndex(epicsUInt64 end);
+    bool scanBlocks(epicsUInt64 end);
+};
+
+#endif /* DSCS_CAPTURE_H */
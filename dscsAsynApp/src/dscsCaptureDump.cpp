@@ -0,0 +1,115 @@
+/*
+ * dscsCaptureDump
+ *
+ * Reads the stream captures written by CAPTURE_ENABLE (see dscsCapture.h).
+ *
+ *   dscsCaptureDump info  <file>                    size, codec and span
+ *   dscsCaptureDump index <file>                    one line per block
+ *   dscsCaptureDump dump  <file> [first [count]]    tuples as text, one per line:
+ *                                                   sample time value...
+ *
+ * first is a stream sample number; dump seeks to it through the block index.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dscsCapture.h"
+
+static int showInfo(dscsCaptureReader &reader, const char *file)
+{
+    dscsCaptureBlockHeader first, last;
+    std::string error;
+    epicsUInt64 samples = reader.samples();
+    long bytes;
+    FILE *fp;
+
+    printf("file     %s\n", file);
+    printf("width    %d\n", reader.width());
+    printf("index    %s\n", reader.indexed() ? "yes" : "rebuilt, capture was not closed");
+    printf("blocks   %lu\n", (unsigned long)reader.blocks());
+    printf("samples  %llu\n", (unsigned long long)samples);
+    if (reader.blocks() == 0) return 0;
+
+    if (!reader.readHeader(0, first, error) || !reader.readHeader(reader.blocks() - 1, last, error)) {
+        fprintf(stderr, "%s: %s\n", file, error.c_str());
+        return 1;
+    }
+    printf("codec    %s\n", dscsCaptureCodecName(first.codec));
+    printf("first    sample %llu at %.9f s\n", (unsigned long long)first.firstSample, first.firstTime);
+    printf("last     sample %llu at %.9f s\n",
+           (unsigned long long)(last.firstSample + last.samples - 1),
+           last.firstTime + last.period * (last.samples - 1));
+    printf("lost     %llu samples\n",
+           (unsigned long long)(last.firstSample + last.samples - first.firstSample - samples));
+
+    fp = fopen(file, "rb");
+    if (fp && fseek(fp, 0, SEEK_END) == 0 && (bytes = ftell(fp)) > 0) {
+        printf("ratio    %.2f\n", (double)samples * reader.width() * sizeof(epicsInt32) / bytes);
+    }
+    if (fp) fclose(fp);
+    return 0;
+}
+
+static int showIndex(dscsCaptureReader &reader)
+{
+    printf("# block offset first_sample samples first_time\n");
+    for (size_t i = 0; i < reader.blocks(); ++i) {
+        const dscsCaptureIndexEntry &entry = reader.block(i);
+        printf("%lu %llu %llu %u %.9f\n", (unsigned long)i, (unsigned long long)entry.offset,
+               (unsigned long long)entry.firstSample, entry.samples, entry.firstTime);
+    }
+    return 0;
+}
+
+static int showTuples(dscsCaptureReader &reader, const char *file, epicsUInt64 first, epicsUInt64 count)
+{
+    std::vector<epicsInt32> values;
+    std::vector<epicsFloat64> times;
+    std::string error;
+    int width = reader.width();
+
+    for (size_t i = reader.findSample(first); i < reader.blocks() && count > 0; ++i) {
+        const dscsCaptureIndexEntry &entry = reader.block(i);
+
+        if (!reader.read(i, values, times, error)) {
+            fprintf(stderr, "%s: block %lu: %s\n", file, (unsigned long)i, error.c_str());
+            return 1;
+        }
+        for (size_t k = 0; k < entry.samples && count > 0; ++k) {
+            if (entry.firstSample + k < first) continue;
+            printf("%llu %.9f", (unsigned long long)(entry.firstSample + k), times[k]);
+            for (int c = 0; c < width; ++c) printf(" %d", values[k * width + c]);
+            printf("\n");
+            count--;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    dscsCaptureReader reader;
+    std::string error;
+    epicsUInt64 first = 0, count = ~(epicsUInt64)0;
+
+    if (argc < 3 || (strcmp(argv[1], "dump") != 0 && argc != 3) || argc > 5) {
+        fprintf(stderr, "usage: %s info|index <file>\n"
+                        "       %s dump <file> [first [count]]\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (argc > 3) first = strtoull(argv[3], NULL, 0);
+    if (argc > 4) count = strtoull(argv[4], NULL, 0);
+
+    if (!reader.open(argv[2], error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    if (strcmp(argv[1], "info") == 0) return showInfo(reader, argv[2]);
+    if (strcmp(argv[1], "index") == 0) return showIndex(reader);
+    if (strcmp(argv[1], "dump") == 0) return showTuples(reader, argv[2], first, count);
+    fprintf(stderr, "%s: unknown command %s\n", argv[0], argv[1]);
+    return 1;
+}
@@ -0,0 +1,73 @@
+/*
+ * dscsClockModel
+ *
+ * Running least-squares fit of t = meanTime + slope * (index - meanIndex).
+ * The sums are kept centred on the weighted means (West's weighted update) so
+ * the fit stays well conditioned however large the index grows, and are
+ * decayed by lambda_ per observation so slow drift between the controller
+ * clock and the host clock is followed.
+ *
+ * Transport latency is a constant offset that cannot be separated from the
+ * arrival times; it ends up in the intercept. It is the same for every sample,
+ * so spacing and relative timing are unaffected.
+ */
+
+#include <math.h>
+
+#include "dscsClockModel.h"
+
+dscsClockModel::dscsClockModel(double memory)
+  : lambda_(memory > 1 ? 1.0 - 1.0 / memory : 0)
+{
+    reset();
+}
+
+void dscsClockModel::reset()
+{
+    weight_ = 0;
+    meanIndex_ = 0;
+    meanTime_ = 0;
+    sxx_ = 0;
+    sxy_ = 0;
+    residVar_ = 0;
+    count_ = 0;
+}
+
+void dscsClockModel::update(double index, double t)
+{
+    double dx, dy, resid;
+    bool predicted = valid();
+
+    // residual against the fit before this point, so outliers show up
+    resid = predicted ? t - timeOf(index) : 0;
+
+    weight_ = lambda_ * weight_ + 1;
+    if (predicted) residVar_ += (resid * resid - residVar_) / weight_;
+    dx = index - meanIndex_;
+    dy = t - meanTime_;
+    meanIndex_ += dx / weight_;
+    meanTime_ += dy / weight_;
+    sxx_ = lambda_ * sxx_ + dx * (index - meanIndex_);
+    sxy_ = lambda_ * sxy_ + dx * (t - meanTime_);
+    count_++;
+}
+
+bool dscsClockModel::valid() const
+{
+    return count_ >= 2 && sxx_ > 0;
+}
+
+double dscsClockModel::timeOf(double index) const
+{
+    return meanTime_ + period() * (index - meanIndex_);
+}
+
+double dscsClockModel::period() const
+{
+    return valid() ? sxy_ / sxx_ : 0;
+}
+
+double dscsClockModel::residual() const
+{
+    return sqrt(residVar_);
+}
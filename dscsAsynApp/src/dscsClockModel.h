@@ -0,0 +1,55 @@
+/*
+ * Sample clock model for streamed data
+ *
+ * The vendor data callbacks deliver a running sample index but no time.
+ * dscsClockModel fits host arrival time against sample index with an
+ * exponentially weighted linear regression, so every sample can be given an
+ * acquisition time on the controller's own clock instead of the jittery
+ * arrival time of the packet that carried it.
+ *
+ * Times are seconds relative to an arbitrary origin chosen by the caller;
+ * indices are the caller's unwrapped sample counters. Not thread safe, the
+ * owner serialises access.
+ */
+
+#ifndef DSCS_CLOCK_MODEL_H
+#define DSCS_CLOCK_MODEL_H
+
+#define DSCS_CLOCK_MEMORY 1000 // packets in the regression's effective window
+
+class dscsClockModel {
+public:
+    dscsClockModel(double memory = DSCS_CLOCK_MEMORY);
+
+    void reset();
+
+    // Add one observation: sample `index` had arrived by time `t`
+    void update(double index, double t);
+
+    // True once two distinct indices have been seen
+    bool valid() const;
+
+    // Estimated acquisition time of sample `index`
+    double timeOf(double index) const;
+
+    // Estimated sample period, s; 0 until valid()
+    double period() const;
+
+    // RMS residual of the arrival times around the fit, s
+    double residual() const;
+
+    // Observations since the last reset
+    unsigned long count() const { return count_; }
+
+private:
+    double lambda_;      // forgetting factor, 1 - 1/memory
+    double weight_;      // sum of the decayed observation weights
+    double meanIndex_;
+    double meanTime_;
+    double sxx_;         // decayed centred sums
+    double sxy_;
+    double residVar_;
+    unsigned long count_;
+};
+
+#endif /* DSCS_CLOCK_MODEL_H */
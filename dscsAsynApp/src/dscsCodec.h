@@ -0,0 +1,57 @@
+/*
+ * Integer coding for the compact histories and captures
+ *
+ * Signed deltas are zigzag mapped (0, -1, 1, -2, ... to 0, 1, 2, 3, ...)
+ * and written as little-endian base-128 varints, so small changes take one
+ * byte whatever their sign. A varint of a 64 bit value takes at most
+ * DSCS_VARINT_MAX bytes.
+ */
+
+#ifndef DSCS_CODEC_H
+#define DSCS_CODEC_H
+
+#include <stddef.h>
+
+#include <epicsTypes.h>
+
+#define DSCS_VARINT_MAX 10
+
+inline epicsUInt64 dscsZigzag(epicsInt64 value)
+{
+    return ((epicsUInt64)value << 1) ^ (epicsUInt64)(value >> 63);
+}
+
+inline epicsInt64 dscsUnzigzag(epicsUInt64 value)
+{
+    return (epicsInt64)(value >> 1) ^ -(epicsInt64)(value & 1);
+}
+
+// Bytes written to buf, which must have DSCS_VARINT_MAX free
+inline size_t dscsPutVarint(epicsUInt8 *buf, epicsUInt64 value)
+{
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        buf[n++] = (epicsUInt8)(value | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = (epicsUInt8)value;
+    return n;
+}
+
+// Bytes read from buf, 0 if the varint runs past end or is too long
+inline size_t dscsGetVarint(const epicsUInt8 *buf, const epicsUInt8 *end, epicsUInt64 *value)
+{
+    epicsUInt64 v = 0;
+
+    for (size_t n = 0; n < DSCS_VARINT_MAX && buf + n < end; ++n) {
+        v |= (epicsUInt64)(buf[n] & 0x7f) << (7 * n);
+        if (!(buf[n] & 0x80)) {
+            *value = v;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* DSCS_CODEC_H */
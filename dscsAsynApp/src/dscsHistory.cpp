@@ -0,0 +1,105 @@
+/*
+ * dscsHistory
+ *
+ * See dscsHistory.h
+ */
+
+#include <math.h>
+
+#include "dscsCodec.h"
+#include "dscsHistory.h"
+
+dscsHistory::dscsHistory(epicsUInt8 *memory, int blocks)
+  : memory_(memory), blocks_(blocks > 0 ? blocks : 0)
+{
+    clear();
+}
+
+void dscsHistory::clear()
+{
+    first_ = 0;
+    count_ = 0;
+    samples_ = 0;
+}
+
+void dscsHistory::add(double time, epicsInt32 value)
+{
+    epicsUInt8 buf[2 * DSCS_VARINT_MAX];
+    size_t n;
+
+    if (blocks_.empty()) return;
+    if (count_ == 0) {
+        startBlock(time, value);
+        return;
+    }
+
+    dscsHistoryBlock &block = blocks_[(first_ + count_ - 1) % blocks_.size()];
+    epicsInt64 t = (epicsInt64)llround((time - block.time) * 1e6);
+    epicsInt64 step = t - lastTime_;
+
+    n = dscsPutVarint(buf, dscsZigzag((epicsInt64)value - lastValue_));
+    n += dscsPutVarint(buf + n, dscsZigzag(step - lastStep_));
+    if (block.bytes + n > DSCS_HISTORY_BLOCK_BYTES) {
+        startBlock(time, value);
+        return;
+    }
+
+    epicsUInt8 *dst = memory_ + (size_t)((first_ + count_ - 1) % blocks_.size()) * DSCS_HISTORY_BLOCK_BYTES + block.bytes;
+    for (size_t i = 0; i < n; ++i) dst[i] = buf[i];
+    block.bytes += (int)n;
+    block.samples++;
+    samples_++;
+    lastValue_ = value;
+    lastTime_ = t;
+    lastStep_ = step;
+}
+
+void dscsHistory::startBlock(double time, epicsInt32 value)
+{
+    if (count_ == (int)blocks_.size()) {
+        samples_ -= blocks_[first_].samples;
+        first_ = (first_ + 1) % blocks_.size();
+        count_--;
+    }
+
+    dscsHistoryBlock &block = blocks_[(first_ + count_) % blocks_.size()];
+    block.time = time;
+    block.value = value;
+    block.samples = 1;
+    block.bytes = 0;
+    count_++;
+    samples_++;
+    lastValue_ = value;
+    lastTime_ = 0;
+    lastStep_ = 0;
+}
+
+void dscsHistory::copy(std::vector<epicsInt32> &values, std::vector<epicsFloat64> &times) const
+{
+    values.clear();
+    times.clear();
+    values.reserve(samples_);
+    times.reserve(samples_);
+
+    for (int b = 0; b < count_; ++b) {
+        int index = (first_ + b) % blocks_.size();
+        const dscsHistoryBlock &block = blocks_[index];
+        const epicsUInt8 *p = memory_ + (size_t)index * DSCS_HISTORY_BLOCK_BYTES;
+        const epicsUInt8 *end = p + block.bytes;
+        epicsInt64 value = block.value, t = 0, step = 0;
+        epicsUInt64 dv, dstep;
+        size_t n, m;
+
+        values.push_back(block.value);
+        times.push_back(block.time);
+        for (int i = 1; i < block.samples; ++i) {
+            if (!(n = dscsGetVarint(p, end, &dv)) || !(m = dscsGetVarint(p + n, end, &dstep))) break;
+            p += n + m;
+            value += dscsUnzigzag(dv);
+            step += dscsUnzigzag(dstep);
+            t += step;
+            values.push_back((epicsInt32)value);
+            times.push_back(block.time + t * 1e-6);
+        }
+    }
+}
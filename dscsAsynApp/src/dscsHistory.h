@@ -0,0 +1,59 @@
+/*
+ * Readback history for dscsAsyn
+ *
+ * The recent values of one Int32 readback with their poll times, kept in a
+ * fixed share of memory the owner preallocates for all histories. The share
+ * is cut into blocks of DSCS_HISTORY_BLOCK_BYTES. Each block starts from an
+ * absolute value and time, held beside it, and then stores every sample as
+ * two zigzag varints (see dscsCodec.h): the change of the value, and the
+ * change of the time step in us, which is 0 at a steady poll rate. A slowly
+ * moving readback thus takes 2-3 bytes per sample. When all blocks are full
+ * the oldest one is dropped, so the history never allocates. Not thread
+ * safe, the owner serialises access.
+ */
+
+#ifndef DSCS_HISTORY_H
+#define DSCS_HISTORY_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <epicsTypes.h>
+
+#define DSCS_HISTORY_BLOCK_BYTES 1024
+
+class dscsHistory {
+public:
+    // blocks * DSCS_HISTORY_BLOCK_BYTES of memory, owned by the caller
+    dscsHistory(epicsUInt8 *memory, int blocks);
+
+    void clear();
+    void add(double time, epicsInt32 value);  // time in s, e.g. past the EPICS epoch
+    size_t size() const { return samples_; }
+
+    // oldest first
+    void copy(std::vector<epicsInt32> &values, std::vector<epicsFloat64> &times) const;
+
+private:
+    struct dscsHistoryBlock {
+        double time;        // s, first sample
+        epicsInt32 value;   // first sample
+        int samples;
+        int bytes;          // encoded bytes after the first sample
+    };
+
+    epicsUInt8 *memory_;
+    std::vector<dscsHistoryBlock> blocks_;
+    int first_;             // oldest block
+    int count_;             // blocks in use
+    size_t samples_;
+
+    // encoder state of the newest block
+    epicsInt32 lastValue_;
+    epicsInt64 lastTime_;   // us past the block's time
+    epicsInt64 lastStep_;   // us
+
+    void startBlock(double time, epicsInt32 value);
+};
+
+#endif /* DSCS_HISTORY_H */
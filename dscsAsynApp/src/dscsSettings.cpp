@@ -0,0 +1,104 @@
+/*
+ * dscsSettings
+ *
+ * See dscsSettings.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <epicsTime.h>
+
+#include "dscsSettings.h"
+
+#define DSCS_SETTINGS_HEADER "# dscsAsyn settings"
+
+bool dscsSettings::find(const char *name, double *value) const
+{
+    std::map<std::string, double>::const_iterator it = values_.find(name);
+
+    if (it == values_.end()) return false;
+    *value = it->second;
+    return true;
+}
+
+/*
+ * Written to <file>.tmp and renamed, so an interrupted save never leaves a
+ * truncated snapshot behind.
+ */
+bool dscsSettings::save(const char *file, const char *port, std::string &error) const
+{
+    std::string tmp = std::string(file) + ".tmp";
+    epicsTimeStamp now;
+    char stamp[64];
+    FILE *fp;
+
+    fp = fopen(tmp.c_str(), "w");
+    if (!fp) {
+        error = tmp + ": " + strerror(errno);
+        return false;
+    }
+
+    epicsTimeGetCurrent(&now);
+    epicsTimeToStrftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S.%03f", &now);
+    fprintf(fp, "%s %d\n", DSCS_SETTINGS_HEADER, DSCS_SETTINGS_VERSION);
+    fprintf(fp, "# port %s saved %s\n", port, stamp);
+    for (std::map<std::string, double>::const_iterator it = values_.begin(); it != values_.end(); ++it) {
+        fprintf(fp, "%s %.17g\n", it->first.c_str(), it->second);
+    }
+
+    if (ferror(fp) | fclose(fp)) {
+        error = tmp + ": write failed";
+        remove(tmp.c_str());
+        return false;
+    }
+    if (rename(tmp.c_str(), file)) {
+        error = std::string(file) + ": " + strerror(errno);
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool dscsSettings::load(const char *file, std::string &error)
+{
+    char line[256], name[128];
+    int version = 0, lineNo = 0;
+    double value;
+    FILE *fp;
+
+    values_.clear();
+    fp = fopen(file, "r");
+    if (!fp) {
+        error = std::string(file) + ": " + strerror(errno);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        if (lineNo == 1) {
+            if (sscanf(line, DSCS_SETTINGS_HEADER " %d", &version) != 1) break;
+            continue;
+        }
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+        if (sscanf(line, "%127s %lf", name, &value) != 2) {
+            snprintf(line, sizeof(line), "%s:%d: expected <name> <value>", file, lineNo);
+            error = line;
+            values_.clear();
+            fclose(fp);
+            return false;
+        }
+        values_[name] = value;
+    }
+    fclose(fp);
+
+    if (version < 1 || version > DSCS_SETTINGS_VERSION) {
+        snprintf(line, sizeof(line), "%s: not a dscsAsyn settings file of version 1..%d",
+            file, DSCS_SETTINGS_VERSION);
+        error = line;
+        values_.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+/*
+ * Settings snapshot file for dscsAsyn
+ *
+ * A snapshot is the setpoint of every table row that can be read back,
+ * keyed by setpoint parameter name. The file is plain text in the spirit of
+ * an autosave .sav file, so it can be diffed and edited by hand:
+ *
+ *   # dscsAsyn settings 1
+ *   # port DSCS saved 2026-10-19 10:12:03.123
+ *   NFO_PS_X 1200
+ *   PI_I_VAL_NFO_X 0.25
+ *   ...
+ *
+ * The number after "settings" is the format version; files of a newer
+ * version are refused. Not thread safe, the owner serialises access.
+ */
+
+#ifndef DSCS_SETTINGS_H
+#define DSCS_SETTINGS_H
+
+#include <map>
+#include <string>
+
+#define DSCS_SETTINGS_VERSION 1
+
+class dscsSettings {
+public:
+    void clear() { values_.clear(); }
+    void set(const char *name, double value) { values_[name] = value; }
+    bool find(const char *name, double *value) const;
+    size_t size() const { return values_.size(); }
+
+    // Both return false and fill error on failure
+    bool save(const char *file, const char *port, std::string &error) const;
+    bool load(const char *file, std::string &error);
+
+private:
+    std::map<std::string, double> values_;
+};
+
+#endif /* DSCS_SETTINGS_H */
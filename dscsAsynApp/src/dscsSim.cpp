@@ -0,0 +1,352 @@
+/*
+ * dscsSim
+ *
+ * See dscsSim.h
+ */
+
+#include <stdio.h>
+#include <map>
+#include <string>
+
+#include <epicsMutex.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+#include "dscs.h"
+#include "dscsSim.h"
+
+struct dscsSimDevice {
+    epicsMutexId lock;
+    std::map<std::string, double> registers;  // name or name/index
+    dscsSimStats stats;
+    bool connected;
+    epicsUInt32 seed;                         // for the jitter
+};
+
+static dscsSimDevice simDevices[DSCS_SIM_MAX_DEVICES];
+static int simCount = 0;
+static double simLatency = 0;
+static double simJitter = 0;
+
+void dscsSimConfigure(int devices, double latency, double jitter)
+{
+    if (devices > DSCS_SIM_MAX_DEVICES) devices = DSCS_SIM_MAX_DEVICES;
+    for (int i = simCount; i < devices; ++i) {
+        simDevices[i].lock = epicsMutexMustCreate();
+        simDevices[i].stats.calls = simDevices[i].stats.sets = 0;
+        simDevices[i].stats.lastSet = 0;
+        simDevices[i].connected = false;
+        simDevices[i].seed = i + 1;
+    }
+    if (devices > simCount) simCount = devices;
+    simLatency = latency;
+    simJitter = jitter;
+}
+
+void dscsSimGetStats(unsigned int devNo, dscsSimStats *stats)
+{
+    if ((int)devNo >= simCount) return;
+    epicsMutexMustLock(simDevices[devNo].lock);
+    *stats = simDevices[devNo].stats;
+    epicsMutexUnlock(simDevices[devNo].lock);
+}
+
+/*
+ * One vendor call: takes the device for the link latency. Returns the
+ * locked device, or NULL with the error code in *code.
+ */
+static dscsSimDevice *simBegin(unsigned int devNo, bool set, int *code)
+{
+    if ((int)devNo >= simCount) {
+        *code = DSCS_NoDevice;
+        return NULL;
+    }
+    dscsSimDevice &device = simDevices[devNo];
+    epicsMutexMustLock(device.lock);
+    if (!device.connected) {
+        epicsMutexUnlock(device.lock);
+        *code = DSCS_NotConnected;
+        return NULL;
+    }
+    device.seed = device.seed * 1664525u + 1013904223u;
+    double delay = simLatency + simJitter * (device.seed >> 8) / (1 << 24);
+    if (delay > 0) epicsThreadSleep(delay);
+    device.stats.calls++;
+    if (set) {
+        device.stats.sets++;
+        device.stats.lastSet = epicsMonotonicGet();
+    }
+    *code = DSCS_Ok;
+    return &device;
+}
+
+static std::string simKey(const char *name, int index)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "/%d", index);
+    return std::string(name) + buf;
+}
+
+template <typename T>
+static int simGet(unsigned int devNo, const char *name, int index, T *value)
+{
+    int code;
+    dscsSimDevice *device = simBegin(devNo, false, &code);
+    if (!device) return code;
+
+    std::map<std::string, double>::const_iterator it = device->registers.find(simKey(name, index));
+    *value = it != device->registers.end() ? (T)it->second : (T)(device->stats.calls % 1000);
+    epicsMutexUnlock(device->lock);
+    return DSCS_Ok;
+}
+
+template <typename T>
+static int simSet(unsigned int devNo, const char *name, int index, T value)
+{
+    int code;
+    dscsSimDevice *device = simBegin(devNo, true, &code);
+    if (!device) return code;
+
+    device->registers[simKey(name, index)] = (double)value;
+    epicsMutexUnlock(device->lock);
+    return DSCS_Ok;
+}
+
+static int simCall(unsigned int devNo, bool set)
+{
+    int code;
+    dscsSimDevice *device = simBegin(devNo, set, &code);
+    if (device) epicsMutexUnlock(device->lock);
+    return code;
+}
+
+/*
+ * Connection
+ */
+
+const char *WINCC DSCS_getVersion()
+{
+    return "dscsSim";
+}
+
+int WINCC DSCS_discover(const DSCS_InterfaceType ifaces, unsigned int *devCount)
+{
+    *devCount = simCount;
+    return DSCS_Ok;
+}
+
+int WINCC DSCS_getDeviceInfo(const unsigned int devNo, int *id, char *serialNo, char *address)
+{
+    if ((int)devNo >= simCount) return DSCS_NoDevice;
+    *id = devNo + 1;
+    if (serialNo) sprintf(serialNo, "SIM%u", devNo + 1);
+    if (address) sprintf(address, "sim:%u", devNo);
+    return DSCS_Ok;
+}
+
+DSCS_ConnectionType WINCC DSCS_getConnectionType(const unsigned int devNo)
+{
+    return ControllerConnection;
+}
+
+int WINCC DSCS_connect(const unsigned int devNo)
+{
+    if ((int)devNo >= simCount) return DSCS_NoDevice;
+    epicsMutexMustLock(simDevices[devNo].lock);
+    simDevices[devNo].connected = true;
+    epicsMutexUnlock(simDevices[devNo].lock);
+    return DSCS_Ok;
+}
+
+int WINCC DSCS_disconnect(const unsigned int devNo)
+{
+    if ((int)devNo >= simCount) return DSCS_NoDevice;
+    epicsMutexMustLock(simDevices[devNo].lock);
+    simDevices[devNo].connected = false;
+    epicsMutexUnlock(simDevices[devNo].lock);
+    return DSCS_Ok;
+}
+
+// The simulated controller does not stream
+int WINCC DSCS_setDataCallback(const unsigned int devNo, DSCS_DataCallback callback)
+{
+    return simCall(devNo, true);
+}
+
+int WINCC DSCS_setDataOutputEnabled(const unsigned int devNo, const bln32 enable)
+{
+    return simSet(devNo, "DataOutputEnabled", 0, enable);
+}
+
+/*
+ * Registers
+ */
+
+#define SIM_GET(name, T) \
+    int WINCC DSCS_get##name(const unsigned int devNo, T *value) \
+    { return simGet(devNo, #name, 0, value); }
+#define SIM_SET(name, T) \
+    int WINCC DSCS_set##name(const unsigned int devNo, const T value) \
+    { return simSet(devNo, #name, 0, value); }
+#define SIM_GET_CHAN(name, C, T) \
+    int WINCC DSCS_get##name(const unsigned int devNo, const C chan, T *value) \
+    { return simGet(devNo, #name, chan, value); }
+#define SIM_SET_CHAN(name, C, T) \
+    int WINCC DSCS_set##name(const unsigned int devNo, const C chan, const T value) \
+    { return simSet(devNo, #name, chan, value); }
+#define SIM_REGISTER(name, T) SIM_GET(name, T) SIM_SET(name, T)
+#define SIM_REGISTER_CHAN(name, C, T) SIM_GET_CHAN(name, C, T) SIM_SET_CHAN(name, C, T)
+
+SIM_REGISTER_CHAN(OSA_PS, DSCS_Axis, int)
+SIM_REGISTER_CHAN(BS_PS, DSCS_Axis, int)
+SIM_REGISTER_CHAN(AUX_DAC, DSCS_AUX_ADC, int)
+SIM_REGISTER_CHAN(NFO_PS, DSCS_Axis, int)
+SIM_REGISTER_CHAN(SAM_PS, DSCS_Axis, int)
+SIM_GET_CHAN(NFO_SG, DSCS_Axis, int)
+SIM_GET_CHAN(SAM_CP_D, DSCS_Axis, int)
+SIM_GET_CHAN(XZ_ZX, DSCS_XZ_ZX, int)
+SIM_GET_CHAN(AUX_ADC, DSCS_AUX_ADC, int)
+SIM_GET_CHAN(NFO, DSCS_Axis, int)
+SIM_GET_CHAN(SAM, DSCS_Axis, int)
+
+SIM_REGISTER_CHAN(SetpointModulationFrequency, DSCS_Axis, int)
+SIM_REGISTER_CHAN(SetpointModulationPhase, DSCS_Axis, int)
+SIM_REGISTER_CHAN(SetpointModulationAmplitude, DSCS_Axis, int)
+SIM_REGISTER(ExternalADCShift, int)
+
+SIM_REGISTER_CHAN(PIControllerEnabledNFO, DSCS_Axis, bln32)
+SIM_REGISTER_CHAN(PIControllerIValueNFO, DSCS_Axis, double)
+SIM_REGISTER_CHAN(PIControllerPValueNFO, DSCS_Axis, int)
+SIM_REGISTER(PIControllerLimitNFO, int)
+SIM_REGISTER(PIControllerAverageNFO, unsigned short)
+SIM_REGISTER_CHAN(PIControllerEnabledSAM, DSCS_Axis, bln32)
+SIM_REGISTER_CHAN(PIControllerIValueSAM, DSCS_Axis, double)
+SIM_REGISTER_CHAN(PIControllerPValueSAM, DSCS_Axis, int)
+SIM_REGISTER(PIControllerLimitSAM, int)
+SIM_REGISTER_CHAN(PIControllerTargetPosition, DSCS_Axis, int)
+SIM_GET_CHAN(PIControllerNFOOutput, DSCS_Axis, int)
+SIM_GET_CHAN(PIControllerSAMOutput, DSCS_Axis, int)
+
+SIM_REGISTER(NFOSlewRateLimit, int)
+SIM_REGISTER(SAMSlewRateLimit, int)
+
+SIM_GET_CHAN(InputTransformationResult, DSCS_Axis, int)
+SIM_GET(InputTransformationAverage, int)
+
+SIM_REGISTER(TrajectoryLineStartX, int)
+SIM_REGISTER(TrajectoryLineEndX, int)
+SIM_REGISTER(TrajectoryLineSpeedX, int)
+SIM_REGISTER(TrajectoryLineStartY, int)
+SIM_REGISTER(TrajectoryLineDistY, int)
+SIM_REGISTER(TrajectoryLineCountY, unsigned short)
+SIM_REGISTER(TrajectoryTurnTime, unsigned int)
+SIM_REGISTER(TrajectoryPosTime, unsigned int)
+SIM_REGISTER(TrajectoryAntiHyst, int)
+SIM_REGISTER(TrajectorySettings, unsigned int)
+
+int WINCC DSCS_resetSetpointModulationPhase(const unsigned int devNo)
+{
+    return simCall(devNo, true);
+}
+
+int WINCC DSCS_getPIControllerTargetMode(const unsigned int devNo, DSCS_TargetMode *mode)
+{
+    int value = 0, code = simGet(devNo, "PIControllerTargetMode", 0, &value);
+    *mode = (DSCS_TargetMode)value;
+    return code;
+}
+
+int WINCC DSCS_setPIControllerTargetMode(const unsigned int devNo, const DSCS_TargetMode mode)
+{
+    return simSet(devNo, "PIControllerTargetMode", 0, (int)mode);
+}
+
+int WINCC DSCS_resetPIController(const unsigned int devNo)
+{
+    return simCall(devNo, true);
+}
+
+// The limit pairs and the transformation state are not live readbacks, so
+// they read 0 until set; a limiter or transformation fault never shows
+static int simGetPair(unsigned int devNo, const char *name, int *min, int *max)
+{
+    double first = 0, second = 0;
+    int code;
+    dscsSimDevice *device = simBegin(devNo, false, &code);
+    if (!device) return code;
+
+    if (device->registers.count(simKey(name, 0))) first = device->registers[simKey(name, 0)];
+    if (device->registers.count(simKey(name, 1))) second = device->registers[simKey(name, 1)];
+    epicsMutexUnlock(device->lock);
+    *min = (int)first;
+    *max = (int)second;
+    return DSCS_Ok;
+}
+
+static int simSetPair(unsigned int devNo, const char *name, int min, int max)
+{
+    int code;
+    dscsSimDevice *device = simBegin(devNo, true, &code);
+    if (!device) return code;
+
+    device->registers[simKey(name, 0)] = min;
+    device->registers[simKey(name, 1)] = max;
+    epicsMutexUnlock(device->lock);
+    return DSCS_Ok;
+}
+
+int WINCC DSCS_getNFOADCLimits(const unsigned int devNo, int *min, int *max)
+{
+    return simGetPair(devNo, "NFOADCLimits", min, max);
+}
+
+int WINCC DSCS_setNFOADCLimits(const unsigned int devNo, const int min, const int max)
+{
+    return simSetPair(devNo, "NFOADCLimits", min, max);
+}
+
+int WINCC DSCS_getSAMADCLimits(const unsigned int devNo, int *min, int *max)
+{
+    return simGetPair(devNo, "SAMADCLimits", min, max);
+}
+
+int WINCC DSCS_setSAMADCLimits(const unsigned int devNo, const int min, const int max)
+{
+    return simSetPair(devNo, "SAMADCLimits", min, max);
+}
+
+int WINCC DSCS_getLimiterState(const unsigned int devNo, DSCS_LimiterState *state)
+{
+    *state = (DSCS_LimiterState)0;
+    return simCall(devNo, false);
+}
+
+int WINCC DSCS_getInputTransformationState(const unsigned int devNo, DSCS_InputTransformationState *state)
+{
+    *state = (DSCS_InputTransformationState)0;
+    return simCall(devNo, false);
+}
+
+int WINCC DSCS_setInputTransformationMatrix(const unsigned int devNo, const int row, const int column,
+                                            const int coeff1, const int coeff2, const int coeff3)
+{
+    return simCall(devNo, true);
+}
+
+int WINCC DSCS_setOutputTransformationMatrix(const unsigned int devNo, const int row, const int column,
+                                             const int coeff1, const int coeff2, const int coeff3)
+{
+    return simCall(devNo, true);
+}
+
+int WINCC DSCS_getOutputTransformationResult(const unsigned int devNo, const DSCS_Axis axis, int *nfo, int *sam)
+{
+    int code = simGet(devNo, "OutputTransformationResultNFO", axis, nfo);
+    if (code == DSCS_Ok) code = simGet(devNo, "OutputTransformationResultSAM", axis, sam);
+    return code;
+}
+
+int WINCC DSCS_startTrajectory(const unsigned int devNo)
+{
+    return simCall(devNo, true);
+}
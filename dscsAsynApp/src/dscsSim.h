@@ -0,0 +1,29 @@
+/*
+ * Simulated DSCS controller
+ *
+ * dscsSim.cpp implements the vendor API of dscs.h without hardware, so the
+ * driver can be linked and exercised on any host, see dscsAsynBench.cpp.
+ * Every device is a set of registers: a set call stores its value, a get
+ * call returns what was stored, or a value that changes with every call
+ * for registers that were never set, like the live readbacks. Each call
+ * holds the device for the configured latency, as the USB link does.
+ */
+
+#ifndef DSCS_SIM_H
+#define DSCS_SIM_H
+
+#include <epicsTypes.h>
+
+#define DSCS_SIM_MAX_DEVICES 64
+
+// Devices get ids 1..devices; latency and jitter in s per vendor call
+void dscsSimConfigure(int devices, double latency, double jitter);
+
+struct dscsSimStats {
+    unsigned long calls;     // vendor calls of the device
+    unsigned long sets;      // of which set calls
+    epicsUInt64 lastSet;     // monotonic ns the last set call completed
+};
+void dscsSimGetStats(unsigned int devNo, dscsSimStats *stats);
+
+#endif /* DSCS_SIM_H */
@@ -0,0 +1,71 @@
+/*
+ * dscsStepResponse
+ *
+ * See dscsStepResponse.h
+ */
+
+#include <math.h>
+
+#include "dscsStepResponse.h"
+
+static bool fail(std::string &error, const char *message)
+{
+    error = message;
+    return false;
+}
+
+// Time the normalised response first reaches level, interpolated between
+// samples; NaN if it never does
+static double crossing(const std::vector<double> &time, const std::vector<double> &y,
+                       size_t first, double level)
+{
+    for (size_t i = first; i < y.size(); ++i) {
+        if (y[i] < level) continue;
+        if (i == first || y[i] == y[i - 1]) return time[i];
+        return time[i - 1] + (time[i] - time[i - 1]) * (level - y[i - 1]) / (y[i] - y[i - 1]);
+    }
+    return NAN;
+}
+
+bool dscsAnalyzeStep(const std::vector<double> &time, const std::vector<double> &value,
+                     double target, double band, dscsStepMetrics &metrics, std::string &error)
+{
+    size_t n = time.size() < value.size() ? time.size() : value.size();
+    size_t step = 0;
+    double sum = 0;
+
+    while (step < n && time[step] < 0) sum += value[step++];
+    if (step == 0) return fail(error, "no samples before the step");
+    if (n - step < 2) return fail(error, "no response after the step");
+    metrics.initial = sum / step;
+
+    double size = target - metrics.initial;
+    if (fabs(size) < 1e-9) return fail(error, "step is zero");
+
+    size_t tail = (size_t)((n - step) * DSCS_STEP_FINAL);
+    if (tail < 1) tail = 1;
+    sum = 0;
+    for (size_t i = n - tail; i < n; ++i) sum += value[i];
+    metrics.final = sum / tail;
+    metrics.steadyStateError = target - metrics.final;
+
+    // normalised so the response runs from 0 to 1 whatever the step direction
+    std::vector<double> y(n);
+    double peak = 0;
+    for (size_t i = 0; i < n; ++i) {
+        y[i] = (value[i] - metrics.initial) / size;
+        if (i >= step && y[i] > peak) peak = y[i];
+    }
+
+    metrics.riseTime = crossing(time, y, step, DSCS_STEP_RISE_HIGH) - crossing(time, y, step, DSCS_STEP_RISE_LOW);
+    metrics.overshoot = peak > 1 ? (peak - 1) * 100 : 0;
+
+    // settled from the sample after the last one outside the band
+    metrics.settlingTime = 0;
+    for (size_t i = n; i-- > step; ) {
+        if (fabs(y[i] - 1) <= band) continue;
+        metrics.settlingTime = i + 1 < n ? time[i + 1] : NAN;
+        break;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+/*
+ * Step response metrics for PI tuning
+ *
+ * A captured response is a list of samples, time in s relative to the step
+ * (negative before it) and the controlled value in the units of the target.
+ * The samples before the step give the starting level; the metrics are
+ * taken against the target:
+ *
+ *   rise time         10 % to 90 % of the step, first crossings
+ *   overshoot         peak beyond the target, % of the step
+ *   settling time     from the step until the value stays within the band
+ *   steady-state err  target minus the mean of the last 10 % of the samples
+ *
+ * Times that were never reached are NaN.
+ */
+
+#ifndef DSCS_STEP_RESPONSE_H
+#define DSCS_STEP_RESPONSE_H
+
+#include <string>
+#include <vector>
+
+#define DSCS_STEP_RISE_LOW   0.1   // fractions of the step the rise time is taken between
+#define DSCS_STEP_RISE_HIGH  0.9
+#define DSCS_STEP_FINAL      0.1   // fraction of the response averaged for the final value
+
+struct dscsStepMetrics {
+    double initial;            // mean before the step
+    double final;              // mean of the end of the response
+    double riseTime;           // s
+    double overshoot;          // % of the step
+    double settlingTime;       // s
+    double steadyStateError;   // target units
+};
+
+// band is the settling band as a fraction of the step; false with a reason
+// in error if the capture can't be evaluated
+bool dscsAnalyzeStep(const std::vector<double> &time, const std::vector<double> &value,
+                     double target, double band, dscsStepMetrics &metrics, std::string &error);
+
+#endif /* DSCS_STEP_RESPONSE_H */
@@ -0,0 +1,63 @@
+/*
+ * dscsStreamChannel
+ *
+ * A packet only says which samples it carries, not when they were taken, and
+ * its arrival time includes USB and scheduling jitter. The channel fits its
+ * clock model to arrival time against sample index and stamps the samples
+ * from the fit.
+ */
+
+#include "dscsStream.h"
+
+dscsStreamChannel::dscsStreamChannel()
+  : expectedIndex_(0), timestamp_(-1), nextSample_(0), lost_(0), packets_(0)
+{
+    epoch_.secPastEpoch = 0;
+    epoch_.nsec = 0;
+}
+
+void dscsStreamChannel::stamp(const dscsStreamPacket &packet, std::vector<epicsFloat64> &times,
+                              epicsTimeStamp *first)
+{
+    epicsInt32 skipped;
+    epicsUInt64 firstSample;
+    double arrivalTime, start, period, epochTime;
+
+    // Unwrap the 32 bit index. A step backwards means the device restarted
+    // its counter, and the clock model starts over with it.
+    skipped = (epicsInt32)(packet.index - expectedIndex_);
+    if (timestamp_ < 0 || skipped < 0) {
+        clock_.reset();
+        epoch_ = packet.arrival;
+        timestamp_ = -1;
+        nextSample_ = 0;
+        skipped = 0;
+    }
+    lost_ += skipped;
+    packets_++;
+    firstSample = nextSample_ + skipped;
+    nextSample_ = firstSample + packet.nSamples;
+    expectedIndex_ = packet.index + packet.nSamples;
+
+    // a packet can only be sent after its last sample was taken
+    arrivalTime = epicsTimeDiffInSeconds(&packet.arrival, &epoch_);
+    clock_.update((double)(nextSample_ - 1), arrivalTime);
+    period = clock_.period();
+    start = clock_.valid() ? clock_.timeOf((double)firstSample) : arrivalTime;
+    // the fit moves a little with every packet; never step back in time
+    if (timestamp_ >= 0 && start <= timestamp_) start = timestamp_ + period;
+    timestamp_ = start + period * (packet.nSamples - 1);
+
+    epochTime = epoch_.secPastEpoch + epoch_.nsec / 1e9;
+    times.resize(packet.nSamples);
+    for (int i = 0; i < packet.nSamples; ++i) times[i] = epochTime + start + period * i;
+
+    *first = epoch_;
+    epicsTimeAddSeconds(first, start);
+}
+
+double dscsStreamChannel::rate() const
+{
+    double period = clock_.period();
+    return period > 0 ? 1.0 / period : 0;
+}
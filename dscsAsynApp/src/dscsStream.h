@@ -0,0 +1,218 @@
+/*
+ * Streaming infrastructure shared by dscsAsyn and qudisAsyn
+ *
+ * Vendor libraries deliver stream data on their own threads. The producer
+ * side of a stream only copies each packet into a dscsStreamQueue, which is
+ * a pair of lock-free single-producer/single-consumer rings, and never takes
+ * the port lock. A driver thread drains the queues, places every packet on
+ * its channel's sample clock (dscsStreamChannel) and publishes it.
+ *
+ * One queue has exactly one producer and one consumer thread.
+ */
+
+#ifndef DSCS_STREAM_H
+#define DSCS_STREAM_H
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include "dscsClockModel.h"
+
+/*
+ * Fixed size ring of T. Capacity is rounded up to a power of two. push() is
+ * only called by the producer and pop() only by the consumer; both are all or
+ * nothing.
+ */
+template <typename T>
+class dscsRing {
+public:
+    explicit dscsRing(size_t capacity)
+      : head_(0), tail_(0)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        buf_.resize(size);
+        mask_ = size - 1;
+    }
+
+    size_t capacity() const { return buf_.size(); }
+
+    size_t size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    size_t space() const { return capacity() - size(); }
+
+    bool push(const T *values, size_t n)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (capacity() - (head - tail_.load(std::memory_order_acquire)) < n) return false;
+        for (size_t i = 0; i < n; ++i) buf_[(head + i) & mask_] = values[i];
+        head_.store(head + n, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T *values, size_t n)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) - tail < n) return false;
+        for (size_t i = 0; i < n; ++i) values[i] = buf_[(tail + i) & mask_];
+        tail_.store(tail + n, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> buf_;
+    size_t mask_;
+    std::atomic<size_t> head_; // written by the producer only
+    std::atomic<size_t> tail_; // written by the consumer only
+};
+
+/*
+ * What the producer knows about a packet when it arrives
+ */
+struct dscsStreamPacket {
+    int channel;
+    epicsUInt32 index;       // vendor sequence number of the first sample
+    int nSamples;
+    int width;               // values per sample
+    epicsTimeStamp arrival;  // host time the packet was received
+};
+
+/*
+ * Queue of variable length packets: headers in one ring, values in another.
+ * The values are pushed before their header, so a consumer that sees a header
+ * always finds the values behind it. A packet that does not fit is dropped
+ * whole and counted. The header type P needs nSamples and width.
+ */
+template <typename T, typename P = dscsStreamPacket>
+class dscsStreamQueue {
+public:
+    dscsStreamQueue(size_t packets, size_t values)
+      : packets_(packets), values_(values), overflows_(0)
+    {
+    }
+
+    bool push(const P &packet, const T *values)
+    {
+        size_t n = (size_t)packet.nSamples * packet.width;
+        if (packets_.space() < 1 || values_.space() < n) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        values_.push(values, n);
+        packets_.push(&packet, 1);
+        return true;
+    }
+
+    bool pop(P &packet, std::vector<T> &values)
+    {
+        if (!packets_.pop(&packet, 1)) return false;
+        values.resize((size_t)packet.nSamples * packet.width);
+        values_.pop(values.data(), values.size());
+        return true;
+    }
+
+    // Whether a packet of n values would fit now; producer only
+    bool fits(size_t n) const { return packets_.space() >= 1 && values_.space() >= n; }
+
+    // Whether every pushed packet has been popped
+    bool empty() const { return packets_.size() == 0; }
+
+    // Packets dropped because the consumer fell behind
+    unsigned long overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    dscsRing<P> packets_;
+    dscsRing<T> values_;
+    std::atomic<unsigned long> overflows_;
+};
+
+/*
+ * The most recent samples of a stream and their acquisition times; the
+ * oldest are overwritten first. Only used by the consumer thread.
+ */
+template <typename T>
+class dscsStreamHistory {
+public:
+    dscsStreamHistory(size_t samples, int width)
+      : values_(samples * width), times_(samples), width_(width), next_(0), count_(0)
+    {
+    }
+
+    int width() const { return width_; }
+    size_t size() const { return count_; }
+    void clear() { next_ = 0; count_ = 0; }
+
+    void add(const T *values, const epicsFloat64 *times, size_t nSamples)
+    {
+        size_t capacity = times_.size();
+        for (size_t i = 0; i < nSamples; ++i) {
+            for (int k = 0; k < width_; ++k) values_[next_ * width_ + k] = values[i * width_ + k];
+            times_[next_] = times[i];
+            next_ = (next_ + 1) % capacity;
+            if (count_ < capacity) count_++;
+        }
+    }
+
+    // Copy out the held samples, oldest first
+    void copy(std::vector<T> &values, std::vector<epicsFloat64> &times) const
+    {
+        size_t capacity = times_.size();
+        size_t first = (next_ + capacity - count_) % capacity;
+        values.resize(count_ * width_);
+        times.resize(count_);
+        for (size_t i = 0; i < count_; ++i) {
+            size_t j = (first + i) % capacity;
+            for (int k = 0; k < width_; ++k) values[i * width_ + k] = values_[j * width_ + k];
+            times[i] = times_[j];
+        }
+    }
+
+private:
+    std::vector<T> values_;
+    std::vector<epicsFloat64> times_;
+    int width_;
+    size_t next_;   // slot the next sample goes to
+    size_t count_;
+};
+
+/*
+ * Consumer side state of one stream channel: unwraps the vendor's 32 bit
+ * sample index, counts lost samples and fits the sample clock (see
+ * dscsClockModel.h). Only used by the consumer thread.
+ */
+class dscsStreamChannel {
+public:
+    dscsStreamChannel();
+
+    // Start over with the next packet, e.g. after the stream was re-enabled
+    void restart() { timestamp_ = -1; }
+
+    // Place a packet on the sample clock. Fills the acquisition time of every
+    // sample in s past the EPICS epoch and returns that of the first sample.
+    void stamp(const dscsStreamPacket &packet, std::vector<epicsFloat64> &times,
+               epicsTimeStamp *first);
+
+    double rate() const;                           // estimated sample rate, Hz
+    double residual() const { return clock_.residual(); }
+    epicsUInt64 lost() const { return lost_; }     // samples skipped in the index sequence
+    epicsUInt64 packets() const { return packets_; }
+    epicsUInt64 samples() const { return nextSample_; } // unwrapped index of the next sample
+
+private:
+    epicsUInt32 expectedIndex_;  // raw index of the next packet's first sample
+    double timestamp_;           // acquisition time of the last sample, s after epoch_; -1 = restart
+    epicsTimeStamp epoch_;       // time origin of clock_
+    epicsUInt64 nextSample_;     // expectedIndex_ unwrapped
+    epicsUInt64 lost_;
+    epicsUInt64 packets_;
+    dscsClockModel clock_;
+};
+
+#endif /* DSCS_STREAM_H */
@@ -0,0 +1,330 @@
+/*
+ * dscsStreamBench
+ *
+ * Throughput benchmark of the stream path. A producer thread plays the
+ * vendor callback: it pushes synthetic packets of DSCS_TUPLE_SIZE tuples
+ * into a dscsStreamQueue at a set sample rate. A consumer thread plays the
+ * stream thread: it drains the queue, places each packet on the sample
+ * clock (dscsStreamChannel) and hands it to one consumer stage. For every
+ * stage the rate is raised step by step until the pipeline saturates.
+ *
+ *   dscsStreamBench [-s stage]... [-r rate] [-R max_rate] [-m factor]
+ *                   [-p packet] [-t seconds] [-f capture_file]
+ *
+ *   -s  stage to measure, repeatable; all if none:
+ *         publish          copy into the STREAM_DATA/STREAM_TIME buffers
+ *         history          interlock snapshot history
+ *         capture-raw      capture writer, one stage per codec
+ *         capture-varint
+ *         capture-bitpack
+ *   -r  first rate, samples/s (10000)
+ *   -R  last rate (10000000)
+ *   -m  rate step factor (2)
+ *   -p  tuples per packet (1000)
+ *   -t  s per rate (5)
+ *   -f  file the capture stages write to (dscsStreamBench.cap, removed after)
+ *
+ * One line per stage and rate, space separated, on stdout. Latencies are
+ * per packet: queue is arrival to pop, clock is the stamping, stage the
+ * consumer. CPU is the thread CPU time over the run time, NaN where the
+ * host cannot measure it. The capture stages write on the consumer thread
+ * here; in the driver they have a thread of their own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+#include "dscsStream.h"
+#include "dscsCapture.h"
+
+// as in dscsAsyn.h
+#define DSCS_TUPLE_SIZE 23
+#define DSCS_STREAM_QUEUE_PACKETS 1024
+#define DSCS_STREAM_QUEUE_VALUES (1 << 20)
+#define DSCS_INTERLOCK_HISTORY 4096
+
+#define BENCH_POOL_PACKETS 64   // synthetic packets, replayed in a loop
+#define BENCH_SATURATED 0.99    // sustained below this share of the offered rate ends a ramp
+
+typedef enum {
+    benchPublish,
+    benchHistory,
+    benchCaptureRaw,
+    benchCaptureVarint,
+    benchCaptureBitpack,
+    BENCH_NUM_STAGES
+} benchStage;
+
+static const char *stageNames[BENCH_NUM_STAGES] = {
+    "publish", "history", "capture-raw", "capture-varint", "capture-bitpack"
+};
+
+struct benchRun {
+    int stage;
+    double rate;             // samples/s offered
+    int packet;              // tuples per packet
+    double seconds;
+    const char *file;
+
+    dscsStreamQueue<epicsInt32> *queue;
+    std::vector<epicsInt32> pool;
+    epicsEventId ready;      // a packet was queued
+    epicsEventId produced;   // the producer is done
+    epicsEventId consumed;   // the consumer is done
+    std::atomic<bool> producing;
+
+    // results
+    epicsUInt64 producedSamples;
+    epicsUInt64 consumedSamples;
+    double elapsed;          // s from the first push to the last packet consumed
+    double producerCpu;      // s
+    double consumerCpu;
+    std::vector<double> queueLatency;  // us
+    std::vector<double> clockLatency;
+    std::vector<double> stageLatency;
+    std::string error;
+};
+
+static double threadCpu()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+    return NAN;
+}
+
+static double percentile(std::vector<double> &values, double p)
+{
+    if (values.empty()) return NAN;
+    size_t i = (size_t)(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+// A random walk per column, so the capture codecs see correlated data
+static void fillPool(std::vector<epicsInt32> &pool, int packet)
+{
+    epicsUInt32 seed = 12345;
+    epicsInt32 walk[DSCS_TUPLE_SIZE] = {};
+
+    pool.resize((size_t)BENCH_POOL_PACKETS * packet * DSCS_TUPLE_SIZE);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        int k = i % DSCS_TUPLE_SIZE;
+        seed = seed * 1664525u + 1013904223u;
+        walk[k] += (epicsInt32)(seed >> 24) - 128;
+        pool[i] = walk[k];
+    }
+}
+
+static void producerThread(void *pPvt)
+{
+    benchRun &run = *(benchRun *)pPvt;
+    double cpu = threadCpu();
+    epicsUInt64 start = epicsMonotonicGet(), sent = 0;
+    dscsStreamPacket packet;
+
+    packet.channel = 0;
+    packet.nSamples = run.packet;
+    packet.width = DSCS_TUPLE_SIZE;
+
+    // burst out whatever is due every ms, like a USB host controller
+    while (1) {
+        double elapsed = (epicsMonotonicGet() - start) / 1e9;
+        epicsUInt64 due = (epicsUInt64)(std::min(elapsed, run.seconds) * run.rate / run.packet);
+
+        for (; sent < due; ++sent) {
+            packet.index = (epicsUInt32)(sent * run.packet);
+            epicsTimeGetCurrent(&packet.arrival);
+            run.queue->push(packet, &run.pool[(sent % BENCH_POOL_PACKETS) * run.packet * DSCS_TUPLE_SIZE]);
+            epicsEventSignal(run.ready);
+        }
+        if (elapsed >= run.seconds) break;
+        epicsThreadSleep(0.001);
+    }
+
+    run.producedSamples = sent * run.packet;
+    run.producerCpu = threadCpu() - cpu;
+    run.producing = false;
+    epicsEventSignal(run.ready);
+    epicsEventSignal(run.produced);
+}
+
+static void consumerThread(void *pPvt)
+{
+    benchRun &run = *(benchRun *)pPvt;
+    double cpu = threadCpu();
+    epicsUInt64 start = epicsMonotonicGet(), t0, t1, t2;
+    dscsStreamChannel channel;
+    dscsStreamHistory<epicsInt32> history(DSCS_INTERLOCK_HISTORY, DSCS_TUPLE_SIZE);
+    dscsCaptureWriter writer;
+    dscsStreamPacket packet;
+    std::vector<epicsInt32> values, publishData;
+    std::vector<epicsFloat64> times, publishTime;
+    epicsTimeStamp now, first;
+
+    run.consumedSamples = 0;
+    if (run.stage >= benchCaptureRaw &&
+        !writer.open(run.file, DSCS_TUPLE_SIZE, (dscsCaptureCodec)(run.stage - benchCaptureRaw), run.error)) {
+        run.producing = false;
+    }
+
+    while (run.error.empty()) {
+        epicsEventWaitWithTimeout(run.ready, 0.01);
+        bool last = !run.producing;
+
+        while (run.queue->pop(packet, values)) {
+            epicsTimeGetCurrent(&now);
+            t0 = epicsMonotonicGet();
+            run.queueLatency.push_back(epicsTimeDiffInSeconds(&now, &packet.arrival) * 1e6);
+
+            channel.stamp(packet, times, &first);
+            t1 = epicsMonotonicGet();
+
+            switch (run.stage) {
+            case benchPublish:
+                publishData.assign(values.begin(), values.end());
+                publishTime.assign(times.begin(), times.end());
+                break;
+            case benchHistory:
+                history.add(values.data(), times.data(), packet.nSamples);
+                break;
+            default:
+                writer.add(channel.samples() - packet.nSamples, times[0],
+                           packet.nSamples > 1 ? (times[packet.nSamples - 1] - times[0]) / (packet.nSamples - 1) : 0,
+                           values.data(), packet.nSamples, run.error);
+                break;
+            }
+            t2 = epicsMonotonicGet();
+
+            run.clockLatency.push_back((t1 - t0) / 1e3);
+            run.stageLatency.push_back((t2 - t1) / 1e3);
+            run.consumedSamples += packet.nSamples;
+        }
+        if (last) break;
+    }
+
+    if (writer.isOpen()) writer.close(run.error);
+    run.elapsed = (epicsMonotonicGet() - start) / 1e9;
+    run.consumerCpu = threadCpu() - cpu;
+    epicsEventSignal(run.consumed);
+}
+
+// Returns false once the pipeline no longer keeps up
+static bool measure(int stage, double rate, int packet, double seconds, const char *file)
+{
+    benchRun run;
+    double sustained;
+    unsigned long dropped;
+
+    run.stage = stage;
+    run.rate = rate;
+    run.packet = packet;
+    run.seconds = seconds;
+    run.file = file;
+    run.queue = new dscsStreamQueue<epicsInt32>(DSCS_STREAM_QUEUE_PACKETS, DSCS_STREAM_QUEUE_VALUES);
+    run.ready = epicsEventMustCreate(epicsEventEmpty);
+    run.produced = epicsEventMustCreate(epicsEventEmpty);
+    run.consumed = epicsEventMustCreate(epicsEventEmpty);
+    run.producing = true;
+    run.producedSamples = run.consumedSamples = 0;
+    fillPool(run.pool, packet);
+
+    epicsThreadCreate("benchConsumer", epicsThreadPriorityMedium,
+                      epicsThreadGetStackSize(epicsThreadStackMedium), consumerThread, &run);
+    epicsThreadCreate("benchProducer", epicsThreadPriorityHigh,
+                      epicsThreadGetStackSize(epicsThreadStackMedium), producerThread, &run);
+    epicsEventWait(run.produced);
+    epicsEventWait(run.consumed);
+
+    dropped = run.queue->overflows();
+    sustained = run.elapsed > 0 ? run.consumedSamples / run.elapsed : 0;
+    printf("%s %.0f %.0f %lu %.1f %.1f %.1f %.1f %.1f %.1f %.1f %.1f %.3f %.3f\n",
+           stageNames[stage], rate, sustained, dropped,
+           percentile(run.queueLatency, 0.5), percentile(run.queueLatency, 0.99), percentile(run.queueLatency, 1),
+           percentile(run.clockLatency, 0.5), percentile(run.clockLatency, 0.99),
+           percentile(run.stageLatency, 0.5), percentile(run.stageLatency, 0.99), percentile(run.stageLatency, 1),
+           run.consumerCpu / run.elapsed, run.producerCpu / run.elapsed);
+    fflush(stdout);
+    if (!run.error.empty()) fprintf(stderr, "%s: %s\n", stageNames[stage], run.error.c_str());
+
+    delete run.queue;
+    epicsEventDestroy(run.ready);
+    epicsEventDestroy(run.produced);
+    epicsEventDestroy(run.consumed);
+    return run.error.empty() && dropped == 0 && sustained >= BENCH_SATURATED * rate;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-s stage]... [-r rate] [-R max_rate] [-m factor] [-p packet] [-t seconds] [-f file]\n",
+            name);
+    fprintf(stderr, "stages:");
+    for (int s = 0; s < BENCH_NUM_STAGES; ++s) fprintf(stderr, " %s", stageNames[s]);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+    bool stages[BENCH_NUM_STAGES] = {}, anyStage = false;
+    double rate = 1e4, maxRate = 1e7, factor = 2, seconds = 5;
+    int packet = 1000;
+    const char *file = "dscsStreamBench.cap";
+
+    for (int i = 1; i < argc; i += 2) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        int s;
+
+        if (!value || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+            usage(argv[0]);
+            return 1;
+        }
+        switch (argv[i][1]) {
+        case 's':
+            for (s = 0; s < BENCH_NUM_STAGES && strcmp(value, stageNames[s]) != 0; ++s) {}
+            if (s == BENCH_NUM_STAGES) {
+                usage(argv[0]);
+                return 1;
+            }
+            stages[s] = anyStage = true;
+            break;
+        case 'r': rate = atof(value); break;
+        case 'R': maxRate = atof(value); break;
+        case 'm': factor = atof(value); break;
+        case 'p': packet = atoi(value); break;
+        case 't': seconds = atof(value); break;
+        case 'f': file = value; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!(rate > 0) || !(factor > 1) || !(seconds > 0) || packet <= 0 ||
+        (size_t)packet * DSCS_TUPLE_SIZE > DSCS_STREAM_QUEUE_VALUES) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("# stage rate_hz sustained_hz dropped_packets"
+           " queue_p50_us queue_p99_us queue_max_us clock_p50_us clock_p99_us"
+           " stage_p50_us stage_p99_us stage_max_us consumer_cpu producer_cpu\n");
+    for (int s = 0; s < BENCH_NUM_STAGES; ++s) {
+        if (anyStage && !stages[s]) continue;
+        for (double r = rate; r <= maxRate * (1 + 1e-9); r *= factor) {
+            if (!measure(s, r, packet, seconds, file)) break;
+        }
+    }
+    remove(file);
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * dscsStreamMerge
+ *
+ * See dscsStreamMerge.h
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <map>
+
+#include <epicsGuard.h>
+
+#include "dscsStreamMerge.h"
+
+typedef epicsGuard<epicsMutex> dscsMergeGuard;
+
+// Merges never go away once created, so the registry hands out plain pointers
+static std::map<std::string, dscsStreamMerge *> mergeRegistry;
+static epicsMutex mergeRegistryLock;
+
+static std::string sourceName(const char *port, const char *channel)
+{
+    return std::string(port) + ":" + channel;
+}
+
+dscsStreamMerge *dscsStreamMerge::create(const char *port, const char *channel, int width)
+{
+    dscsMergeGuard guard(mergeRegistryLock);
+    std::string name = sourceName(port, channel);
+    dscsStreamMerge *&merge = mergeRegistry[name];
+
+    if (!merge) merge = new dscsStreamMerge(name.c_str(), width);
+    return merge->width() == width ? merge : NULL;
+}
+
+dscsStreamMerge *dscsStreamMerge::find(const char *port, const char *channel)
+{
+    dscsMergeGuard guard(mergeRegistryLock);
+    std::map<std::string, dscsStreamMerge *>::const_iterator it = mergeRegistry.find(sourceName(port, channel));
+
+    return it == mergeRegistry.end() ? NULL : it->second;
+}
+
+dscsStreamMerge::dscsStreamMerge(const char *source, int width, double maxDelay)
+  : source_(source), width_(width), maxDelay_(maxDelay), secPeriod_(0)
+{
+}
+
+void dscsStreamMerge::addSecondary(const epicsFloat64 *times, const double *values, int nSamples)
+{
+    dscsMergeGuard guard(lock_);
+
+    for (int i = 0; i < nSamples; ++i) {
+        // a restarted secondary clock can step back; start the history over
+        if (!secTimes_.empty() && times[i] <= secTimes_.back()) {
+            if (times[i] < secTimes_.back()) {
+                secTimes_.clear();
+                secValues_.clear();
+            }
+            else continue;
+        }
+        if (!secTimes_.empty()) {
+            double spacing = times[i] - secTimes_.back();
+            secPeriod_ = secPeriod_ > 0 ? secPeriod_ + 0.01 * (spacing - secPeriod_) : spacing;
+        }
+        secTimes_.push_back(times[i]);
+        secValues_.insert(secValues_.end(), values + i * width_, values + (i + 1) * width_);
+    }
+
+    if (secTimes_.size() > DSCS_MERGE_HISTORY) trimSecondary(secTimes_[secTimes_.size() - DSCS_MERGE_HISTORY]);
+}
+
+void dscsStreamMerge::addPrimary(std::vector<epicsInt32> &data, std::vector<epicsFloat64> &times,
+                                 const epicsTimeStamp &stamp, epicsUInt64 firstSample)
+{
+    dscsMergeGuard guard(lock_);
+
+    pending_.push_back(pending());
+    pending &p = pending_.back();
+    p.data.swap(data);
+    p.times.swap(times);
+    p.stamp = stamp;
+    p.firstSample = firstSample;
+    p.received = epicsMonotonicGet();
+}
+
+bool dscsStreamMerge::takeReady(dscsMergedPacket &out)
+{
+    dscsMergeGuard guard(lock_);
+
+    if (pending_.empty()) return false;
+
+    pending &p = pending_.front();
+    bool covered = !p.times.empty() && !secTimes_.empty() && secTimes_.back() >= p.times.back();
+    bool expired = (epicsMonotonicGet() - p.received) / 1e9 >= maxDelay_;
+    if (!covered && !expired) return false;
+
+    out.data.swap(p.data);
+    out.stamp = p.stamp;
+    out.firstSample = p.firstSample;
+    interpolate(p.times, out);
+    out.times.swap(p.times);
+    pending_.pop_front();
+
+    // keep the secondary samples the next packet may still need
+    if (!out.times.empty()) trimSecondary(out.times.back());
+    return true;
+}
+
+void dscsStreamMerge::clear()
+{
+    dscsMergeGuard guard(lock_);
+
+    pending_.clear();
+    secTimes_.clear();
+    secValues_.clear();
+    secPeriod_ = 0;
+}
+
+/*
+ * Linear interpolation of the secondary samples at each primary time. Both
+ * sequences are ascending, so one forward pass finds every bracket. Called
+ * with lock_ held.
+ */
+void dscsStreamMerge::interpolate(const std::vector<epicsFloat64> &times, dscsMergedPacket &out)
+{
+    size_t n = times.size(), j = 0;
+    double maxGap = secPeriod_ * DSCS_MERGE_MAX_GAP;
+
+    out.values.assign(n * width_, NAN);
+    out.aligned = 0;
+    if (secTimes_.size() < 2) return;
+
+    // first secondary sample at or after the first primary time
+    j = std::lower_bound(secTimes_.begin(), secTimes_.end(), times.empty() ? 0 : times[0]) - secTimes_.begin();
+
+    for (size_t i = 0; i < n; ++i) {
+        double t = times[i];
+        while (j < secTimes_.size() && secTimes_[j] < t) ++j;
+        if (j == 0 || j == secTimes_.size()) continue;  // outside the secondary data
+
+        double t0 = secTimes_[j - 1], t1 = secTimes_[j];
+        if (t1 - t0 > maxGap) continue;                 // samples lost around t
+        double f = (t - t0) / (t1 - t0);
+
+        for (int k = 0; k < width_; ++k) {
+            double v0 = secValues_[(j - 1) * width_ + k];
+            double v1 = secValues_[j * width_ + k];
+            out.values[i * width_ + k] = v0 + f * (v1 - v0);
+        }
+        out.aligned++;
+    }
+}
+
+/*
+ * Forget secondary samples before keepFrom, keeping the one that brackets it.
+ * Called with lock_ held.
+ */
+void dscsStreamMerge::trimSecondary(double keepFrom)
+{
+    size_t drop = 0;
+
+    while (drop + 1 < secTimes_.size() && secTimes_[drop + 1] <= keepFrom) ++drop;
+    secTimes_.erase(secTimes_.begin(), secTimes_.begin() + drop);
+    secValues_.erase(secValues_.begin(), secValues_.begin() + drop * width_);
+}
@@ -0,0 +1,93 @@
+/*
+ * Merge stage for two streams on reconstructed timestamps
+ *
+ * The primary stream (DSCS tuples) sets the time base. The secondary stream
+ * (e.g. quDIS positions) is linearly interpolated to the acquisition time of
+ * every primary sample, so each merged record carries the primary tuple and
+ * the secondary values at the same instant.
+ *
+ * The two streams arrive with different latencies. A primary packet is held
+ * until secondary data covering its last sample has arrived, or until
+ * maxDelay has passed; samples that can't be bracketed get NaN.
+ *
+ * Merges are registered by secondary source name, "<port>:<channel>", so the
+ * secondary driver finds the merge that wants its data without linking
+ * against the primary driver. The primary and secondary sides run on
+ * different threads; the merge has its own lock.
+ */
+
+#ifndef DSCS_STREAM_MERGE_H
+#define DSCS_STREAM_MERGE_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <epicsTypes.h>
+#include <epicsTime.h>
+#include <epicsMutex.h>
+
+#define DSCS_MERGE_MAX_DELAY 0.5      // s a primary packet waits for secondary data
+#define DSCS_MERGE_HISTORY (1 << 18)  // secondary samples kept at most
+#define DSCS_MERGE_MAX_GAP 3.0        // bracketing samples further apart than this many periods are a gap
+
+/*
+ * One merged primary packet
+ */
+struct dscsMergedPacket {
+    std::vector<epicsInt32> data;       // primary tuples, as received
+    std::vector<epicsFloat64> times;    // acquisition time of each tuple, s past EPICS epoch
+    std::vector<epicsFloat64> values;   // secondary values at those times, width per tuple
+    epicsTimeStamp stamp;               // time of the first tuple
+    epicsUInt64 firstSample;            // unwrapped primary sample number of the first tuple
+    int aligned;                        // tuples that got secondary values
+};
+
+class dscsStreamMerge {
+public:
+    dscsStreamMerge(const char *source, int width, double maxDelay = DSCS_MERGE_MAX_DELAY);
+
+    // Registry, keyed by secondary source name
+    static dscsStreamMerge *create(const char *port, const char *channel, int width);
+    static dscsStreamMerge *find(const char *port, const char *channel);
+
+    const char *source() const { return source_.c_str(); }
+    int width() const { return width_; }
+
+    // Secondary side: append samples, width values each, times ascending
+    void addSecondary(const epicsFloat64 *times, const double *values, int nSamples);
+
+    // Primary side: hand over a stamped packet; the buffers are swapped out
+    void addPrimary(std::vector<epicsInt32> &data, std::vector<epicsFloat64> &times,
+                    const epicsTimeStamp &stamp, epicsUInt64 firstSample);
+
+    // Primary side: take the next packet that is ready to publish
+    bool takeReady(dscsMergedPacket &out);
+
+    // Drop all held data, e.g. when the primary stream restarts
+    void clear();
+
+private:
+    struct pending {
+        std::vector<epicsInt32> data;
+        std::vector<epicsFloat64> times;
+        epicsTimeStamp stamp;
+        epicsUInt64 firstSample;
+        epicsUInt64 received;   // monotonic ns
+    };
+
+    std::string source_;
+    int width_;
+    double maxDelay_;
+    epicsMutex lock_;
+
+    std::deque<pending> pending_;
+    std::deque<double> secTimes_;
+    std::deque<double> secValues_;   // width_ per sample
+    double secPeriod_;               // averaged secondary sample spacing, s
+
+    void interpolate(const std::vector<epicsFloat64> &times, dscsMergedPacket &out);
+    void trimSecondary(double keepFrom);
+};
+
+#endif /* DSCS_STREAM_MERGE_H */
@@ -0,0 +1,138 @@
+/*
+ * dscsThread
+ *
+ * See dscsThread.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <epicsString.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "dscsThread.h"
+
+static const char *moduleName = "dscsThread";
+
+#ifdef __linux__
+// CPU list such as "2", "2,3" or "4-7,9"; false if malformed or empty
+static bool parseCpus(const char *cpus, cpu_set_t *set)
+{
+    const char *p = cpus;
+    char *end;
+
+    CPU_ZERO(set);
+    while (*p) {
+        long first = strtol(p, &end, 10), last;
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return false;
+        last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first || last >= CPU_SETSIZE) return false;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) CPU_SET(cpu, set);
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+static void formatCpus(const cpu_set_t *set, char *buf, size_t n)
+{
+    size_t used = 0;
+
+    buf[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && used < n; ++cpu) {
+        if (!CPU_ISSET(cpu, set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) last++;
+        used += snprintf(buf + used, n - used, last > cpu ? "%s%d-%d" : "%s%d",
+                         used ? "," : "", cpu, last);
+        cpu = last;
+    }
+}
+#endif
+
+asynStatus dscsSetThreadOptions(epicsThreadId thread, const char *name, int priority, const char *cpus,
+                                const char *policy, asynUser *pasynUser, const char *portName)
+{
+    static const char *functionName = "dscsSetThreadOptions";
+    asynStatus status = asynSuccess;
+    bool fifo = policy && epicsStrCaseCmp(policy, "FIFO") == 0;
+    bool other = policy && epicsStrCaseCmp(policy, "OTHER") == 0;
+
+    if (priority > (int)epicsThreadPriorityMax || (policy && *policy && !fifo && !other)) {
+        asynPrint(pasynUser, ASYN_TRACE_ERROR,
+            "%s:%s, port %s, invalid priority %d or policy %s\n",
+            moduleName, functionName, portName, priority, policy ? policy : "");
+        return asynError;
+    }
+
+    if (priority >= 0) epicsThreadSetPriority(thread, priority);
+
+#ifdef __linux__
+    pthread_t tid = epicsThreadGetPosixThreadId(thread);
+    struct sched_param param;
+    int current, err;
+
+    // a new priority for a thread already on SCHED_FIFO keeps it there
+    if (!fifo && !other && priority >= 0 &&
+        pthread_getschedparam(tid, &current, &param) == 0 && current == SCHED_FIFO) fifo = true;
+    if (fifo || other) {
+        int min = sched_get_priority_min(SCHED_FIFO), max = sched_get_priority_max(SCHED_FIFO);
+        param.sched_priority = fifo ? min + (max - min) * (int)epicsThreadGetPriority(thread) / epicsThreadPriorityMax : 0;
+        if ((err = pthread_setschedparam(tid, fifo ? SCHED_FIFO : SCHED_OTHER, &param)) != 0) {
+            asynPrint(pasynUser, ASYN_TRACE_ERROR,
+                "%s:%s, port %s, cannot set the policy of thread %s: %s\n",
+                moduleName, functionName, portName, name, strerror(err));
+            status = asynError;
+        }
+    }
+    if (cpus && *cpus) {
+        cpu_set_t set;
+        if (!parseCpus(cpus, &set)) {
+            asynPrint(pasynUser, ASYN_TRACE_ERROR,
+                "%s:%s, port %s, invalid CPU list %s\n",
+                moduleName, functionName, portName, cpus);
+            status = asynError;
+        } else if ((err = pthread_setaffinity_np(tid, sizeof(set), &set)) != 0) {
+            asynPrint(pasynUser, ASYN_TRACE_ERROR,
+                "%s:%s, port %s, cannot set the CPUs of thread %s: %s\n",
+                moduleName, functionName, portName, name, strerror(err));
+            status = asynError;
+        }
+    }
+#else
+    if (fifo || (cpus && *cpus)) {
+        asynPrint(pasynUser, ASYN_TRACE_ERROR,
+            "%s:%s, port %s, policy and CPU affinity are not supported on this host\n",
+            moduleName, functionName, portName);
+        status = asynError;
+    }
+#endif
+    return status;
+}
+
+void dscsReportThread(FILE *fp, const char *name, epicsThreadId thread)
+{
+    fprintf(fp, "    %-12s %5u", name, epicsThreadGetPriority(thread));
+#ifdef __linux__
+    pthread_t tid = epicsThreadGetPosixThreadId(thread);
+    struct sched_param param;
+    cpu_set_t set;
+    int policy;
+    char cpus[256] = "?";
+
+    if (pthread_getaffinity_np(tid, sizeof(set), &set) == 0) formatCpus(&set, cpus, sizeof(cpus));
+    if (pthread_getschedparam(tid, &policy, &param) == 0) {
+        fprintf(fp, "  %-5s %3d  %s", policy == SCHED_FIFO ? "FIFO" : policy == SCHED_RR ? "RR" : "OTHER",
+            param.sched_priority, cpus);
+    }
+#endif
+    fprintf(fp, "\n");
+}
@@ -0,0 +1,31 @@
+/*
+ * Driver thread scheduling
+ *
+ * Priority, scheduling policy and CPU affinity of one driver thread, shared
+ * by the dscsAsynThread and qudisAsynThread shell commands. priority is on
+ * the EPICS scale, 0-99, or -1 to keep it; cpus a CPU list such as "2,3" or
+ * "4-7", policy FIFO or OTHER, either empty to keep the current setting.
+ *
+ * EPICS only applies thread priorities when the IOC runs with real-time
+ * scheduling, so on an ordinary host a priority alone changes nothing;
+ * FIFO moves the thread to SCHED_FIFO at that priority by itself, which
+ * needs CAP_SYS_NICE or an rtprio limit. FIFO and the affinity are Linux
+ * only.
+ */
+
+#ifndef DSCS_THREAD_H
+#define DSCS_THREAD_H
+
+#include <stdio.h>
+
+#include <epicsThread.h>
+#include <asynDriver.h>
+
+// Failures are reported through pasynUser as errors of the named port
+asynStatus dscsSetThreadOptions(epicsThreadId thread, const char *name, int priority, const char *cpus,
+                                const char *policy, asynUser *pasynUser, const char *portName);
+
+// One line of a report() thread table, priority, policy and CPUs
+void dscsReportThread(FILE *fp, const char *name, epicsThreadId thread);
+
+#endif /* DSCS_THREAD_H */
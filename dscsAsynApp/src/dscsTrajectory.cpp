@@ -0,0 +1,181 @@
+/*
+ * dscsTrajectory
+ *
+ * See dscsTrajectory.h
+ */
+
+#include <math.h>
+
+#include "dscsTrajectory.h"
+
+#define DSCS_TRAJ_MAX_COUNT 2147483647.0
+
+static bool fail(std::string &error, const char *message)
+{
+    error = message;
+    return false;
+}
+
+// Position in nm to register counts, false if out of range
+static bool toPosition(double nm, int *counts)
+{
+    double c = floor(nm / DSCS_TRAJ_POS_UNIT + 0.5);
+    if (fabs(c) > DSCS_TRAJ_MAX_COUNT) return false;
+    *counts = (int)c;
+    return true;
+}
+
+// Time in s to a divider of DSCS_TRAJ_TIME_BASE, false if out of range
+static bool toDivider(double s, unsigned int *divider)
+{
+    if (!(s > 0)) return false;
+    double d = floor(DSCS_TRAJ_TIME_BASE / s + 0.5);
+    if (d < 1 || d > 4294967295.0) return false;
+    *divider = (unsigned int)d;
+    return true;
+}
+
+bool dscsPlanTrajectory(const dscsScanRequest &request, dscsTrajectoryPlan &plan, std::string &error)
+{
+    if (!(request.pixel > 0)) return fail(error, "pixel size must be positive");
+    if (!(request.dwell > 0)) return fail(error, "dwell time must be positive");
+    if (!(request.width >= request.pixel)) return fail(error, "width must be at least one pixel");
+    if (!(request.height >= 0)) return fail(error, "height must not be negative");
+
+    plan.pixelsX = (int)floor(request.width / request.pixel + 0.5);
+    double lines = floor(request.height / request.pixel + 0.5) + 1;
+    if (lines > DSCS_TRAJ_MAX_LINES) return fail(error, "too many lines for TRAJ_COUNT_Y");
+    plan.countY = (unsigned int)lines;
+
+    if (!toPosition(request.startX, &plan.startX) ||
+        !toPosition(request.startX + plan.pixelsX * request.pixel, &plan.endX) ||
+        !toPosition(request.startY, &plan.startY) ||
+        !toPosition(request.pixel, &plan.distY))
+        return fail(error, "scan region outside the position range");
+    if (!toPosition((request.mode & dscsTrajAntiHyst) ? request.antiHyst : 0, &plan.antiHyst))
+        return fail(error, "anti-hysteresis overshoot out of range");
+
+    // one pixel per dwell; the speed register decides the dwell actually run
+    double speed = floor(request.pixel / request.dwell / DSCS_TRAJ_SPEED_UNIT + 0.5);
+    if (speed < 1) return fail(error, "dwell time too long, speed rounds to 0");
+    if (speed > DSCS_TRAJ_MAX_COUNT) return fail(error, "dwell time too short for TRAJ_SPEED_X");
+    plan.speedX = (int)speed;
+
+    if (!toDivider(request.turnTime, &plan.turnTime)) return fail(error, "turn time out of range");
+    if (!toDivider(request.posTime, &plan.posTime)) return fail(error, "positioning time out of range");
+    plan.settings = request.mode & (dscsTrajFWBW | dscsTrajAntiHyst | dscsTrajContinuous);
+
+    return dscsTrajectoryTiming(plan, error);
+}
+
+bool dscsTrajectoryTiming(dscsTrajectoryPlan &plan, std::string &error)
+{
+    if (plan.speedX <= 0 || plan.turnTime == 0 || plan.posTime == 0 || plan.countY == 0)
+        return fail(error, "trajectory registers not set");
+
+    double pixel = plan.distY * DSCS_TRAJ_POS_UNIT;
+    double velocity = plan.speedX * DSCS_TRAJ_SPEED_UNIT;
+    plan.dwell = fabs(pixel) / velocity;
+    plan.lineTime = fabs((double)plan.endX - plan.startX) * DSCS_TRAJ_POS_UNIT / velocity;
+    plan.pixelsX = pixel != 0 ? (int)floor(fabs(((double)plan.endX - plan.startX) / plan.distY) + 0.5) : 0;
+    plan.posDuration = DSCS_TRAJ_TIME_BASE / plan.posTime;
+
+    // Without FWBW every line but the last ends in a fly back to the line
+    // start; it is assumed to run at line speed.
+    double turn = DSCS_TRAJ_TIME_BASE / plan.turnTime;
+    plan.linePeriod = plan.lineTime + ((plan.settings & dscsTrajFWBW) ? turn : turn + plan.lineTime);
+    plan.duration = plan.posDuration + plan.countY * plan.linePeriod - (plan.linePeriod - plan.lineTime);
+    return true;
+}
+
+/*
+ * dscsTrajectoryProgress
+ */
+
+void dscsTrajectoryProgress::start(const dscsTrajectoryPlan &plan)
+{
+    plan_ = plan;
+    hysteresis_ = fabs((double)plan.endX - plan.startX) * DSCS_TRAJ_REVERSAL;
+    stillBand_ = fabs((double)plan.endX - plan.startX) * DSCS_TRAJ_STILL;
+    direction_ = 0;
+    extreme_ = 0;
+    reversals_ = 0;
+    lines_ = 0;
+    lastLineEnd_ = -1;
+    linePeriod_ = 0;
+    line_ = 0;
+    fraction_ = 0;
+    remaining_ = plan.duration;
+    positions_ = false;
+    stillX_ = 0;
+    stillSince_ = 0;
+    endSeen_ = -1;
+    finished_ = false;
+}
+
+/*
+ * Count line ends from direction reversals of the X position. With FWBW
+ * every reversal ends a line; otherwise every other one does, the rest end a
+ * fly back. The move to the start point is not looked at.
+ */
+void dscsTrajectoryProgress::addPosition(double elapsed, double x)
+{
+    if (elapsed < plan_.posDuration || hysteresis_ <= 0) return;
+
+    // how long X has rested, for the end of the trajectory
+    if (!positions_ || fabs(x - stillX_) > stillBand_) {
+        stillX_ = x;
+        stillSince_ = elapsed;
+    }
+    positions_ = true;
+
+    // the first line runs from start X towards end X
+    if (direction_ == 0) {
+        direction_ = plan_.endX >= plan_.startX ? 1 : -1;
+        extreme_ = x;
+        return;
+    }
+    if ((x - extreme_) * direction_ > 0) {
+        extreme_ = x;
+        return;
+    }
+    if (fabs(x - extreme_) < hysteresis_) return;
+
+    direction_ = -direction_;
+    extreme_ = x;
+    reversals_++;
+    if ((plan_.settings & dscsTrajFWBW) || reversals_ % 2 == 1) {
+        lines_++;
+        if (lastLineEnd_ >= 0) {
+            double period = elapsed - lastLineEnd_;
+            linePeriod_ = linePeriod_ > 0 ? linePeriod_ + 0.3 * (period - linePeriod_) : period;
+        }
+        lastLineEnd_ = elapsed;
+    }
+}
+
+void dscsTrajectoryProgress::update(double elapsed)
+{
+    double t = elapsed - plan_.posDuration;
+    int planned = t < 0 ? 0 : (int)(t / plan_.linePeriod);
+
+    line_ = lines_ > 0 ? lines_ : planned;
+    if (line_ > (int)plan_.countY - 1) line_ = plan_.countY - 1;
+
+    if (linePeriod_ > 0 && lastLineEnd_ >= 0) {
+        // lines left at the measured rate, from the last line end seen
+        int lines = (int)plan_.countY - lines_;  // more line ends than planned when X overshoots
+        double left = (lines > 0 ? lines : 0) * linePeriod_ - (elapsed - lastLineEnd_);
+        remaining_ = left > 0 ? left : 0;
+    } else {
+        remaining_ = plan_.duration > elapsed ? plan_.duration - elapsed : 0;
+    }
+    fraction_ = plan_.duration > 0 ? 1.0 - remaining_ / plan_.duration : 1;
+    if (fraction_ < 0) fraction_ = 0;
+
+    // the expected end alone is not enough while X still moves
+    if (remaining_ > 0) return;
+    if (endSeen_ < 0) endSeen_ = elapsed;
+    finished_ = !positions_ || elapsed - stillSince_ >= DSCS_TRAJ_STILL_TIME ||
+                elapsed - endSeen_ >= DSCS_TRAJ_END_TIMEOUT;
+}
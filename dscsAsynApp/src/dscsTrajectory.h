@@ -0,0 +1,123 @@
+/*
+ * Fly-scan trajectory planner
+ *
+ * Turns a raster described in nm and s into the controller's trajectory
+ * registers (TRAJ_* rows of dscsAsynParams.h):
+ *
+ *   positions  632.991/4096 nm  TRAJ_START_X, TRAJ_END_X, TRAJ_START_Y,
+ *                               TRAJ_DIST_Y, TRAJ_ANTI_HYST
+ *   speed      2.358 nm/s       TRAJ_SPEED_X
+ *   times      divider of 2^32 us, time = 2^32 us / divider
+ *                               TRAJ_TURN_TIME, TRAJ_POS_TIME
+ *
+ * The scan runs lines along X at constant speed, one pixel per dwell time,
+ * and steps one pixel in Y between lines. Register rounding is reported back
+ * in the plan (actual pixel dwell, line time), not hidden.
+ */
+
+#ifndef DSCS_TRAJECTORY_H
+#define DSCS_TRAJECTORY_H
+
+#include <string>
+
+#define DSCS_TRAJ_POS_UNIT    (632.991 / 4096)  // nm per position count
+#define DSCS_TRAJ_SPEED_UNIT  2.358             // nm/s per speed count
+#define DSCS_TRAJ_TIME_BASE   4294.967296       // s, 2^32 us
+#define DSCS_TRAJ_MAX_LINES   65535             // TRAJ_COUNT_Y is 16 bit
+#define DSCS_TRAJ_REVERSAL    0.02              // X reversal threshold, fraction of the line length
+#define DSCS_TRAJ_STILL       0.002             // X at rest within this fraction of the line length
+#define DSCS_TRAJ_STILL_TIME  0.05              // s X must rest for the end to count
+#define DSCS_TRAJ_END_TIMEOUT 5.0               // s past the expected end X is given to come to rest
+
+// Scan mode bits, the same as DSCS_TrajectorySettings
+#define dscsTrajFWBW       0x1  // alternate line direction instead of flying back
+#define dscsTrajAntiHyst   0x2  // overshoot the Y start so every line is approached from one side
+#define dscsTrajContinuous 0x4  // controller's continuous mode; the plan covers one raster
+
+/*
+ * A raster in physical units
+ */
+struct dscsScanRequest {
+    double startX;     // nm, first pixel of the first line
+    double startY;     // nm
+    double width;      // nm along X
+    double height;     // nm along Y; 0 for a single line
+    double pixel;      // nm, pixel size in X and line spacing in Y
+    double dwell;      // s per pixel
+    double turnTime;   // s to reverse direction at a line end
+    double posTime;    // s to move to the start point
+    double antiHyst;   // nm of Y overshoot, used with dscsTrajAntiHyst
+    unsigned int mode; // dscsTraj* bits
+};
+
+/*
+ * Register values and what they add up to
+ */
+struct dscsTrajectoryPlan {
+    int startX, endX, speedX;
+    int startY, distY;
+    unsigned int countY;
+    unsigned int turnTime, posTime;  // dividers
+    int antiHyst;
+    unsigned int settings;
+
+    int pixelsX;         // pixels per line
+    double dwell;        // s per pixel after rounding the speed
+    double lineTime;     // s per line
+    double linePeriod;   // s from one line start to the next, with the turn or fly back
+    double posDuration;  // s to move to the start point
+    double duration;     // s for one raster, including the move to the start
+};
+
+// Fill plan from request; false with a reason in error if it can't be done
+bool dscsPlanTrajectory(const dscsScanRequest &request, dscsTrajectoryPlan &plan, std::string &error);
+
+// Fill the timing fields of a plan from its register values
+bool dscsTrajectoryTiming(dscsTrajectoryPlan &plan, std::string &error);
+
+/*
+ * Progress of a running trajectory. The caller supplies the time since the
+ * start, best taken from the stream's sample clock, and, where it has one,
+ * the X position; line ends are then counted from the X reversals and the
+ * remaining time follows the measured line rate instead of the plan. With
+ * positions the trajectory is only finished once X has also come to rest,
+ * or DSCS_TRAJ_END_TIMEOUT after the expected end. Not thread safe, the
+ * owner serialises access.
+ */
+class dscsTrajectoryProgress {
+public:
+    void start(const dscsTrajectoryPlan &plan);
+
+    // X position at elapsed s after the start, any unit proportional to X
+    void addPosition(double elapsed, double x);
+    void update(double elapsed);
+
+    int line() const { return line_; }                 // running line, 0 based
+    double fraction() const { return fraction_; }      // 0..1
+    double remaining() const { return remaining_; }    // s
+    double plannedLineRate() const { return plan_.linePeriod > 0 ? 1.0 / plan_.linePeriod : 0; }
+    double actualLineRate() const { return linePeriod_ > 0 ? 1.0 / linePeriod_ : 0; } // 0 until two line ends were seen
+    bool measured() const { return linePeriod_ > 0 && lastLineEnd_ >= 0; } // remaining() from line ends, not the plan
+    bool finished() const { return finished_; }
+
+private:
+    dscsTrajectoryPlan plan_;
+    double hysteresis_;    // position units
+    int direction_;        // +1/-1, 0 before the first line
+    double extreme_;       // furthest position in direction_
+    int reversals_;
+    int lines_;            // line ends seen
+    double lastLineEnd_;   // elapsed s, -1 = none yet
+    double linePeriod_;    // measured s per line, 0 = not yet
+    int line_;
+    double fraction_;
+    double remaining_;
+    bool positions_;       // addPosition was called past the move to the start
+    double stillBand_;     // position units
+    double stillX_;        // position X rests around
+    double stillSince_;    // elapsed s it has been there
+    double endSeen_;       // elapsed s remaining() reached 0, -1 = not yet
+    bool finished_;
+};
+
+#endif /* DSCS_TRAJECTORY_H */
@@ -0,0 +1,613 @@
+/*
+ * qudisAsyn
+ *
+ * quDIS interferometer port driver, see qudisAsyn.h
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <iocsh.h>
+#include <epicsExport.h>
+#include <epicsString.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+#include "qudisAsyn.h"
+
+static const char *driverName = "qudisAsyn";
+
+// Stream channel tags; parameter names end in them
+static const char *streamTags[QDS_STREAM_CHANNELS] = { "REL", "ABS" };
+
+// Driver threads, as named to qudisAsynThread
+static const char *threadTags[QDS_NUM_THREADS] = { "POLLER", "STREAM" };
+
+// The position callbacks identify the device only by number
+static qudisAsyn *qudisDrivers[QDS_MAX_DEVICES];
+
+static const char * getMessage( int code )
+{
+  switch( code ) {
+  case QDS_Ok:           return "";
+  case QDS_Error:        return "Unspecified error";
+  case QDS_Timeout:      return "Communication timeout";
+  case QDS_NotConnected: return "No active connection to device";
+  case QDS_DriverError:  return "Error in communication with driver";
+  case QDS_DeviceLocked: return "Device is already in use by other";
+  case QDS_Unknown:      return "Unknown error";
+  case QDS_NoDevice:     return "Invalid device number in function call";
+  case QDS_NoAxis:       return "Invalid axis number in function call";
+  case QDS_ParamOutOfRg: return "A parameter exceeds the allowed range";
+  case QDS_Capability:   return "The capability needed is not unlocked";
+  case QDS_OldValue:     return "The read value was already returned";
+  default:               return "Unknown error code";
+  }
+}
+
+static void relCallbackC(unsigned int devNo, unsigned int length, unsigned int index,
+                         const double * const positions[QDS_AXES_CNT],
+                         const Int32 * const markers[QDS_AXES_CNT])
+{
+  if (devNo < QDS_MAX_DEVICES && qudisDrivers[devNo])
+    qudisDrivers[devNo]->positionCallback(0, length, index, positions);
+}
+
+static void absCallbackC(unsigned int devNo, unsigned int length, unsigned int index,
+                         const double * const positions[QDS_AXES_CNT],
+                         const Int32 * const markers[QDS_AXES_CNT])
+{
+  if (devNo < QDS_MAX_DEVICES && qudisDrivers[devNo])
+    qudisDrivers[devNo]->positionCallback(1, length, index, positions);
+}
+
+static void pollerThreadC(void * pPvt)
+{
+  qudisAsyn *pqudisAsyn = (qudisAsyn*)pPvt;
+  pqudisAsyn->pollerThread();
+}
+
+static void streamThreadC(void * pPvt)
+{
+  qudisAsyn *pqudisAsyn = (qudisAsyn*)pPvt;
+  pqudisAsyn->streamThread();
+}
+
+int qudisAsyn::checkError(const char * context, int code)
+{
+  if ( code != QDS_Ok ) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s, port %s, error calling %s: %s\n",
+      driverName, this->portName, context, getMessage( code ) );
+  }
+  return code;
+}
+
+// Vendor return code to asynStatus. Link-class errors mark the port
+// disconnected; the poller reconnects.
+asynStatus qudisAsyn::checkStatus(const char * context, int code)
+{
+  switch( checkError( context, code ) ) {
+  case QDS_Ok:
+    return asynSuccess;
+  case QDS_Timeout:
+  case QDS_NotConnected:
+  case QDS_DriverError:
+  case QDS_NoDevice:
+    if (this->connected_) {
+      this->connected_ = false;
+      setIntegerParam(Connected_rbv_, 0);
+      pasynManager->exceptionDisconnect(this->pasynUserSelf);
+    }
+    return asynDisconnected;
+  default:
+    return asynError;
+  }
+}
+
+qudisAsyn::qudisAsyn(const char *portName, int qudisId, int mode, int bufferSize) : asynPortDriver(portName, 1,
+		asynInt32Mask | asynFloat64Mask | asynDrvUserMask | asynFloat64ArrayMask,
+		asynInt32Mask | asynFloat64Mask | asynFloat64ArrayMask,
+		ASYN_CANBLOCK, 1, /* ASYN_CANBLOCK=1, ASYN_MULTIDEVICE=0, autoConnect=1 */
+		0, 0), /* Default priority and stack size */
+    deviceId(qudisId),
+    mode_(mode == qdsModeBulk ? qdsModeBulk : qdsModeCallback),
+    bufferSize_(bufferSize > 0 ? bufferSize : QDS_DEFAULT_BUFFER_SIZE),
+    bulkPeriod_(QDS_DEFAULT_BULK_PERIOD)
+{
+	char name[64];
+
+	createParam("CONNECTED_RBV",        asynParamInt32,   &Connected_rbv_);
+	createParam("MODE",                 asynParamInt32,   &Mode_);
+	createParam("STREAM_ENABLE",        asynParamInt32,   &StreamEnable_);
+	createParam("SAMPLE_TIME",          asynParamInt32,   &SampleTime_);
+	createParam("SAMPLE_PERIOD_RBV",    asynParamFloat64, &SamplePeriod_rbv_);
+	createParam("BULK_PERIOD",          asynParamFloat64, &BulkPeriod_);
+	setIntegerParam(Connected_rbv_, 0);
+	setIntegerParam(Mode_, mode_);
+	setIntegerParam(StreamEnable_, 0);
+	setDoubleParam(BulkPeriod_, bulkPeriod_);
+
+	for (int ch = 0; ch < QDS_STREAM_CHANNELS; ++ch) {
+		for (int axis = 0; axis < QDS_AXES_CNT; ++axis) {
+			snprintf(name, sizeof(name), "POSITION_%s_%d", streamTags[ch], axis);
+			createParam(name, asynParamFloat64Array, &Position_[ch][axis]);
+			snprintf(name, sizeof(name), "POSITION_RBV_%s_%d", streamTags[ch], axis);
+			createParam(name, asynParamFloat64, &Position_rbv_[ch][axis]);
+			bulkAxis_[ch][axis].resize(bufferSize_);
+		}
+		snprintf(name, sizeof(name), "STREAM_TIME_%s", streamTags[ch]);
+		createParam(name, asynParamFloat64Array, &StreamTime_[ch]);
+		snprintf(name, sizeof(name), "STREAM_RATE_RBV_%s", streamTags[ch]);
+		createParam(name, asynParamFloat64, &StreamRate_rbv_[ch]);
+		snprintf(name, sizeof(name), "STREAM_TIME_RESID_RBV_%s", streamTags[ch]);
+		createParam(name, asynParamFloat64, &StreamTimeResid_rbv_[ch]);
+		snprintf(name, sizeof(name), "STREAM_LOST_RBV_%s", streamTags[ch]);
+		createParam(name, asynParamInt32, &StreamLost_rbv_[ch]);
+		snprintf(name, sizeof(name), "STREAM_OVERFLOWS_RBV_%s", streamTags[ch]);
+		createParam(name, asynParamInt32, &StreamOverflows_rbv_[ch]);
+		setDoubleParam(StreamRate_rbv_[ch], 0);
+		setDoubleParam(StreamTimeResid_rbv_[ch], 0);
+		setIntegerParam(StreamLost_rbv_[ch], 0);
+		setIntegerParam(StreamOverflows_rbv_[ch], 0);
+
+		streamQueue_[ch] = new dscsStreamQueue<double>(QDS_STREAM_QUEUE_PACKETS,
+			QDS_STREAM_QUEUE_SAMPLES * QDS_AXES_CNT);
+		callbackBuf_[ch].reserve(QDS_STREAM_QUEUE_SAMPLES * QDS_AXES_CNT / 64);
+		bulkIndex_[ch] = 0;
+		mergeTap_[ch] = NULL;
+	}
+	bulkBuf_.reserve(bufferSize_ * QDS_AXES_CNT);
+	streamEvent_ = epicsEventMustCreate(epicsEventEmpty);
+
+	// If the device isn't there yet the poller keeps retrying
+	connect(this->pasynUserSelf);
+
+	threads_[qdsThreadPoller] = epicsThreadCreate("qudisAsynPoller",
+		epicsThreadPriorityLow,
+		epicsThreadGetStackSize(epicsThreadStackMedium),
+		(EPICSTHREADFUNC)pollerThreadC,
+		this);
+
+	threads_[qdsThreadStream] = epicsThreadCreate("qudisAsynStream",
+		epicsThreadPriorityMedium,
+		epicsThreadGetStackSize(epicsThreadStackMedium),
+		(EPICSTHREADFUNC)streamThreadC,
+		this);
+}
+
+qudisAsyn::~qudisAsyn()
+{
+	disconnect(this->pasynUserSelf);
+	if (deviceNo < QDS_MAX_DEVICES && qudisDrivers[deviceNo] == this) qudisDrivers[deviceNo] = NULL;
+}
+
+asynStatus qudisAsyn::connect(asynUser *pasynUser)
+{
+	static const char *functionName = "connect";
+	unsigned int devCount = 0, devNo, lbSampleTm;
+	int errorCode;
+
+	asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+		"%s:%s, port %s, connecting to quDIS ID %d\n",
+		driverName, functionName, this->portName, this->deviceId);
+
+	// The poller retries this every QDS_DEFAULT_RECONNECT_TIME while the
+	// link is down, so discovery and the device search run without the port
+	// lock, and a missing device is only reported as flow.
+	errorCode = QDS_discover(IfAll, &devCount);
+	if (errorCode != QDS_Ok) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, QDS_discover failed: %s\n",
+			driverName, functionName, this->portName, getMessage(errorCode));
+		return asynError;
+	}
+
+	// search through available devices for desired ID
+	for (devNo = 0; devNo < devCount; devNo++) {
+		int id = 0;
+		char addr[20], serialNo[20];
+		errorCode = QDS_getDeviceInfo(devNo, &id, serialNo, addr);
+		if (errorCode != QDS_Ok) {
+			asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+				"%s:%s, port %s, QDS_getDeviceInfo(%u) failed: %s\n",
+				driverName, functionName, this->portName, devNo, getMessage(errorCode));
+			continue;
+		}
+		if (id == this->deviceId) break;
+	}
+	if (devNo == devCount || devNo >= QDS_MAX_DEVICES) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+			"%s:%s, port %s, quDIS ID %d not found among %u devices\n",
+			driverName, functionName, this->portName, this->deviceId, devCount);
+		return asynError;
+	}
+
+	this->lock();
+	this->deviceNo = devNo;
+	qudisDrivers[devNo] = this;
+	errorCode = QDS_connect(devNo);
+	if (errorCode == QDS_Ok && QDS_getSampleTime(devNo, &lbSampleTm) == QDS_Ok) {
+		setIntegerParam(SampleTime_, lbSampleTm);
+		setDoubleParam(SamplePeriod_rbv_, QDS_BASE_SAMPLE_TIME * (1 << lbSampleTm));
+	}
+	this->unlock();
+
+	if (errorCode != QDS_Ok) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, QDS_connect failed: %s\n",
+			driverName, functionName, this->portName, getMessage(errorCode));
+		return asynError;
+	}
+
+	if (pasynManager->exceptionConnect(this->pasynUserSelf)) {
+		asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s: error calling pasynManager->exceptionConnect, error=%s\n",
+			driverName, functionName, pasynUserSelf->errorMessage);
+	}
+
+	this->lock();
+	this->connected_ = true;
+	this->autoReconnect_ = true;
+	setIntegerParam(Connected_rbv_, 1);
+	// the device forgets callbacks and buffer with the connection
+	if (this->streamEnabled_) enableStream(true);
+	callParamCallbacks();
+	this->unlock();
+
+	return asynSuccess;
+}
+
+asynStatus qudisAsyn::disconnect(asynUser *pasynUser)
+{
+	this->lock();
+	if (this->connected_) {
+		if (this->streamEnabled_ && mode_ == qdsModeCallback) QDS_setPositionCallback(deviceNo, NULL, NULL);
+		checkError("QDS_disconnect", QDS_disconnect(deviceNo));
+	}
+	// an explicit disconnect is not a link failure, so don't fight it
+	this->connected_ = false;
+	this->autoReconnect_ = false;
+	setIntegerParam(Connected_rbv_, 0);
+	callParamCallbacks();
+	this->unlock();
+
+	pasynManager->exceptionDisconnect(this->pasynUserSelf);
+	return asynSuccess;
+}
+
+/*
+ * Start or stop acquisition in the current mode. The enable state is kept
+ * even if the vendor calls fail so that a reconnect re-enables the stream.
+ * Called with the port lock held.
+ */
+asynStatus qudisAsyn::enableStream(bool enable)
+{
+	static const char *functionName = "enableStream";
+	asynStatus status = asynSuccess;
+
+	asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s, port %s, %s %s stream\n",
+		driverName, functionName, this->portName, enable ? "enabling" : "disabling",
+		mode_ == qdsModeBulk ? "bulk" : "callback");
+
+	this->streamEnabled_ = enable;
+	for (int ch = 0; ch < QDS_STREAM_CHANNELS; ++ch) {
+		streamChannel_[ch].restart();
+		bulkIndex_[ch] = 0;
+	}
+	if (!this->connected_) return asynDisconnected;
+
+	if (mode_ == qdsModeCallback) {
+		status = checkStatus("QDS_setPositionCallback", enable ?
+			QDS_setPositionCallback(deviceNo, relCallbackC, absCallbackC) :
+			QDS_setPositionCallback(deviceNo, NULL, NULL));
+	}
+	else if (enable) {
+		unsigned int lostRel[QDS_AXES_CNT], lostAbs[QDS_AXES_CNT];
+		status = checkStatus("QDS_configureBuffer", QDS_configureBuffer(deviceNo, bufferSize_));
+		// start counting lost samples from now
+		if (status == asynSuccess) QDS_getLostData(deviceNo, lostRel, lostAbs);
+	}
+	return status;
+}
+
+/*
+ * Interleave one packet of per-axis positions into buf and queue it. Runs on
+ * the packet's producer thread, without the port lock.
+ */
+void qudisAsyn::queuePacket(int channel, unsigned int length, epicsUInt32 index,
+                            const double * const positions[QDS_AXES_CNT],
+                            std::vector<double> &buf, const epicsTimeStamp &arrival)
+{
+	dscsStreamPacket packet;
+
+	packet.channel = channel;
+	packet.index = index;
+	packet.nSamples = length;
+	packet.width = QDS_AXES_CNT;
+	packet.arrival = arrival;
+
+	buf.resize((size_t)length * QDS_AXES_CNT);
+	for (unsigned int i = 0; i < length; ++i) {
+		for (int axis = 0; axis < QDS_AXES_CNT; ++axis) buf[i * QDS_AXES_CNT + axis] = positions[axis][i];
+	}
+
+	if (streamQueue_[channel]->push(packet, buf.data())) epicsEventSignal(streamEvent_);
+}
+
+/*
+ * Called from the vendor library's thread in callback mode. The position
+ * buffers are only valid during the call, so they are copied into the queue.
+ */
+void qudisAsyn::positionCallback(int channel, unsigned int length, unsigned int index,
+                                 const double * const positions[QDS_AXES_CNT])
+{
+	epicsTimeStamp arrival;
+
+	epicsTimeGetCurrent(&arrival);
+	if (length == 0) return;
+	queuePacket(channel, length, index, positions, callbackBuf_[channel], arrival);
+}
+
+/*
+ * Drain the device buffer in bulk mode. The buffer has no sequence number, so
+ * the index is a running sample count advanced by QDS_getLostData. Called
+ * with the port lock held; queuing happens here too since the poller is the
+ * only producer in bulk mode.
+ */
+void qudisAsyn::readBulk()
+{
+	double *rel[QDS_AXES_CNT], *absPos[QDS_AXES_CNT];
+	const double *planes[QDS_STREAM_CHANNELS][QDS_AXES_CNT];
+	unsigned int lost[QDS_STREAM_CHANNELS][QDS_AXES_CNT];
+	unsigned int size = bufferSize_;
+	epicsTimeStamp arrival;
+
+	for (int axis = 0; axis < QDS_AXES_CNT; ++axis) {
+		rel[axis] = bulkAxis_[0][axis].data();
+		absPos[axis] = bulkAxis_[1][axis].data();
+		planes[0][axis] = rel[axis];
+		planes[1][axis] = absPos[axis];
+	}
+
+	if (checkStatus("QDS_getLostData", QDS_getLostData(deviceNo, lost[0], lost[1])) != asynSuccess) return;
+	if (checkStatus("QDS_readBuffer", QDS_readBuffer(deviceNo, rel, absPos, &size)) != asynSuccess) return;
+	epicsTimeGetCurrent(&arrival);
+
+	for (int ch = 0; ch < QDS_STREAM_CHANNELS; ++ch) {
+		unsigned int skipped = 0;
+		for (int axis = 0; axis < QDS_AXES_CNT; ++axis) {
+			if (lost[ch][axis] > skipped) skipped = lost[ch][axis];
+		}
+		bulkIndex_[ch] += skipped;
+		if (size > 0) queuePacket(ch, size, bulkIndex_[ch], planes[ch], bulkBuf_, arrival);
+		bulkIndex_[ch] += size;
+	}
+}
+
+/*
+ * Reconnects after link loss and, in bulk mode, reads the device buffer
+ */
+void qudisAsyn::pollerThread()
+{
+	double sleepTime;
+
+	while (1) {
+		lock();
+		// connect takes the lock itself, only around the device calls
+		if (!connected_ && autoReconnect_) {
+			unlock();
+			connect(this->pasynUserSelf);
+			lock();
+		}
+		if (!connected_) {
+			sleepTime = QDS_DEFAULT_RECONNECT_TIME;
+		} else {
+			if (streamEnabled_ && mode_ == qdsModeBulk) readBulk();
+			sleepTime = bulkPeriod_;
+		}
+		unlock();
+		epicsThreadSleep(sleepTime);
+	}
+}
+
+/*
+ * Drains the stream queues and publishes each packet
+ */
+void qudisAsyn::streamThread()
+{
+	dscsStreamPacket packet;
+
+	while (1) {
+		epicsEventWaitWithTimeout(streamEvent_, 1.0);
+
+		lock();
+		for (int ch = 0; ch < QDS_STREAM_CHANNELS; ++ch) {
+			while (streamQueue_[ch]->pop(packet, streamValues_)) {
+				// packets still queued when the stream was switched off are dropped
+				if (this->streamEnabled_) publishPacket(packet);
+			}
+			setIntegerParam(StreamOverflows_rbv_[ch], (epicsInt32)streamQueue_[ch]->overflows());
+		}
+		callParamCallbacks();
+		unlock();
+	}
+}
+
+/*
+ * Publish the packet held in streamValues_ as one array per axis, stamped
+ * from the channel's clock model. Called with the port lock held.
+ */
+void qudisAsyn::publishPacket(const dscsStreamPacket &packet)
+{
+	dscsStreamChannel &channel = streamChannel_[packet.channel];
+	epicsTimeStamp first;
+	int n = packet.nSamples;
+
+	channel.stamp(packet, streamTime_, &first);
+	setTimeStamp(&first);
+
+	setDoubleParam(StreamRate_rbv_[packet.channel], channel.rate());
+	setDoubleParam(StreamTimeResid_rbv_[packet.channel], channel.residual());
+	setIntegerParam(StreamLost_rbv_[packet.channel], (epicsInt32)channel.lost());
+
+	streamAxis_.resize(n);
+	for (int axis = 0; axis < QDS_AXES_CNT; ++axis) {
+		for (int i = 0; i < n; ++i) streamAxis_[i] = streamValues_[i * QDS_AXES_CNT + axis];
+		setDoubleParam(Position_rbv_[packet.channel][axis], streamAxis_[n - 1]);
+		doCallbacksFloat64Array(streamAxis_.data(), n, Position_[packet.channel][axis], 0);
+	}
+	doCallbacksFloat64Array(streamTime_.data(), n, StreamTime_[packet.channel], 0);
+	callParamCallbacks();
+
+	// feed a merge that asked for this channel (dscsAsynMerge)
+	dscsStreamMerge *&merge = mergeTap_[packet.channel];
+	if (!merge) merge = dscsStreamMerge::find(this->portName, streamTags[packet.channel]);
+	if (merge && merge->width() == QDS_AXES_CNT) merge->addSecondary(streamTime_.data(), streamValues_.data(), n);
+}
+
+asynStatus qudisAsyn::writeInt32(asynUser *pasynUser, epicsInt32 value)
+{
+	int function = pasynUser->reason;
+	asynStatus status = asynSuccess;
+	static const char *functionName = "writeInt32";
+
+	setIntegerParam(function, value);
+
+	if (function == StreamEnable_) {
+		status = enableStream(value != 0);
+	}
+	else if (function == Mode_) {
+		bool running = this->streamEnabled_;
+		if (running) enableStream(false);
+		mode_ = (value == qdsModeBulk) ? qdsModeBulk : qdsModeCallback;
+		if (running) status = enableStream(true);
+	}
+	else if (function == SampleTime_) {
+		if (value < 0 || value > 16) status = asynError;
+		else status = checkStatus("QDS_setSampleTime", QDS_setSampleTime(deviceNo, value));
+		if (status == asynSuccess) setDoubleParam(SamplePeriod_rbv_, QDS_BASE_SAMPLE_TIME * (1 << value));
+	}
+
+	callParamCallbacks();
+
+	if (status != asynSuccess) {
+		asynPrint(pasynUser, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, ERROR writing %d, status=%d\n",
+			driverName, functionName, this->portName, value, status);
+	}
+	return status;
+}
+
+asynStatus qudisAsyn::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
+{
+	int function = pasynUser->reason;
+	asynStatus status = asynSuccess;
+	static const char *functionName = "writeFloat64";
+
+	setDoubleParam(function, value);
+
+	if (function == BulkPeriod_) {
+		if (value > 0) bulkPeriod_ = value;
+		else status = asynError;
+	}
+
+	callParamCallbacks();
+
+	if (status != asynSuccess) {
+		asynPrint(pasynUser, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, ERROR writing %f, status=%d\n",
+			driverName, functionName, this->portName, value, status);
+	}
+	return status;
+}
+
+/*
+ * Scheduling of one driver thread, see qudisAsynThread and dscsThread.h
+ */
+asynStatus qudisAsyn::setThreadOptions(const char *thread, int priority, const char *cpus, const char *policy)
+{
+	static const char *functionName = "setThreadOptions";
+	int t;
+
+	for (t = 0; t < QDS_NUM_THREADS && (!thread || epicsStrCaseCmp(thread, threadTags[t]) != 0); ++t) {}
+	if (t == QDS_NUM_THREADS || !threads_[t]) {
+		asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+			"%s:%s, port %s, unknown thread %s\n",
+			driverName, functionName, this->portName, thread ? thread : "");
+		return asynError;
+	}
+	return dscsSetThreadOptions(threads_[t], threadTags[t], priority, cpus, policy, this->pasynUserSelf, this->portName);
+}
+
+void qudisAsyn::report(FILE *fp, int details)
+{
+    asynPortDriver::report(fp, details);
+    fprintf(fp, "* Port: %s, quDIS ID %d, device %u, %s mode\n",
+        this->portName, this->deviceId, this->deviceNo,
+        mode_ == qdsModeBulk ? "bulk" : "callback");
+    if (details >= 1) {
+        fprintf(fp, "  Thread       priority  policy      cpus\n");
+        for (int t = 0; t < QDS_NUM_THREADS; ++t) {
+            if (threads_[t]) dscsReportThread(fp, threadTags[t], threads_[t]);
+        }
+    }
+    fprintf(fp, "\n");
+}
+
+extern "C" int qudisAsynConfig(const char *portName, int qudisId, int mode, int bufferSize)
+{
+    new qudisAsyn(portName, qudisId, mode, bufferSize);
+    return(asynSuccess);
+}
+
+static const iocshArg qudisAsynArg0 = { "Port name", iocshArgString};
+static const iocshArg qudisAsynArg1 = { "Device ID", iocshArgInt};
+static const iocshArg qudisAsynArg2 = { "Mode (0=callback, 1=bulk)", iocshArgInt};
+static const iocshArg qudisAsynArg3 = { "Bulk buffer size", iocshArgInt};
+static const iocshArg * const qudisAsynArgs[4] = {&qudisAsynArg0, &qudisAsynArg1, &qudisAsynArg2, &qudisAsynArg3};
+static const iocshFuncDef qudisAsynFuncDef = {"qudisAsynConfig", 4, qudisAsynArgs};
+static void qudisAsynCallFunc(const iocshArgBuf *args)
+{
+    qudisAsynConfig(args[0].sval, args[1].ival, args[2].ival, args[3].ival);
+}
+
+/*
+ * qudisAsynThread(port, thread, priority, cpus, policy), after
+ * qudisAsynConfig. thread is POLLER or STREAM, the other arguments as for
+ * dscsAsynThread; see dscsThread.h. E.g. to keep the quDIS publisher off the
+ * core of the DSCS stream:
+ *   qudisAsynThread("QDS1", "STREAM", 70, "2", "FIFO")
+ */
+extern "C" int qudisAsynThread(const char *portName, const char *thread, int priority, const char *cpus,
+                               const char *policy)
+{
+    qudisAsyn *pqudisAsyn = (qudisAsyn *)findAsynPortDriver(portName);
+    if (!pqudisAsyn) {
+        printf("qudisAsynThread: port %s not found\n", portName);
+        return(asynError);
+    }
+    return(pqudisAsyn->setThreadOptions(thread, priority, cpus, policy));
+}
+
+static const iocshArg qudisAsynThreadArg0 = { "Port name", iocshArgString};
+static const iocshArg qudisAsynThreadArg1 = { "Thread (POLLER/STREAM)", iocshArgString};
+static const iocshArg qudisAsynThreadArg2 = { "Priority (0-99, -1 to keep)", iocshArgInt};
+static const iocshArg qudisAsynThreadArg3 = { "CPUs (e.g. 2,3 or 4-7)", iocshArgString};
+static const iocshArg qudisAsynThreadArg4 = { "Policy (FIFO/OTHER)", iocshArgString};
+static const iocshArg * const qudisAsynThreadArgs[5] = {&qudisAsynThreadArg0, &qudisAsynThreadArg1, &qudisAsynThreadArg2,
+                                                        &qudisAsynThreadArg3, &qudisAsynThreadArg4};
+static const iocshFuncDef qudisAsynThreadFuncDef = {"qudisAsynThread", 5, qudisAsynThreadArgs};
+static void qudisAsynThreadCallFunc(const iocshArgBuf *args)
+{
+    qudisAsynThread(args[0].sval, args[1].sval, args[2].ival, args[3].sval, args[4].sval);
+}
+
+void drvqudisAsynRegister(void)
+{
+    iocshRegister(&qudisAsynFuncDef, qudisAsynCallFunc);
+    iocshRegister(&qudisAsynThreadFuncDef, qudisAsynThreadCallFunc);
+}
+
+extern "C" {
+    epicsExportRegistrar(drvqudisAsynRegister);
+}
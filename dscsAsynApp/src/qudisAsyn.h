@@ -0,0 +1,129 @@
+/*
+ * qudisAsyn
+ *
+ * asyn port driver for the quDIS interferometer, streaming relative and
+ * absolute positions of all three axes through the same queue, clock model
+ * and publishing path as the DSCS data stream (dscsStream.h).
+ *
+ * Two acquisition modes:
+ *   callback  QDS_setPositionCallback; packets are queued from the vendor
+ *             thread as they arrive (USB only)
+ *   bulk      QDS_configureBuffer/QDS_readBuffer; the poller drains the
+ *             device buffer every BULK_PERIOD and accounts for lost samples
+ *             with QDS_getLostData (USB and ethernet)
+ */
+
+#include <vector>
+
+#include <epicsEvent.h>
+#include <asynPortDriver.h>
+
+#include "qudis.h" // vendor supplied library
+#include "dscsStream.h"
+#include "dscsStreamMerge.h"
+#include "dscsThread.h"
+
+#define QDS_MAX_DEVICES 8
+
+#define QDS_STREAM_CHANNELS 2 // REL and ABS positions
+#define QDS_STREAM_QUEUE_PACKETS 1024
+#define QDS_STREAM_QUEUE_SAMPLES (1 << 18) // position triples buffered per channel
+
+#define QDS_DEFAULT_BUFFER_SIZE 100000 // device buffer in bulk mode, samples
+#define QDS_DEFAULT_BULK_PERIOD 0.1
+#define QDS_DEFAULT_RECONNECT_TIME 2.0
+
+#define QDS_BASE_SAMPLE_TIME 40e-6 // sample time is this * 2^SAMPLE_TIME
+
+typedef enum {
+    qdsModeCallback,
+    qdsModeBulk
+} qdsStreamMode;
+
+// Driver threads, whose scheduling qudisAsynThread sets
+typedef enum {
+    qdsThreadPoller,    // reconnects, drains the device buffer in bulk mode
+    qdsThreadStream,    // stream publisher
+    QDS_NUM_THREADS
+} qdsThread;
+
+/*
+ * Class definition for the qudisAsyn class
+ */
+class qudisAsyn: public asynPortDriver {
+public:
+    qudisAsyn(const char *portName, int qudisId, int mode, int bufferSize);
+    virtual ~qudisAsyn();
+
+    virtual asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
+    virtual asynStatus writeFloat64(asynUser *pasynUser, epicsFloat64 value);
+
+    virtual asynStatus connect(asynUser *pasynUser);
+    virtual asynStatus disconnect(asynUser *pasynUser);
+
+    asynStatus setThreadOptions(const char *thread, int priority, const char *cpus, const char *policy);
+
+    // These should be private but are called from C
+    void positionCallback(int channel, unsigned int length, unsigned int index,
+                          const double * const positions[QDS_AXES_CNT]);
+    void pollerThread(void);
+    void streamThread(void);
+
+protected:
+	int Connected_rbv_;      // single value; 1 = connected
+	int Mode_;               // qdsStreamMode, changed with the stream off or on
+	int StreamEnable_;       // 1 = acquiring
+	int SampleTime_;         // logarithmic sample time, 0..16
+	int SamplePeriod_rbv_;   // resulting sample period, s
+	int BulkPeriod_;         // device buffer read interval in bulk mode, s
+
+	// per channel, REL and ABS
+	int Position_[QDS_STREAM_CHANNELS][QDS_AXES_CNT];      // Float64Array; one packet per axis, nm
+	int Position_rbv_[QDS_STREAM_CHANNELS][QDS_AXES_CNT];  // last position of each packet, nm
+	int StreamTime_[QDS_STREAM_CHANNELS];           // Float64Array; acquisition time of each sample, s past EPICS epoch
+	int StreamRate_rbv_[QDS_STREAM_CHANNELS];       // estimated sample rate, Hz
+	int StreamTimeResid_rbv_[QDS_STREAM_CHANNELS];  // RMS packet arrival jitter around the clock model, s
+	int StreamLost_rbv_[QDS_STREAM_CHANNELS];       // samples missing from the index sequence
+	int StreamOverflows_rbv_[QDS_STREAM_CHANNELS];  // packets dropped because the queue was full
+
+private:
+	int deviceId;
+	unsigned int deviceNo = 0;
+
+	// all guarded by the port lock, except the queues and producer buffers
+	bool connected_ = false;
+	bool autoReconnect_ = true;
+	bool streamEnabled_ = false;
+	qdsStreamMode mode_;
+	unsigned int bufferSize_;
+	double bulkPeriod_;
+
+	dscsStreamQueue<double> *streamQueue_[QDS_STREAM_CHANNELS];
+	dscsStreamChannel streamChannel_[QDS_STREAM_CHANNELS];
+	epicsEventId streamEvent_;
+
+	// producer side: interleaving buffers, one per producer thread
+	std::vector<double> callbackBuf_[QDS_STREAM_CHANNELS];
+	std::vector<double> bulkAxis_[QDS_STREAM_CHANNELS][QDS_AXES_CNT];
+	std::vector<double> bulkBuf_;
+	epicsUInt32 bulkIndex_[QDS_STREAM_CHANNELS]; // running sample count in bulk mode
+
+	// consumer side
+	std::vector<double> streamValues_;
+	std::vector<epicsFloat64> streamAxis_;
+	std::vector<epicsFloat64> streamTime_;
+	dscsStreamMerge *mergeTap_[QDS_STREAM_CHANNELS]; // merge fed by a channel, found by name
+
+	epicsThreadId threads_[QDS_NUM_THREADS] = {}; // see qdsThread
+
+	int checkError(const char *context, int code);
+	asynStatus checkStatus(const char *context, int code);
+	asynStatus enableStream(bool enable);
+	void readBulk();
+	void queuePacket(int channel, unsigned int length, epicsUInt32 index,
+	                 const double * const positions[QDS_AXES_CNT],
+	                 std::vector<double> &buf, const epicsTimeStamp &arrival);
+	void publishPacket(const dscsStreamPacket &packet);
+
+	void report(FILE *fp, int details);
+};